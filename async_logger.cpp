@@ -0,0 +1,251 @@
+#include "async_logger.h"
+#include "timestamp_cache.h"
+#include <iostream>
+
+const char* logSinkName(LogSinkType sink) {
+    switch (sink) {
+        case LogSinkType::STDOUT: return "stdout";
+        case LogSinkType::ROTATING_FILE: return "file";
+    }
+    return "unknown";
+}
+
+bool parseLogSink(const std::string& name, LogSinkType& sink) {
+    if (name == "stdout") {
+        sink = LogSinkType::STDOUT;
+    } else if (name == "file") {
+        sink = LogSinkType::ROTATING_FILE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static const char* levelTag(LogLevel level) {
+    switch (level) {
+        case LogLevel::INFO: return " [INFO] ";
+        case LogLevel::ERR: return " [ERROR] ";
+        case LogLevel::CHAT: return " [CHAT] ";
+        case LogLevel::WARN: return " [WARN] ";
+    }
+    return " ";
+}
+
+AsyncLogger::AsyncLogger(const LogConfig& config)
+    : config(config), mask(0), enqueue_position(0), dequeue_position(0), dropped(0), written(0),
+      reported_dropped(0), running(false), writer_idle(false), file(nullptr), file_bytes(0) {
+    size_t capacity = 2;
+    while (capacity < config.queue_size) {
+        capacity <<= 1;
+    }
+    slots.reset(new Slot[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    mask = capacity - 1;
+}
+
+AsyncLogger::~AsyncLogger() {
+    stop();
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+bool AsyncLogger::start() {
+    if (running) {
+        return true;
+    }
+    if (config.sink == LogSinkType::ROTATING_FILE && !openFile()) {
+        std::cerr << "Error: Could not open log file " << config.file_path << ", logging to stdout\n";
+        config.sink = LogSinkType::STDOUT;
+    }
+    running = true;
+    writer = std::thread(&AsyncLogger::writerLoop, this);
+    return true;
+}
+
+void AsyncLogger::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+    }
+    wake_cv.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+}
+
+bool AsyncLogger::log(LogLevel level, std::string text) {
+    Record record = makeRecord(level, std::move(text));
+    if (!running) {
+        std::string line;
+        formatRecord(line, record);
+        std::lock_guard<std::mutex> lock(sink_mutex);
+        writeBatch(line);
+        written.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (!tryPush(record)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // Only an idle writer needs waking; a busy one finds the record itself
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (writer_idle.load(std::memory_order_relaxed)) {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+        }
+        wake_cv.notify_one();
+    }
+    return true;
+}
+
+bool AsyncLogger::tryPush(Record& record) {
+    uint64_t position = enqueue_position.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[position & mask];
+        uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+        if (diff == 0) {
+            if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Full: the writer has not freed this slot yet
+        } else {
+            position = enqueue_position.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = std::move(record);
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool AsyncLogger::tryPop(Record& record) {
+    Slot& slot = slots[dequeue_position & mask];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeue_position + 1) {
+        return false;
+    }
+    record = std::move(slot.record);
+    slot.sequence.store(dequeue_position + mask + 1, std::memory_order_release);
+    ++dequeue_position;
+    return true;
+}
+
+void AsyncLogger::writerLoop() {
+    std::string batch;
+    while (true) {
+        drainBatch(batch);
+        if (!batch.empty()) {
+            std::lock_guard<std::mutex> lock(sink_mutex);
+            writeBatch(batch);
+            continue;
+        }
+        if (!running) {
+            return; // Drained after stop()
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        writer_idle.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        Slot& next = slots[dequeue_position & mask];
+        if (running && next.sequence.load(std::memory_order_acquire) != dequeue_position + 1) {
+            wake_cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+        writer_idle.store(false, std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogger::drainBatch(std::string& batch) {
+    batch.clear();
+    Record record;
+    size_t count = 0;
+    while (count < MAX_BATCH_RECORDS && tryPop(record)) {
+        formatRecord(batch, record);
+        ++count;
+    }
+    written.fetch_add(count, std::memory_order_relaxed);
+
+    uint64_t now_dropped = dropped.load(std::memory_order_relaxed);
+    if (now_dropped != reported_dropped) {
+        Record note = makeRecord(LogLevel::WARN,
+                                 std::to_string(now_dropped - reported_dropped) + " log records dropped (queue full)");
+        formatRecord(batch, note);
+        reported_dropped = now_dropped;
+    }
+}
+
+// Only the clock the writer will print is read
+AsyncLogger::Record AsyncLogger::makeRecord(LogLevel level, std::string text) const {
+    Record record;
+    if (config.monotonic_timestamps) {
+        record.monotonic_time = std::chrono::steady_clock::now();
+    } else {
+        record.time = std::chrono::system_clock::now();
+    }
+    record.level = level;
+    record.text = std::move(text);
+    return record;
+}
+
+void AsyncLogger::formatRecord(std::string& out, const Record& record) const {
+    if (config.monotonic_timestamps) {
+        appendMonotonicTime(out, record.monotonic_time);
+    } else {
+        appendClockTime(out, record.time);
+    }
+    out.append(levelTag(record.level)).append(record.text).push_back('\n');
+}
+
+bool AsyncLogger::openFile() {
+    file = std::fopen(config.file_path.c_str(), "ab");
+    if (!file) {
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    file_bytes = size > 0 ? static_cast<size_t>(size) : 0;
+    return true;
+}
+
+void AsyncLogger::rotateFile() {
+    std::fclose(file);
+    file = nullptr;
+    if (config.rotate_files > 0) {
+        std::string oldest = config.file_path + "." + std::to_string(config.rotate_files);
+        std::remove(oldest.c_str());
+        for (int i = config.rotate_files - 1; i >= 1; --i) {
+            std::string from = config.file_path + "." + std::to_string(i);
+            std::string to = config.file_path + "." + std::to_string(i + 1);
+            std::rename(from.c_str(), to.c_str());
+        }
+        std::string first = config.file_path + ".1";
+        std::rename(config.file_path.c_str(), first.c_str());
+    } else {
+        std::remove(config.file_path.c_str());
+    }
+    if (!openFile()) {
+        std::cerr << "Error: Could not reopen log file " << config.file_path << ", logging to stdout\n";
+        config.sink = LogSinkType::STDOUT;
+    }
+}
+
+// Caller holds sink_mutex. fflush hands the whole batch to one write call.
+void AsyncLogger::writeBatch(const std::string& batch) {
+    if (config.sink == LogSinkType::ROTATING_FILE && file) {
+        if (file_bytes > 0 && file_bytes + batch.size() > config.rotate_bytes) {
+            rotateFile();
+        }
+    }
+    std::FILE* out = (config.sink == LogSinkType::ROTATING_FILE && file) ? file : stdout;
+    std::fwrite(batch.data(), 1, batch.size(), out);
+    std::fflush(out);
+    if (out == file) {
+        file_bytes += batch.size();
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+enum class LogLevel {
+    INFO,
+    ERR,
+    CHAT,
+    WARN
+};
+
+enum class LogSinkType {
+    STDOUT,
+    ROTATING_FILE // Rotated by size: path, path.1, path.2, ...
+};
+
+const size_t DEFAULT_LOG_QUEUE_SIZE = 8192;
+const size_t DEFAULT_LOG_ROTATE_BYTES = 10 * 1024 * 1024;
+const int DEFAULT_LOG_ROTATE_FILES = 3;
+
+struct LogConfig {
+    LogSinkType sink;
+    std::string file_path;
+    size_t rotate_bytes; // Start a new file once the current one reaches this size
+    int rotate_files;    // Rotated files kept besides the current one
+    size_t queue_size;   // Records buffered before new ones are dropped
+    bool monotonic_timestamps; // Stamp records with microseconds since start instead of wall time
+
+    LogConfig() : sink(LogSinkType::STDOUT), file_path("server.log"),
+                  rotate_bytes(DEFAULT_LOG_ROTATE_BYTES), rotate_files(DEFAULT_LOG_ROTATE_FILES),
+                  queue_size(DEFAULT_LOG_QUEUE_SIZE), monotonic_timestamps(false) {}
+};
+
+const char* logSinkName(LogSinkType sink);
+bool parseLogSink(const std::string& name, LogSinkType& sink);
+
+// Asynchronous logger. Producers claim a slot in a bounded lock-free MPSC
+// ring and return at once; a full ring drops the record and counts it
+// instead of blocking. One writer thread drains the ring, formats the
+// timestamps and writes each batch of records with a single write.
+// Before start() and after stop() records are written synchronously.
+class AsyncLogger {
+public:
+    explicit AsyncLogger(const LogConfig& config = LogConfig());
+    ~AsyncLogger();
+
+    bool start();
+    // Writes everything already logged, then stops the writer thread
+    void stop();
+
+    // Returns false if the record was dropped
+    bool log(LogLevel level, std::string text);
+
+    uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t writtenRecords() const { return written.load(std::memory_order_relaxed); }
+    const LogConfig& getConfig() const { return config; }
+
+private:
+    struct Record {
+        std::chrono::system_clock::time_point time;
+        std::chrono::steady_clock::time_point monotonic_time; // Only with monotonic_timestamps
+        LogLevel level;
+        std::string text;
+    };
+
+    struct Slot {
+        std::atomic<uint64_t> sequence; // == position: free; position + 1: holds a record
+        Record record;
+    };
+
+    static constexpr size_t MAX_BATCH_RECORDS = 512;
+
+    LogConfig config;
+    std::unique_ptr<Slot[]> slots;
+    size_t mask;
+    alignas(64) std::atomic<uint64_t> enqueue_position;
+    alignas(64) uint64_t dequeue_position; // Writer thread only
+
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> written;
+    uint64_t reported_dropped; // Writer thread only
+
+    std::thread writer;
+    std::atomic<bool> running;
+    std::atomic<bool> writer_idle;
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+
+    std::mutex sink_mutex; // Serialises synchronous writes with the writer
+    std::FILE* file;
+    size_t file_bytes;
+
+    bool tryPush(Record& record);
+    bool tryPop(Record& record);
+    void writerLoop();
+    void drainBatch(std::string& batch);
+    Record makeRecord(LogLevel level, std::string text) const;
+    void formatRecord(std::string& out, const Record& record) const;
+    bool openFile();
+    void rotateFile();
+    void writeBatch(const std::string& batch);
+};
+
+#endif // ASYNC_LOGGER_H
@@ -0,0 +1,150 @@
+// Scaffolding for microbenchmarks that are tracked across versions: heap
+// allocation counting, a self-calibrating timing loop and JSON results.
+// Include it from the benchmark's main file only, since it replaces the
+// global operator new.
+//
+// Usage: <bench>.exe [--json <file>] [--label <text>] [--min-ms <ms>] [filter]
+// Only benchmarks whose name contains `filter` run. The JSON file holds
+// one object per benchmark with ns_per_op and allocs_per_op. `--label`
+// (e.g. a git revision) is copied into it so result files can be compared.
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace bench {
+inline std::atomic<uint64_t> allocations{0};
+}
+
+void* operator new(size_t size) {
+    bench::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace bench {
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double items_per_op; // Lines, recipients, ... handled by one op; 1 if not meaningful
+};
+
+class Suite {
+public:
+    Suite(const char* suite_name, int argc, char* argv[]) : suite(suite_name) {
+        for (int i = 1; i < argc; ++i) {
+            bool has_value = i + 1 < argc;
+            if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+                json_path = argv[++i];
+            } else if (std::strcmp(argv[i], "--label") == 0 && has_value) {
+                label = argv[++i];
+            } else if (std::strcmp(argv[i], "--min-ms") == 0 && has_value) {
+                min_ms = std::atof(argv[++i]);
+            } else {
+                filter = argv[i];
+            }
+        }
+        std::printf("%-36s %12s %10s %12s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op", "ns/item");
+    }
+
+    // op(i) performs iteration i and returns something derived from its
+    // work, which is accumulated so the compiler cannot drop it. The
+    // iteration count doubles until one timed batch lasts at least min_ms.
+    template <typename Op>
+    void run(const std::string& name, double items_per_op, Op op) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+        uint64_t iterations = 1;
+        while (true) {
+            uint64_t allocations_before = allocations.load(std::memory_order_relaxed);
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; ++i) {
+                checksum += static_cast<uint64_t>(op(static_cast<size_t>(i)));
+            }
+            double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+            if (elapsed_ns >= min_ms * 1e6 || iterations >= (uint64_t(1) << 40)) {
+                Result result{name, iterations, elapsed_ns / static_cast<double>(iterations),
+                              static_cast<double>(allocated) / static_cast<double>(iterations), items_per_op};
+                std::printf("%-36s %12llu %10.1f %12.2f %10.1f\n", name.c_str(),
+                            static_cast<unsigned long long>(iterations), result.ns_per_op, result.allocs_per_op,
+                            result.ns_per_op / items_per_op);
+                results.push_back(result);
+                return;
+            }
+            iterations *= 2;
+        }
+    }
+
+    // Writes the JSON file if one was asked for; returns the exit code
+    int finish() {
+        if (json_path.empty()) {
+            return 0;
+        }
+        FILE* out = std::fopen(json_path.c_str(), "w");
+        if (!out) {
+            std::fprintf(stderr, "Error: cannot write %s\n", json_path.c_str());
+            return 1;
+        }
+        std::fprintf(out, "{\n  \"suite\": \"%s\",\n  \"label\": \"%s\",\n  \"timestamp\": %lld,\n",
+                     escape(suite).c_str(), escape(label).c_str(), static_cast<long long>(std::time(nullptr)));
+        std::fprintf(out, "  \"compiler\": \"%s\",\n  \"results\": [\n", escape(__VERSION__).c_str());
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& result = results[i];
+            std::fprintf(out,
+                         "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, "
+                         "\"allocs_per_op\": %.3f, \"items_per_op\": %.0f}%s\n",
+                         escape(result.name).c_str(), static_cast<unsigned long long>(result.iterations),
+                         result.ns_per_op, result.allocs_per_op, result.items_per_op,
+                         i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(out, "  ],\n  \"checksum\": %llu\n}\n", static_cast<unsigned long long>(checksum));
+        std::fclose(out);
+        std::printf("Results written to %s\n", json_path.c_str());
+        return 0;
+    }
+
+private:
+    std::string suite;
+    std::string json_path;
+    std::string label;
+    std::string filter;
+    double min_ms = 200;
+    uint64_t checksum = 0;
+    std::vector<Result> results;
+
+    static std::string escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out.push_back('\\');
+                out.push_back(c);
+            } else if (static_cast<unsigned char>(c) >= 0x20) {
+                out.push_back(c);
+            }
+        }
+        return out;
+    }
+};
+
+} // namespace bench
+
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,90 @@
+// Compares the string_view command parser with the istringstream parsing it
+// replaced, using the harness in bench_harness.h for timing, allocation
+// counts and JSON output.
+#include "bench_harness.h"
+#include "../command_parser.h"
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char* const INPUTS[] = {
+    "/pm bob hello there, how are you doing today?",
+    "/list",
+    "/list ab 2",
+    "/help",
+    "/quit",
+    "/unknown with some args",
+};
+
+// What processMessage did before: istringstream, string tokens, if/else chain
+static size_t legacyParse(const std::string& message) {
+    std::istringstream iss(message);
+    std::string command;
+    iss >> command;
+    if (command == "/quit") {
+        return 1;
+    } else if (command == "/list") {
+        std::string prefix, arg;
+        size_t page = 1;
+        while (iss >> arg) {
+            if (arg.find_first_not_of("0123456789") == std::string::npos && arg.size() < 10) {
+                page = std::stoul(arg);
+            } else {
+                prefix = arg;
+            }
+        }
+        return 2 + prefix.size() + page;
+    } else if (command == "/help") {
+        return 3;
+    } else if (command == "/pm") {
+        std::string target, pm_message;
+        iss >> target;
+        std::getline(iss, pm_message);
+        if (!pm_message.empty()) {
+            pm_message = pm_message.substr(1);
+        }
+        return 4 + target.size() + pm_message.size();
+    }
+    return 0;
+}
+
+static size_t viewParse(std::string_view message) {
+    std::string_view args = message;
+    switch (lookupCommand(nextToken(args))) {
+        case ChatCommand::QUIT:
+            return 1;
+        case ChatCommand::LIST: {
+            std::string_view prefix;
+            size_t page = 1;
+            for (std::string_view arg = nextToken(args); !arg.empty(); arg = nextToken(args)) {
+                if (!parseCount(arg, page)) {
+                    prefix = arg;
+                }
+            }
+            return 2 + prefix.size() + page;
+        }
+        case ChatCommand::HELP:
+            return 3;
+        case ChatCommand::PM: {
+            std::string_view target = nextToken(args);
+            if (!args.empty()) {
+                args.remove_prefix(1);
+            }
+            return 4 + target.size() + args.size();
+        }
+        default:
+            return 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("command_parser", argc, argv);
+    std::vector<std::string> inputs(std::begin(INPUTS), std::end(INPUTS));
+    suite.run("parse/istringstream", 1, [&](size_t i) {
+        return legacyParse(inputs[i % inputs.size()]);
+    });
+    suite.run("parse/string_view", 1, [&](size_t i) {
+        return viewParse(inputs[i % inputs.size()]);
+    });
+    return suite.finish();
+}
@@ -0,0 +1,198 @@
+// The per-message hot paths, measured in isolation so changes to them can be
+// tracked across versions (see bench_harness.h for options and JSON):
+// - interserver/*: ServerMessage and ServerInfo serialization, as sent and
+//   received for every forwarded message, and the in-place frame decode
+// - command/*: slash-command tokenizing with the real parser functions
+// - lines/*: newline framing and "\r\n" stripping of client input
+// - broadcast/*: one chat line formatted once and fanned out to N
+//   in-memory output queues, which are then drained as one writev each
+#include "bench_harness.h"
+#include "../binary_frame.h"
+#include "../command_parser.h"
+#include "../interserver_protocol.h"
+#include "../line_decoder.h"
+#include "../metrics.h"
+#include "../message_buffer.h"
+#include "../outbound_queue.h"
+#include "../timestamp_cache.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+static void interserverBenchmarks(bench::Suite& suite) {
+    const std::string server_id = "SERVER_k3J9xQ2a";
+    ServerMessage message(ServerMessageType::MSG_FORWARD_PUBLIC, server_id,
+                          "[12:34:56] [alice]: has anyone seen the build logs from this morning?");
+    std::string wire = serializeServerMessage(message);
+    suite.run("interserver/serialize_message", 1, [&](size_t) {
+        return serializeServerMessage(message).size();
+    });
+    suite.run("interserver/deserialize_message", 1, [&](size_t) {
+        return deserializeServerMessage(wire).payload.size();
+    });
+    // What a link's receive loop does per frame before handing it on
+    suite.run("interserver/decode_view", 1, [&](size_t) {
+        ServerMessageView view;
+        size_t consumed = 0;
+        return decodeServerMessage(wire, view, consumed) == ServerDecodeStatus::OK ? view.payload.size() : 0;
+    });
+
+    ServerInfo info(server_id, "chat-eu-west-2", "10.0.12.34", 8081);
+    info.current_clients = 37;
+    std::string info_wire = serializeServerInfo(info);
+    suite.run("interserver/serialize_info", 1, [&](size_t) {
+        return serializeServerInfo(info).size();
+    });
+    suite.run("interserver/deserialize_info", 1, [&](size_t) {
+        return static_cast<size_t>(deserializeServerInfo(info_wire).current_clients);
+    });
+}
+
+// The token work processMessage and its handlers do per command, built from
+// lookupCommand, nextToken and parseCount. ChatServer's dispatch table itself
+// needs a running server, so handler cost is not included.
+static size_t tokenizeCommand(std::string_view message) {
+    std::string_view args = message;
+    ChatCommand command = lookupCommand(nextToken(args));
+    size_t work = static_cast<size_t>(command);
+    switch (command) {
+        case ChatCommand::LIST:
+        case ChatCommand::ROOMS:
+        case ChatCommand::HISTORY:
+            for (std::string_view arg = nextToken(args); !arg.empty(); arg = nextToken(args)) {
+                size_t count = 0;
+                work += parseCount(arg, count) ? count : arg.size();
+            }
+            break;
+        case ChatCommand::PM: {
+            std::string_view target = nextToken(args);
+            if (!args.empty()) {
+                args.remove_prefix(1);
+            }
+            work += target.size() + args.size();
+            break;
+        }
+        case ChatCommand::JOIN:
+        case ChatCommand::PART:
+            work += nextToken(args).size();
+            break;
+        default:
+            work += args.size();
+            break;
+    }
+    return work;
+}
+
+static void commandBenchmarks(bench::Suite& suite) {
+    static const char* const INPUTS[] = {
+        "/pm bob hello there, how are you doing today?",
+        "/list",
+        "/list ab 2",
+        "/join engineering",
+        "/history 20",
+        "/search build failure",
+        "/help",
+        "/unknown with some args",
+    };
+    std::vector<std::string> inputs(std::begin(INPUTS), std::end(INPUTS));
+    suite.run("command/tokenize_mixed", 1, [&](size_t i) {
+        return tokenizeCommand(inputs[i % inputs.size()]);
+    });
+    suite.run("command/tokenize_pm", 1, [&](size_t) {
+        return tokenizeCommand(inputs[0]);
+    });
+}
+
+// One recv's worth of pipelined client input: 16 "\r\n"-terminated lines
+static void lineBenchmarks(bench::Suite& suite) {
+    const size_t lines_per_chunk = 16;
+    std::string chunk;
+    for (size_t i = 0; i < lines_per_chunk; ++i) {
+        chunk.append("message number ").append(std::to_string(i)).append(" from a pasted block of text\r\n");
+    }
+    LineDecoder decoder;
+    suite.run("lines/decode_crlf_x16", static_cast<double>(lines_per_chunk), [&](size_t) {
+        size_t total = 0;
+        decoder.append(chunk.data(), chunk.size());
+        std::string_view line;
+        while (decoder.next(line) == LineDecoder::Status::LINE) {
+            total += line.size();
+        }
+        return total;
+    });
+
+    // A line split over two reads, as when a client types slowly
+    std::string first = "half of a line that arrives in ";
+    std::string second = "two separate reads\n";
+    suite.run("lines/decode_split", 1, [&](size_t) {
+        size_t total = 0;
+        std::string_view line;
+        decoder.append(first.data(), first.size());
+        total += decoder.next(line) == LineDecoder::Status::LINE ? line.size() : 0;
+        decoder.append(second.data(), second.size());
+        total += decoder.next(line) == LineDecoder::Status::LINE ? line.size() : 0;
+        return total;
+    });
+}
+
+// What processMessage and broadcastToRoom do for a public line: format it
+// once, share it between every text recipient (binary recipients get their
+// own frame), then each queue is drained the way a writev would drain it.
+static void broadcastBenchmarks(bench::Suite& suite) {
+    const std::string username = "alice";
+    const std::string text = "has anyone seen the build logs from this morning?";
+    OutboundSlice slices[64];
+
+    for (size_t recipients : {1, 10, 100, 1000}) {
+        for (bool binary : {false, true}) {
+            std::vector<std::unique_ptr<OutboundQueue>> queues;
+            for (size_t r = 0; r < recipients; ++r) {
+                queues.push_back(std::make_unique<OutboundQueue>());
+            }
+            std::string name = std::string("broadcast/") + (binary ? "binary" : "text") + "/" +
+                               std::to_string(recipients);
+            suite.run(name, static_cast<double>(recipients), [&](size_t) {
+                std::string line;
+                line.reserve(CLOCK_TIME_LENGTH + username.size() + text.size() + 6);
+                appendClockTime(line);
+                line.append(" [").append(username).append("]: ").append(text).push_back('\n');
+                MessageBuffer buffer = makeMessageBuffer(std::move(line));
+                uint64_t now = metricsNowNs();
+                for (auto& queue : queues) {
+                    if (binary) {
+                        std::string_view payload(*buffer);
+                        payload.remove_suffix(1);
+                        queue->push(makeMessageBuffer(encodeFrame(FrameType::CHAT, 0, 0, payload)), now);
+                    } else {
+                        queue->push(buffer, now);
+                    }
+                }
+                size_t written = 0;
+                for (auto& queue : queues) {
+                    size_t count = queue->prepare(slices, 64);
+                    size_t bytes = 0;
+                    for (size_t s = 0; s < count; ++s) {
+                        #ifdef _WIN32
+                        bytes += slices[s].len;
+                        #else
+                        bytes += slices[s].iov_len;
+                        #endif
+                    }
+                    queue->consume(bytes);
+                    written += bytes;
+                }
+                return written;
+            });
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bench::Suite suite("hot_paths", argc, argv);
+    interserverBenchmarks(suite);
+    commandBenchmarks(suite);
+    lineBenchmarks(suite);
+    broadcastBenchmarks(suite);
+    return suite.finish();
+}
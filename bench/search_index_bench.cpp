@@ -0,0 +1,93 @@
+// Indexing rate and query latency of the search index: synthetic chat
+// messages drawn from a skewed vocabulary are indexed, the background
+// thread finishes sealing and merging, then a mix of queries is timed.
+// Usage: bench_search_index.exe [messages] [words_per_message] [vocabulary]
+#include "../search_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[static_cast<size_t>(p * (samples.size() - 1))];
+}
+
+int main(int argc, char* argv[]) {
+    size_t messages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    size_t words_per_message = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 12;
+    size_t vocabulary = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 50000;
+
+    std::vector<std::string> words;
+    words.reserve(vocabulary);
+    for (size_t i = 0; i < vocabulary; ++i) {
+        words.push_back("w" + std::to_string(i * 7919 % 1000003));
+    }
+    // Word rank ~ exp(uniform): a few very common words, a long tail of rare ones
+    std::mt19937_64 random(42);
+    std::exponential_distribution<double> skew(8.0 / static_cast<double>(vocabulary));
+    auto pick = [&]() -> const std::string& {
+        return words[static_cast<size_t>(skew(random)) % vocabulary];
+    };
+
+    SearchIndex index;
+    index.start();
+    std::string text;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t id = 1; id <= messages; ++id) {
+        text.clear();
+        for (size_t w = 0; w < words_per_message; ++w) {
+            text.append(pick()).push_back(' ');
+        }
+        index.add(id, text);
+    }
+    double add_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    index.stop(); // Seals and merges whatever is still queued
+    double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::printf("messages=%zu words_per_message=%zu vocabulary=%zu\n", messages, words_per_message, vocabulary);
+    std::printf("adds/sec      %12.0f (%.2f s, %.2f s with sealing and merging)\n", messages / add_seconds,
+                add_seconds, total_seconds);
+    std::printf("segments      %12zu\n", index.segmentCount());
+    std::printf("index bytes   %12zu (%.1f per message)\n", index.postingBytes(),
+                static_cast<double>(index.postingBytes()) / messages);
+
+    struct QueryKind {
+        const char* name;
+        std::string (*make)(const std::vector<std::string>&, std::mt19937_64&);
+    };
+    const QueryKind kinds[] = {
+        {"common word", [](const std::vector<std::string>& v, std::mt19937_64& r) { return v[r() % 10]; }},
+        {"rare word", [](const std::vector<std::string>& v, std::mt19937_64& r) {
+             return v[v.size() / 2 + r() % (v.size() / 2)];
+         }},
+        {"common AND mid", [](const std::vector<std::string>& v, std::mt19937_64& r) {
+             return v[r() % 10] + " " + v[100 + r() % 1000];
+         }},
+        {"mid AND mid", [](const std::vector<std::string>& v, std::mt19937_64& r) {
+             return v[100 + r() % 1000] + " " + v[100 + r() % 1000];
+         }},
+        {"prefix", [](const std::vector<std::string>& v, std::mt19937_64& r) {
+             return v[r() % v.size()].substr(0, 4) + "*";
+         }},
+    };
+    std::printf("%-16s %10s %10s %10s\n", "query (limit 20)", "p50 ms", "p99 ms", "hits");
+    for (const QueryKind& kind : kinds) {
+        std::vector<double> samples;
+        size_t hits = 0;
+        for (int i = 0; i < 200; ++i) {
+            std::string query = kind.make(words, random);
+            auto query_start = std::chrono::steady_clock::now();
+            hits += index.search(query, 20).size();
+            samples.push_back(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - query_start).count());
+        }
+        double p50 = percentile(samples, 0.5);
+        double p99 = percentile(samples, 0.99);
+        std::printf("%-16s %10.3f %10.3f %10.1f\n", kind.name, p50, p99, hits / 200.0);
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+// Cost of the timing wheel with many pending timers: schedule, cancel and
+// re-arm (the per-connection keepalive pattern), then the cost per tick
+// while simulated time passes and timers fire and are re-armed.
+// Usage: bench_timing_wheel.exe [timers] [tick_ms] [simulated_seconds]
+#include "../timing_wheel.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    size_t timers = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    int tick_ms = argc > 2 ? std::atoi(argv[2]) : 100;
+    int simulated_seconds = argc > 3 ? std::atoi(argv[3]) : 600;
+
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point origin = Clock::now();
+    TimingWheel wheel(std::chrono::milliseconds(tick_ms), origin);
+    std::mt19937_64 random(7);
+    // Handshake, keepalive and idle style delays: 1 s to 2 min
+    auto delay = [&]() { return std::chrono::milliseconds(1000 + random() % 119000); };
+
+    std::vector<TimingWheel::TimerId> ids(timers);
+    auto start = Clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        ids[i] = wheel.schedule(delay(), i);
+    }
+    double schedule_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / timers;
+
+    start = Clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        wheel.cancel(ids[i]);
+        ids[i] = wheel.schedule(delay(), i);
+    }
+    double rearm_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / timers;
+
+    // Every timer that fires is re-armed, so the wheel stays at `timers`
+    std::vector<uint64_t> expired;
+    std::vector<double> tick_us;
+    uint64_t fired = 0;
+    int ticks = simulated_seconds * 1000 / tick_ms;
+    for (int t = 1; t <= ticks; ++t) {
+        Clock::time_point now = origin + std::chrono::milliseconds(static_cast<int64_t>(t) * tick_ms);
+        auto tick_start = Clock::now();
+        expired.clear();
+        wheel.advance(now, expired);
+        for (uint64_t data : expired) {
+            ids[data] = wheel.schedule(delay(), data);
+        }
+        tick_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - tick_start).count());
+        fired += expired.size();
+    }
+    std::sort(tick_us.begin(), tick_us.end());
+    double total_us = 0;
+    for (double us : tick_us) {
+        total_us += us;
+    }
+
+    std::printf("timers=%zu tick_ms=%d simulated_seconds=%d\n", timers, tick_ms, simulated_seconds);
+    std::printf("schedule          %8.1f ns\n", schedule_ns);
+    std::printf("cancel+schedule   %8.1f ns\n", rearm_ns);
+    std::printf("fired and re-armed %7llu\n", static_cast<unsigned long long>(fired));
+    std::printf("per tick: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", total_us / tick_us.size(),
+                tick_us[tick_us.size() / 2], tick_us[tick_us.size() * 99 / 100], tick_us.back());
+    std::printf("per pending timer per tick %.2f ns\n", total_us * 1000.0 / tick_us.size() / timers);
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include "binary_frame.h"
+#include <algorithm>
+#include <cstring>
+
+static void putUint32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value >> 24);
+    out[1] = static_cast<char>(value >> 16);
+    out[2] = static_cast<char>(value >> 8);
+    out[3] = static_cast<char>(value);
+}
+
+static uint32_t getUint32(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+bool isBinaryHandshake(std::string_view line) {
+    return line == std::string_view(BINARY_HANDSHAKE, BINARY_HANDSHAKE_LENGTH);
+}
+
+void encodeFrameHeader(char* out, const FrameHeader& header) {
+    out[0] = static_cast<char>(header.type);
+    out[1] = static_cast<char>(header.flags);
+    out[2] = 0;
+    out[3] = 0;
+    putUint32(out + 4, header.length);
+    putUint32(out + 8, header.sequence);
+}
+
+FrameHeader decodeFrameHeader(const char* in) {
+    FrameHeader header;
+    header.type = static_cast<FrameType>(static_cast<unsigned char>(in[0]));
+    header.flags = static_cast<uint8_t>(in[1]);
+    header.length = getUint32(in + 4);
+    header.sequence = getUint32(in + 8);
+    return header;
+}
+
+std::string encodeFrame(FrameType type, uint8_t flags, uint32_t sequence, std::string_view payload) {
+    std::string frame(FRAME_HEADER_SIZE, '\0');
+    encodeFrameHeader(&frame[0], FrameHeader{type, flags, static_cast<uint32_t>(payload.size()), sequence});
+    frame.append(payload);
+    return frame;
+}
+
+FrameDecoder::FrameDecoder(size_t max_payload)
+    : max_payload(max_payload), head(0), tail(0), skip_remaining(0) {
+    // Room for a whole frame plus the start of the next one
+    size_t capacity = 4096;
+    while (capacity < 2 * (FRAME_HEADER_SIZE + max_payload)) {
+        capacity <<= 1;
+    }
+    buffer.resize(capacity);
+}
+
+char* FrameDecoder::writePtr() {
+    return buffer.data() + tail;
+}
+
+size_t FrameDecoder::writableBytes() const {
+    return buffer.size() - tail;
+}
+
+void FrameDecoder::commit(size_t bytes) {
+    tail += bytes;
+}
+
+size_t FrameDecoder::append(const char* data, size_t length) {
+    size_t chunk = std::min(length, writableBytes());
+    std::memcpy(writePtr(), data, chunk);
+    commit(chunk);
+    return chunk;
+}
+
+FrameDecoder::Status FrameDecoder::next(FrameHeader& header, std::string_view& payload) {
+    if (skip_remaining > 0) {
+        size_t dropped = static_cast<size_t>(std::min<uint64_t>(skip_remaining, tail - head));
+        head += dropped;
+        skip_remaining -= dropped;
+    }
+
+    if (skip_remaining == 0 && tail - head >= FRAME_HEADER_SIZE) {
+        header = decodeFrameHeader(buffer.data() + head);
+        if (header.length > max_payload) {
+            head += FRAME_HEADER_SIZE;
+            skip_remaining = header.length;
+            size_t dropped = static_cast<size_t>(std::min<uint64_t>(skip_remaining, tail - head));
+            head += dropped;
+            skip_remaining -= dropped;
+            return Status::TOO_LONG;
+        }
+        if (tail - head >= FRAME_HEADER_SIZE + header.length) {
+            payload = std::string_view(buffer.data() + head + FRAME_HEADER_SIZE, header.length);
+            head += FRAME_HEADER_SIZE + header.length;
+            return Status::FRAME;
+        }
+    }
+
+    // Move the partial frame to the front so the rest can be received behind it
+    if (head == tail) {
+        head = tail = 0;
+    } else if (head > 0) {
+        std::memmove(buffer.data(), buffer.data() + head, tail - head);
+        tail -= head;
+        head = 0;
+    }
+    return Status::NEED_MORE;
+}
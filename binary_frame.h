@@ -0,0 +1,100 @@
+#ifndef BINARY_FRAME_H
+#define BINARY_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Optional binary client protocol.
+//
+// A client opts in by sending BINARY_HANDSHAKE as its first line. The
+// server answers with a HELLO frame; from then on both directions carry
+// frames instead of text lines:
+//
+//   offset 0  uint8   type      FrameType
+//   offset 1  uint8   flags     FRAME_FLAG_*
+//   offset 2  uint16  reserved  0
+//   offset 4  uint32  length    payload bytes
+//   offset 8  uint32  sequence  set by the sender of a request; a reply
+//                               echoes it with FRAME_FLAG_REPLY, other
+//                               server frames carry 0
+//   offset 12 payload
+//
+// Integers are big-endian. Payloads are arbitrary bytes and need no
+// escaping or delimiter scanning. The text protocol never sends a NUL byte,
+// and HELLO starts with one, so a client can skip the text welcome prompt
+// by discarding everything up to the first NUL.
+
+const char BINARY_HANDSHAKE[] = "\0CHB1"; // Sent as a line: these 5 bytes, then '\n'
+const size_t BINARY_HANDSHAKE_LENGTH = 5;
+const size_t FRAME_HEADER_SIZE = 12;
+
+// Values 1-6 are the former ChatServer::MessageType numbers
+enum class FrameType : uint8_t {
+    HELLO = 0,       // Server: binary mode accepted; payload names the protocol
+    JOIN = 1,        // Client: payload is the username
+    LEAVE = 2,       // Client: leave the chat (like /quit)
+    CHAT = 3,        // Client: a message or slash command; server: a chat line
+    LIST_USERS = 4,  // Server: /list output
+    PRIVATE = 5,     // Server: private message or its confirmation
+    SERVER_INFO = 6, // Server: prompts, notices and errors
+    LIST_ROOMS = 7,  // Server: /rooms output
+    SEARCH_RESULTS = 8, // Server: /search output
+    PING = 9,        // Either side: keepalive; the peer answers PONG
+    PONG = 10        // Either side: answers PING
+};
+
+const uint8_t FRAME_FLAG_REPLY = 0x01; // Answers the request with the same sequence
+
+struct FrameHeader {
+    FrameType type;
+    uint8_t flags;
+    uint32_t length;
+    uint32_t sequence;
+};
+
+bool isBinaryHandshake(std::string_view line);
+
+void encodeFrameHeader(char* out, const FrameHeader& header);
+FrameHeader decodeFrameHeader(const char* in);
+
+// Header plus payload, ready to send
+std::string encodeFrame(FrameType type, uint8_t flags, uint32_t sequence, std::string_view payload);
+
+// Incremental frame parser over a per-connection receive buffer, the binary
+// counterpart of LineDecoder. Frames whose payload exceeds max_payload are
+// skipped without being buffered.
+class FrameDecoder {
+public:
+    enum class Status {
+        FRAME,      // `header` and `payload` hold the next frame
+        NEED_MORE,  // No complete frame buffered
+        TOO_LONG    // A frame exceeded the limit and is being skipped
+    };
+
+    explicit FrameDecoder(size_t max_payload);
+
+    // Contiguous free space for recv(); commit() what was written
+    char* writePtr();
+    size_t writableBytes() const;
+    void commit(size_t bytes);
+
+    // Copies as much of data as fits and returns the number of bytes taken
+    size_t append(const char* data, size_t length);
+
+    // The payload view stays valid until the next call to any method
+    Status next(FrameHeader& header, std::string_view& payload);
+
+    size_t buffered() const { return tail - head; }
+
+private:
+    std::vector<char> buffer;
+    size_t max_payload;
+    size_t head;              // First unconsumed byte
+    size_t tail;              // One past the last received byte
+    uint64_t skip_remaining;  // Payload bytes of an over-long frame still to drop
+};
+
+#endif // BINARY_FRAME_H
@@ -15,7 +15,7 @@ if %ERRORLEVEL% NEQ 0 (
 
 REM Build server
 echo Building server...
-g++ -std=c++17 -Wall -Wextra -g -pthread server.cpp server_manager.cpp config_manager.cpp interserver_protocol.cpp -o server.exe -lws2_32
+g++ -std=c++17 -Wall -Wextra -g -pthread server.cpp server_manager.cpp config_manager.cpp interserver_protocol.cpp io_uring_ring.cpp line_decoder.cpp outbound_queue.cpp user_directory.cpp async_logger.cpp timestamp_cache.cpp command_parser.cpp binary_frame.cpp message_history.cpp message_store.cpp search_index.cpp offline_mailbox.cpp timing_wheel.cpp metrics.cpp metrics_endpoint.cpp -o server.exe -lws2_32
 if %ERRORLEVEL% NEQ 0 (
     echo Error building server!
     pause
@@ -24,13 +24,22 @@ if %ERRORLEVEL% NEQ 0 (
 
 REM Build client
 echo Building client...
-g++ -std=c++17 -Wall -Wextra -g -pthread client.cpp -o client.exe -lws2_32
+g++ -std=c++17 -Wall -Wextra -g -pthread client.cpp chat_client.cpp binary_frame.cpp -o client.exe -lws2_32
 if %ERRORLEVEL% NEQ 0 (
     echo Error building client!
     pause
     exit /b 1
 )
 
+REM Build load generator
+echo Building load generator...
+g++ -std=c++17 -Wall -Wextra -O2 -pthread chat_loadgen.cpp chat_client.cpp binary_frame.cpp metrics.cpp -o chat_loadgen.exe -lws2_32
+if %ERRORLEVEL% NEQ 0 (
+    echo Error building load generator!
+    pause
+    exit /b 1
+)
+
 echo.
 echo Build successful!
 echo.
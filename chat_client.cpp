@@ -0,0 +1,328 @@
+#include "chat_client.h"
+#include "binary_frame.h"
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+#ifdef _WIN32
+    #pragma comment(lib, "ws2_32.lib")
+#endif
+
+static int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ChatClient::ChatClient(const std::string& host, int port, bool binary)
+    : client_socket(INVALID_SOCKET), connected(false), running(false), server_host(host), server_port(port),
+      binary_mode(binary), joined(false), next_sequence(1), quiet(false), ping_sent_ns(0) {
+    #ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        throw std::runtime_error("WSAStartup failed");
+    }
+    #endif
+}
+
+ChatClient::~ChatClient() {
+    disconnect();
+    #ifdef _WIN32
+    WSACleanup();
+    #endif
+}
+
+bool ChatClient::connect() {
+    client_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (client_socket == INVALID_SOCKET) {
+        std::cerr << "Error: Failed to create socket\n";
+        return false;
+    }
+
+    sockaddr_in server_addr{};
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(server_port);
+
+    // Convert hostname to IP if necessary
+    if (inet_addr(server_host.c_str()) == INADDR_NONE) {
+        struct hostent* he = gethostbyname(server_host.c_str());
+        if (he == nullptr) {
+            std::cerr << "Error: Could not resolve hostname " << server_host << "\n";
+            close(client_socket);
+            client_socket = INVALID_SOCKET;
+            return false;
+        }
+        server_addr.sin_addr = *((struct in_addr*)he->h_addr);
+    } else {
+        server_addr.sin_addr.s_addr = inet_addr(server_host.c_str());
+    }
+
+    if (!quiet) {
+        std::cout << "Connecting to " << server_host << ":" << server_port << "...\n";
+    }
+
+    if (::connect(client_socket, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
+        std::cerr << "Error: Failed to connect to server\n";
+        close(client_socket);
+        client_socket = INVALID_SOCKET;
+        return false;
+    }
+
+    // Chat lines are small and latency-bound; don't let Nagle hold them back
+    int nodelay = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+
+    connected = true;
+    running = true;
+    if (!quiet) {
+        std::cout << "Connected successfully!\n";
+    }
+
+    if (binary_mode) {
+        // Request binary framing before the server reads a username
+        std::string handshake(BINARY_HANDSHAKE, BINARY_HANDSHAKE_LENGTH);
+        handshake.push_back('\n');
+        sendRaw(handshake);
+    }
+
+    return true;
+}
+
+void ChatClient::disconnect() {
+    running = false;
+    connected = false;
+    if (client_socket != INVALID_SOCKET) {
+        close(client_socket);
+        client_socket = INVALID_SOCKET;
+    }
+}
+
+void ChatClient::run() {
+    if (!connected) {
+        std::cerr << "Error: Not connected to server\n";
+        return;
+    }
+
+    // Start message receiving thread
+    std::thread receive_thread(&ChatClient::receiveMessages, this);
+
+    // Handle user input in main thread
+    handleUserInput();
+
+    // Wait for receive thread to finish
+    if (receive_thread.joinable()) {
+        receive_thread.join();
+    }
+}
+
+void ChatClient::sendMessage(const std::string& message) {
+    if (!connected || message.empty()) {
+        return;
+    }
+
+    if (binary_mode) {
+        // The first line is the username, as in the text protocol
+        FrameType type = FrameType::CHAT;
+        if (!joined) {
+            type = FrameType::JOIN;
+            joined = true;
+        } else if (message == "/quit") {
+            type = FrameType::LEAVE;
+        }
+        sendRaw(encodeFrame(type, 0, next_sequence++, type == FrameType::LEAVE ? "" : message));
+        return;
+    }
+
+    sendRaw(message + "\n");
+}
+
+void ChatClient::sendRaw(const std::string& data) {
+    int result = send(client_socket, data.c_str(), data.length(), 0);
+    if (result == SOCKET_ERROR) {
+        std::cerr << "Error: Failed to send message\n";
+        disconnect();
+    }
+}
+
+void ChatClient::printMessage(const std::string& line) {
+    // Clear current input line and print message
+    std::cout << "\r" << std::string(80, ' ') << "\r";
+    std::cout << line << std::endl;
+    std::cout << "> " << std::flush;
+}
+
+// The answer to our own /ping becomes a round-trip time
+void ChatClient::showLine(const std::string& line) {
+    int64_t sent = ping_sent_ns.load();
+    if (sent != 0 && line == "PONG" && ping_sent_ns.compare_exchange_strong(sent, 0)) {
+        char rtt[64];
+        std::snprintf(rtt, sizeof(rtt), "Round trip: %.3f ms", (steadyNs() - sent) / 1e6);
+        printMessage(rtt);
+        return;
+    }
+    printMessage(line);
+}
+
+void ChatClient::receiveFrames() {
+    FrameDecoder decoder(1 << 20);
+    bool hello_seen = false;
+    char buffer[4096];
+
+    while (running && connected) {
+        int bytes = recv(client_socket, buffer, sizeof(buffer), 0);
+        if (bytes <= 0) {
+            if (running) {
+                std::cout << "\nConnection to server lost.\n";
+            }
+            disconnect();
+            break;
+        }
+
+        const char* data = buffer;
+        size_t length = static_cast<size_t>(bytes);
+        if (!hello_seen) {
+            // Drop the text welcome prompt sent before the handshake was read
+            const char* nul = static_cast<const char*>(std::memchr(data, '\0', length));
+            if (nul == nullptr) {
+                continue;
+            }
+            hello_seen = true;
+            length -= static_cast<size_t>(nul - data);
+            data = nul;
+        }
+
+        while (length > 0) {
+            size_t taken = decoder.append(data, length);
+            data += taken;
+            length -= taken;
+
+            FrameHeader header;
+            std::string_view payload;
+            FrameDecoder::Status status;
+            while ((status = decoder.next(header, payload)) != FrameDecoder::Status::NEED_MORE) {
+                if (status == FrameDecoder::Status::FRAME && header.type == FrameType::PING) {
+                    sendRaw(encodeFrame(FrameType::PONG, 0, 0, ""));
+                } else if (status == FrameDecoder::Status::FRAME && header.type != FrameType::HELLO &&
+                           header.type != FrameType::PONG) {
+                    std::string text(payload);
+                    while (!text.empty() && text.back() == '\n') {
+                        text.pop_back();
+                    }
+                    if (!text.empty()) {
+                        showLine(text);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ChatClient::receiveMessages() {
+    if (binary_mode) {
+        receiveFrames();
+        return;
+    }
+
+    char buffer[1024];
+
+    while (running && connected) {
+        int bytes = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
+        if (bytes <= 0) {
+            if (running) {
+                std::cout << "\nConnection to server lost.\n";
+            }
+            disconnect();
+            break;
+        }
+
+        buffer[bytes] = '\0';
+
+        // Print received message, handling multiple messages in one buffer
+        std::string received(buffer);
+        size_t pos = 0;
+        std::string line;
+
+        while ((pos = received.find('\n')) != std::string::npos) {
+            line = received.substr(0, pos);
+            if (!line.empty()) {
+                showLine(line);
+            }
+            received.erase(0, pos + 1);
+        }
+
+        // Handle remaining text without newline
+        if (!received.empty()) {
+            std::cout << "\r" << std::string(80, ' ') << "\r";
+            std::cout << received << std::flush;
+            std::cout << "\n> " << std::flush;
+        }
+    }
+}
+
+void ChatClient::handleUserInput() {
+    std::string input;
+
+    // Show prompt
+    std::cout << "> " << std::flush;
+
+    while (running && connected && std::getline(std::cin, input)) {
+        if (input.empty()) {
+            std::cout << "> " << std::flush;
+            continue;
+        }
+
+        // Handle local commands
+        if (input == "/quit" || input == "/exit") {
+            std::cout << "Disconnecting...\n";
+            sendMessage("/quit");
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            disconnect();
+            break;
+        } else if (input == "/help") {
+            showLocalHelp();
+        } else if (input == "/clear") {
+            clearScreen();
+        } else if (input == "/ping") {
+            // Timed when the server's PONG comes back (see showLine)
+            ping_sent_ns = steadyNs();
+            sendMessage("/ping");
+        } else {
+            // Send message to server
+            sendMessage(input);
+        }
+
+        if (connected && running) {
+            std::cout << "> " << std::flush;
+        }
+    }
+}
+
+void ChatClient::showLocalHelp() {
+    std::cout << "\n=== Local Client Commands ===\n";
+    std::cout << "/quit, /exit  - Disconnect from server\n";
+    std::cout << "/help         - Show this help\n";
+    std::cout << "/clear        - Clear screen\n";
+    std::cout << "/ping         - Measure the round trip to the server\n";
+    std::cout << "\nServer commands (sent to server):\n";
+    std::cout << "/list [prefix] [page] - Show online users\n";
+    std::cout << "/pm <user> <message> - Private message\n";
+    std::cout << "/join <room>, /part [room], /rooms - Chat rooms\n";
+    std::cout << "/history [n] - Recent messages in the current room\n";
+    std::cout << "/search <words> - Search stored messages (word* for a prefix)\n";
+    std::cout << "Just type normally to send public messages\n\n";
+}
+
+void ChatClient::clearScreen() {
+    #ifdef _WIN32
+    system("cls");
+    #else
+    system("clear");
+    #endif
+
+    std::cout << "=== Chat Client ===\n";
+    std::cout << "Connected to " << server_host << ":" << server_port << "\n";
+    std::cout << "Type /help for commands\n\n";
+}
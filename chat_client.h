@@ -0,0 +1,69 @@
+#ifndef CHAT_CLIENT_H
+#define CHAT_CLIENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #define close closesocket
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    #include <netdb.h>
+    typedef int SOCKET;
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+#endif
+
+// One connection to a chat server. connect() and sendMessage() speak the
+// text or binary protocol; run() adds the interactive console on top.
+// chat_loadgen drives many of these without run(), reading the sockets
+// itself.
+class ChatClient {
+private:
+    SOCKET client_socket;
+    std::atomic<bool> connected;
+    std::atomic<bool> running;
+    std::string server_host;
+    int server_port;
+    std::string username;
+    bool binary_mode;        // Speak the framed protocol from binary_frame.h
+    bool joined;             // Binary mode: the JOIN frame has been sent
+    uint32_t next_sequence;  // Binary mode: sequence of the next request frame
+    bool quiet;              // No progress output from connect()
+    std::atomic<int64_t> ping_sent_ns; // Steady clock; 0 when no /ping is outstanding
+
+public:
+    ChatClient(const std::string& host = "127.0.0.1", int port = 8080, bool binary = false);
+    ~ChatClient();
+
+    bool connect();
+    void disconnect();
+    void run();
+
+    // The first message is the username; in binary mode it goes out as JOIN
+    void sendMessage(const std::string& message);
+
+    void setQuiet(bool value) { quiet = value; }
+    bool isConnected() const { return connected; }
+    bool isBinary() const { return binary_mode; }
+    SOCKET getSocket() const { return client_socket; }
+
+private:
+    void sendRaw(const std::string& data);
+    void printMessage(const std::string& line);
+    void showLine(const std::string& line);
+    void receiveFrames();
+    void receiveMessages();
+    void handleUserInput();
+    void showLocalHelp();
+    void clearScreen();
+};
+
+#endif // CHAT_CLIENT_H
@@ -0,0 +1,547 @@
+// Headless load generator: opens many ChatClient connections from a small
+// pool of threads, sends public and private messages at a fixed offered
+// rate and reports throughput and end-to-end latency.
+//
+// Every message carries "LG <send time>" (steady clock, nanoseconds), and
+// the connections that receive it record now - send time. Since sender and
+// receivers live in this one process they share the clock. The send time
+// is when the message was scheduled, not when send() returned, so a stalled
+// server shows up as latency instead of silently lowering the offered load.
+//
+// With --servers the connections are spread over several linked servers
+// (connection i on server i % count). Messages also carry the sender's
+// server, so public latency is reported separately for lines that stayed
+// on one server and lines that crossed a server link; private messages
+// stay on the sender's server, since users are not synced between servers.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "chat_client.h"
+#include "binary_frame.h"
+#include "metrics.h"
+
+#ifdef _WIN32
+    typedef WSAPOLLFD PollFd;
+    static int pollSockets(PollFd* fds, size_t count, int timeout_ms) {
+        return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+    }
+#else
+    #include <poll.h>
+    typedef pollfd PollFd;
+    static int pollSockets(PollFd* fds, size_t count, int timeout_ms) {
+        return poll(fds, static_cast<nfds_t>(count), timeout_ms);
+    }
+#endif
+
+struct LoadOptions {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::vector<std::pair<std::string, int>> servers; // --servers, else host:port alone
+    int connections = 100;
+    int threads = 4;
+    double rate = 1000;      // Messages per second, all connections together
+    int message_size = 64;   // Bytes of chat text per message
+    double pm_ratio = 0.1;   // Share of messages sent as /pm; the rest are public
+    int rooms = 1;           // Connections spread over this many rooms (1: everyone in the lobby)
+    double duration_s = 10;  // Measured sending time
+    double warmup_s = 1;     // Sent before the measurement, not recorded
+    double drain_s = 2;      // Keep reading after the last send
+    bool binary = false;
+    bool json = false;
+};
+
+// Per-thread results, merged at the end
+struct LoadStats {
+    LatencyHistogram public_latency;
+    LatencyHistogram private_latency;
+    LatencyHistogram local_latency;  // Public, sender on the receiver's server
+    LatencyHistogram remote_latency; // Public, forwarded from another server
+    uint64_t sent_public = 0;
+    uint64_t sent_private = 0;
+    uint64_t bytes_received = 0;
+    uint64_t connect_errors = 0;
+    uint64_t lost_connections = 0;
+
+    void merge(const LoadStats& other) {
+        public_latency.merge(other.public_latency);
+        private_latency.merge(other.private_latency);
+        local_latency.merge(other.local_latency);
+        remote_latency.merge(other.remote_latency);
+        sent_public += other.sent_public;
+        sent_private += other.sent_private;
+        bytes_received += other.bytes_received;
+        connect_errors += other.connect_errors;
+        lost_connections += other.lost_connections;
+    }
+};
+
+struct LoadConnection {
+    std::unique_ptr<ChatClient> client;
+    std::string input;                    // Text mode: bytes after the last newline
+    std::unique_ptr<FrameDecoder> frames; // Binary mode
+    bool hello_seen = false;              // Binary mode: the text prompt before HELLO is skipped
+    size_t server = 0;                    // Index into options.servers
+};
+
+static int64_t nowNs() {
+    return static_cast<int64_t>(metricsNowNs());
+}
+
+static std::string userName(int run_id, int index) {
+    return "lg" + std::to_string(run_id) + "_" + std::to_string(index);
+}
+
+class LoadWorker {
+public:
+    LoadWorker(const LoadOptions& options, const std::vector<std::string>& names, int first, int count, int seed)
+        : options(options), names(names), first(first), random(static_cast<uint32_t>(seed)) {
+        connections.resize(static_cast<size_t>(count));
+    }
+
+    // Connects and joins every connection of this worker
+    void setUp() {
+        for (size_t i = 0; i < connections.size(); ++i) {
+            LoadConnection& connection = connections[i];
+            int index = first + static_cast<int>(i);
+            connection.server = static_cast<size_t>(index) % options.servers.size();
+            const auto& server = options.servers[connection.server];
+            connection.client = std::make_unique<ChatClient>(server.first, server.second, options.binary);
+            connection.client->setQuiet(true);
+            if (!connection.client->connect()) {
+                ++stats.connect_errors;
+                continue;
+            }
+            if (options.binary) {
+                connection.frames = std::make_unique<FrameDecoder>(1 << 20);
+            }
+            connection.client->sendMessage(names[static_cast<size_t>(index)]);
+            if (options.rooms > 1) {
+                connection.client->sendMessage("/join lg" + std::to_string(index % options.rooms));
+            }
+        }
+    }
+
+    // Reads and discards until `until` (join notices, welcome text)
+    void settle(int64_t until) {
+        while (nowNs() < until) {
+            pollOnce(static_cast<int>(std::max<int64_t>(1, (until - nowNs()) / 1000000)), 0);
+        }
+    }
+
+    // Sends this worker's share of the rate from `start` until `stop`, then
+    // keeps reading until `drain_until`. Only messages scheduled at or after
+    // `measure_from` are counted.
+    void run(int64_t start, int64_t measure_from, int64_t stop, int64_t drain_until, double rate) {
+        record_from = measure_from;
+        int64_t interval = rate > 0 ? static_cast<int64_t>(1e9 / rate) : 0;
+        int64_t next_send = start;
+        size_t next_connection = 0;
+        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        std::string text;
+        size_t server_count = options.servers.size();
+
+        while (true) {
+            int64_t now = nowNs();
+            if (now >= drain_until) {
+                break;
+            }
+            while (interval > 0 && next_send <= now && next_send < stop) {
+                LoadConnection* connection = nextLive(next_connection);
+                if (!connection) {
+                    break;
+                }
+                // Private messages go to another user on the same server
+                size_t self = static_cast<size_t>(first) + static_cast<size_t>(connection - connections.data());
+                size_t peers = (names.size() - connection->server + server_count - 1) / server_count;
+                bool is_private = peers > 1 && coin(random) < options.pm_ratio;
+                text.clear();
+                if (is_private) {
+                    size_t target = connection->server + server_count * (random() % peers);
+                    if (target == self) {
+                        target = connection->server + server_count * ((self / server_count + 1) % peers);
+                    }
+                    text.append("/pm ").append(names[target]).push_back(' ');
+                }
+                size_t body_start = text.size();
+                text.append("LG ").append(std::to_string(next_send)).push_back(' ');
+                text.append(std::to_string(connection->server)).push_back(' ');
+                if (text.size() - body_start < static_cast<size_t>(options.message_size)) {
+                    text.append(static_cast<size_t>(options.message_size) - (text.size() - body_start), 'x');
+                }
+                connection->client->sendMessage(text);
+                if (next_send >= record_from) {
+                    ++(is_private ? stats.sent_private : stats.sent_public);
+                }
+                next_send += interval;
+            }
+            int64_t wake = (interval > 0 && next_send < stop) ? next_send : drain_until;
+            int timeout_ms = static_cast<int>(std::min<int64_t>(10, std::max<int64_t>(0, (wake - nowNs()) / 1000000)));
+            pollOnce(timeout_ms, 1);
+        }
+        for (LoadConnection& connection : connections) {
+            if (connection.client) {
+                connection.client->disconnect();
+            }
+        }
+    }
+
+    const LoadStats& getStats() const { return stats; }
+
+private:
+    const LoadOptions& options;
+    const std::vector<std::string>& names;
+    int first; // Index of connections[0] in names
+    std::vector<LoadConnection> connections;
+    std::vector<PollFd> poll_set;
+    std::vector<size_t> poll_owner;
+    std::mt19937 random;
+    LoadStats stats;
+    int64_t record_from = INT64_MAX;
+    char buffer[64 * 1024];
+
+    LoadConnection* nextLive(size_t& cursor) {
+        for (size_t tried = 0; tried < connections.size(); ++tried) {
+            LoadConnection& connection = connections[cursor];
+            cursor = (cursor + 1) % connections.size();
+            if (connection.client && connection.client->isConnected()) {
+                return &connection;
+            }
+        }
+        return nullptr;
+    }
+
+    // measure: 0 while settling, when everything received is discarded
+    void pollOnce(int timeout_ms, int measure) {
+        poll_set.clear();
+        poll_owner.clear();
+        for (size_t i = 0; i < connections.size(); ++i) {
+            if (connections[i].client && connections[i].client->isConnected()) {
+                PollFd fd{};
+                fd.fd = connections[i].client->getSocket();
+                fd.events = POLLIN;
+                poll_set.push_back(fd);
+                poll_owner.push_back(i);
+            }
+        }
+        if (poll_set.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            return;
+        }
+        if (pollSockets(poll_set.data(), poll_set.size(), timeout_ms) <= 0) {
+            return;
+        }
+        for (size_t i = 0; i < poll_set.size(); ++i) {
+            if (!(poll_set[i].revents & (POLLIN | POLLERR | POLLHUP))) {
+                continue;
+            }
+            LoadConnection& connection = connections[poll_owner[i]];
+            int bytes = recv(connection.client->getSocket(), buffer, sizeof(buffer), 0);
+            if (bytes <= 0) {
+                ++stats.lost_connections;
+                connection.client->disconnect();
+                continue;
+            }
+            stats.bytes_received += static_cast<uint64_t>(bytes);
+            if (measure) {
+                consume(connection, buffer, static_cast<size_t>(bytes));
+            } else if (connection.frames) {
+                consumeFrames(connection, buffer, static_cast<size_t>(bytes), false);
+            } else {
+                connection.input.clear();
+            }
+        }
+    }
+
+    void consume(LoadConnection& connection, const char* data, size_t length) {
+        if (connection.frames) {
+            consumeFrames(connection, data, length, true);
+            return;
+        }
+        connection.input.append(data, length);
+        size_t start = 0;
+        size_t end;
+        while ((end = connection.input.find('\n', start)) != std::string::npos) {
+            onLine(connection, std::string_view(connection.input).substr(start, end - start));
+            start = end + 1;
+        }
+        connection.input.erase(0, start);
+    }
+
+    void consumeFrames(LoadConnection& connection, const char* data, size_t length, bool measure) {
+        if (!connection.hello_seen) {
+            const char* nul = static_cast<const char*>(std::memchr(data, '\0', length));
+            if (!nul) {
+                return;
+            }
+            connection.hello_seen = true;
+            length -= static_cast<size_t>(nul - data);
+            data = nul;
+        }
+        while (length > 0) {
+            size_t taken = connection.frames->append(data, length);
+            data += taken;
+            length -= taken;
+            FrameHeader header;
+            std::string_view payload;
+            FrameDecoder::Status status;
+            while ((status = connection.frames->next(header, payload)) != FrameDecoder::Status::NEED_MORE) {
+                if (status != FrameDecoder::Status::FRAME) {
+                    continue;
+                }
+                if (header.type == FrameType::PING) {
+                    std::string pong = encodeFrame(FrameType::PONG, 0, 0, "");
+                    send(connection.client->getSocket(), pong.data(), static_cast<int>(pong.size()), 0);
+                } else if (measure && (header.type == FrameType::CHAT || header.type == FrameType::PRIVATE)) {
+                    onLine(connection, payload);
+                }
+            }
+        }
+    }
+
+    // A delivered chat line; "[PRIVATE to ...]" is the sender's own copy
+    void onLine(const LoadConnection& connection, std::string_view line) {
+        size_t marker = line.find("LG ");
+        if (marker == std::string_view::npos || line.find("[PRIVATE to ") != std::string_view::npos) {
+            return;
+        }
+        size_t i = marker + 3;
+        int64_t sent = 0;
+        for (; i < line.size() && line[i] >= '0' && line[i] <= '9'; ++i) {
+            sent = sent * 10 + (line[i] - '0');
+        }
+        size_t origin = 0;
+        for (++i; i < line.size() && line[i] >= '0' && line[i] <= '9'; ++i) {
+            origin = origin * 10 + static_cast<size_t>(line[i] - '0');
+        }
+        if (sent < record_from) {
+            return;
+        }
+        uint64_t latency = static_cast<uint64_t>(std::max<int64_t>(0, nowNs() - sent));
+        if (line.find("[PRIVATE from ") != std::string_view::npos) {
+            stats.private_latency.record(latency);
+            return;
+        }
+        stats.public_latency.record(latency);
+        (origin == connection.server ? stats.local_latency : stats.remote_latency).record(latency);
+    }
+};
+
+static void printLatencyRow(const char* label, const LatencyHistogram& histogram) {
+    std::printf("%-16s %10llu %9.3f %9.3f %9.3f %9.3f %9.3f\n", label,
+                static_cast<unsigned long long>(histogram.count()), histogram.percentile(50) / 1e6,
+                histogram.percentile(90) / 1e6, histogram.percentile(99) / 1e6, histogram.percentile(99.9) / 1e6,
+                histogram.max() / 1e6);
+}
+
+static void printLatencyJson(const char* name, const LatencyHistogram& histogram, bool last) {
+    std::printf("  \"%s\": {\"count\": %llu, \"p50_ms\": %.3f, \"p90_ms\": %.3f, \"p99_ms\": %.3f, "
+                "\"p999_ms\": %.3f, \"max_ms\": %.3f}%s\n",
+                name, static_cast<unsigned long long>(histogram.count()), histogram.percentile(50) / 1e6,
+                histogram.percentile(90) / 1e6, histogram.percentile(99) / 1e6, histogram.percentile(99.9) / 1e6,
+                histogram.max() / 1e6, last ? "" : ",");
+}
+
+static void showUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  -h <host>        Server hostname/IP (default: 127.0.0.1)\n";
+    std::cout << "  -p <port>        Server port (default: 8080)\n";
+    std::cout << "  --servers <list> Spread connections over host:port,host:port,... (linked servers)\n";
+    std::cout << "  -c <count>       Connections (default: 100)\n";
+    std::cout << "  -t <threads>     Worker threads (default: 4)\n";
+    std::cout << "  -r <rate>        Messages per second across all connections (default: 1000)\n";
+    std::cout << "  -s <bytes>       Message size (default: 64)\n";
+    std::cout << "  -d <seconds>     Measured duration (default: 10)\n";
+    std::cout << "  --pm <ratio>     Share of messages sent privately, 0-1 (default: 0.1)\n";
+    std::cout << "  --rooms <n>      Spread connections over n rooms (default: 1, the lobby)\n";
+    std::cout << "  --warmup <s>     Unmeasured sending before the run (default: 1)\n";
+    std::cout << "  --binary         Use the binary protocol\n";
+    std::cout << "  --json           Print the results as JSON\n";
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-h" && has_value) {
+            options.host = argv[++i];
+        } else if (arg == "-p" && has_value) {
+            options.port = std::atoi(argv[++i]);
+        } else if (arg == "--servers" && has_value) {
+            std::string list = argv[++i];
+            for (size_t start = 0; start <= list.size();) {
+                size_t end = std::min(list.find(',', start), list.size());
+                std::string server = list.substr(start, end - start);
+                size_t colon = server.rfind(':');
+                if (colon == std::string::npos) {
+                    std::cerr << "Error: Expected host:port, got " << server << "\n";
+                    return 1;
+                }
+                options.servers.emplace_back(server.substr(0, colon), std::atoi(server.c_str() + colon + 1));
+                start = end + 1;
+            }
+        } else if (arg == "-c" && has_value) {
+            options.connections = std::atoi(argv[++i]);
+        } else if (arg == "-t" && has_value) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (arg == "-r" && has_value) {
+            options.rate = std::atof(argv[++i]);
+        } else if (arg == "-s" && has_value) {
+            options.message_size = std::atoi(argv[++i]);
+        } else if (arg == "-d" && has_value) {
+            options.duration_s = std::atof(argv[++i]);
+        } else if (arg == "--pm" && has_value) {
+            options.pm_ratio = std::atof(argv[++i]);
+        } else if (arg == "--rooms" && has_value) {
+            options.rooms = std::atoi(argv[++i]);
+        } else if (arg == "--warmup" && has_value) {
+            options.warmup_s = std::atof(argv[++i]);
+        } else if (arg == "--binary") {
+            options.binary = true;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--help") {
+            showUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            showUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.servers.empty()) {
+        options.servers.emplace_back(options.host, options.port);
+    }
+    bool ports_valid = std::all_of(options.servers.begin(), options.servers.end(),
+                                   [](const std::pair<std::string, int>& server) {
+                                       return server.second > 0 && server.second <= 65535;
+                                   });
+    if (!ports_valid || options.connections <= 0 || options.threads <= 0 ||
+        options.rate < 0 || options.message_size < 0 || options.duration_s <= 0 || options.rooms <= 0) {
+        std::cerr << "Error: Invalid option value\n";
+        return 1;
+    }
+
+    #ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN); // A dropped connection must not end the run
+    #endif
+
+    int run_id = static_cast<int>(nowNs() / 1000000 % 100000);
+    std::vector<std::string> names;
+    for (int i = 0; i < options.connections; ++i) {
+        names.push_back(userName(run_id, i));
+    }
+
+    int workers = std::min(options.threads, options.connections);
+    std::vector<std::unique_ptr<LoadWorker>> pool;
+    int first = 0;
+    for (int w = 0; w < workers; ++w) {
+        int count = options.connections / workers + (w < options.connections % workers ? 1 : 0);
+        pool.push_back(std::make_unique<LoadWorker>(options, names, first, count, run_id * 31 + w));
+        first += count;
+    }
+
+    // Connect everyone, then let the join notices die down before sending
+    std::vector<std::thread> threads;
+    int64_t setup_start = nowNs();
+    for (auto& worker : pool) {
+        threads.emplace_back([&worker]() { worker->setUp(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+    double setup_s = (nowNs() - setup_start) / 1e9;
+    int64_t settle_until = nowNs() + 1000000000LL;
+    for (auto& worker : pool) {
+        threads.emplace_back([&worker, settle_until]() { worker->settle(settle_until); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    int64_t start = nowNs();
+    int64_t measure_from = start + static_cast<int64_t>(options.warmup_s * 1e9);
+    int64_t stop = measure_from + static_cast<int64_t>(options.duration_s * 1e9);
+    int64_t drain_until = stop + static_cast<int64_t>(options.drain_s * 1e9);
+    for (auto& worker : pool) {
+        threads.emplace_back([&worker, &options, workers, start, measure_from, stop, drain_until]() {
+            worker->run(start, measure_from, stop, drain_until, options.rate / workers);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    LoadStats total;
+    for (auto& worker : pool) {
+        total.merge(worker->getStats());
+    }
+    double seconds = options.duration_s;
+    uint64_t sent = total.sent_public + total.sent_private;
+    uint64_t delivered = total.public_latency.count() + total.private_latency.count();
+
+    if (options.json) {
+        std::printf("{\n");
+        std::printf("  \"connections\": %d, \"threads\": %d, \"protocol\": \"%s\", \"rooms\": %d, \"servers\": %zu,\n",
+                    options.connections, workers, options.binary ? "binary" : "text", options.rooms,
+                    options.servers.size());
+        std::printf("  \"offered_rate\": %.1f, \"message_size\": %d, \"pm_ratio\": %.3f, \"duration_s\": %.1f,\n",
+                    options.rate, options.message_size, options.pm_ratio, seconds);
+        std::printf("  \"setup_s\": %.3f, \"connect_errors\": %llu, \"lost_connections\": %llu,\n", setup_s,
+                    static_cast<unsigned long long>(total.connect_errors),
+                    static_cast<unsigned long long>(total.lost_connections));
+        std::printf("  \"sent_public\": %llu, \"sent_private\": %llu, \"sent_per_s\": %.1f,\n",
+                    static_cast<unsigned long long>(total.sent_public),
+                    static_cast<unsigned long long>(total.sent_private), sent / seconds);
+        std::printf("  \"delivered_per_s\": %.1f, \"received_mib_per_s\": %.3f,\n", delivered / seconds,
+                    total.bytes_received / seconds / (1024.0 * 1024.0));
+        printLatencyJson("public_latency", total.public_latency, false);
+        printLatencyJson("local_latency", total.local_latency, false);
+        printLatencyJson("remote_latency", total.remote_latency, false);
+        printLatencyJson("private_latency", total.private_latency, true);
+        std::printf("}\n");
+        return 0;
+    }
+
+    std::printf("chat_loadgen: %d connections to %zu server%s on %d threads, %s protocol, %d room%s "
+                "(connected in %.2f s)\n",
+                options.connections, options.servers.size(), options.servers.size() == 1 ? "" : "s", workers,
+                options.binary ? "binary" : "text", options.rooms, options.rooms == 1 ? "" : "s", setup_s);
+    std::printf("Offered: %.0f msg/s of %d bytes, %.0f%% private, for %.1f s\n", options.rate, options.message_size,
+                options.pm_ratio * 100, seconds);
+    std::printf("Sent: %llu public, %llu private (%.1f msg/s)\n",
+                static_cast<unsigned long long>(total.sent_public), static_cast<unsigned long long>(total.sent_private),
+                sent / seconds);
+    std::printf("Delivered: %llu public, %llu private (%.1f msg/s, %.2f MiB/s received)\n",
+                static_cast<unsigned long long>(total.public_latency.count()),
+                static_cast<unsigned long long>(total.private_latency.count()), delivered / seconds,
+                total.bytes_received / seconds / (1024.0 * 1024.0));
+    std::printf("\nLatency (ms)          count       p50       p90       p99     p99.9       max\n");
+    printLatencyRow("public", total.public_latency);
+    if (options.servers.size() > 1) {
+        printLatencyRow("  same server", total.local_latency);
+        printLatencyRow("  cross server", total.remote_latency);
+    }
+    printLatencyRow("private", total.private_latency);
+    if (total.connect_errors || total.lost_connections) {
+        std::printf("\nConnect errors: %llu, connections lost: %llu\n",
+                    static_cast<unsigned long long>(total.connect_errors),
+                    static_cast<unsigned long long>(total.lost_connections));
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+#ifndef CLIENT_REGISTRY_H
+#define CLIENT_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// Joined clients indexed by username and by connection id. Lookup, insert
+// and erase are O(1); iteration follows join order. Handles are
+// shared_ptrs, so a client found here stays valid after it is erased.
+// Not thread-safe; the owner serialises access.
+template <typename ClientT>
+class ClientRegistry {
+public:
+    typedef std::shared_ptr<ClientT> Handle;
+
+private:
+    struct Entry {
+        Handle client;
+        std::string name;
+        uint64_t id;
+    };
+    typedef typename std::list<Entry>::iterator Position;
+
+    std::list<Entry> entries; // Join order; iterators survive other erases
+    std::unordered_map<std::string, Position> by_name;
+    std::unordered_map<uint64_t, Position> by_id;
+
+public:
+    // Returns false if the name or id is already registered
+    bool insert(const std::string& name, uint64_t id, const Handle& client) {
+        if (by_name.count(name) || by_id.count(id)) {
+            return false;
+        }
+        Position position = entries.insert(entries.end(), Entry{client, name, id});
+        by_name.emplace(name, position);
+        by_id.emplace(id, position);
+        return true;
+    }
+
+    bool erase(uint64_t id) {
+        auto it = by_id.find(id);
+        if (it == by_id.end()) {
+            return false;
+        }
+        Position position = it->second;
+        by_name.erase(position->name);
+        by_id.erase(it);
+        entries.erase(position);
+        return true;
+    }
+
+    Handle findByName(const std::string& name) const {
+        auto it = by_name.find(name);
+        return it == by_name.end() ? Handle() : it->second->client;
+    }
+
+    Handle findById(uint64_t id) const {
+        auto it = by_id.find(id);
+        return it == by_id.end() ? Handle() : it->second->client;
+    }
+
+    bool contains(const std::string& name) const { return by_name.count(name) != 0; }
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    void clear() {
+        by_name.clear();
+        by_id.clear();
+        entries.clear();
+    }
+
+    // Calls fn(const Handle&) for every client in join order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const Entry& entry : entries) {
+            fn(entry.client);
+        }
+    }
+};
+
+#endif // CLIENT_REGISTRY_H
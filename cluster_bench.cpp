@@ -0,0 +1,512 @@
+// Local cluster benchmark for the inter-server network (Linux only).
+// Starts K chat servers on loopback, links every pair through the server
+// console (`connect host:port`), drives all of them at once with
+// chat_loadgen and reports, next to its latency figures, the forwarded
+// message rate per server and the traffic on every link, read from each
+// server's /metrics before and after the run.
+//
+// Node i serves chat on base+i, accepts server links on base+100+i and
+// /metrics on base+200+i. Each node runs in its own directory under /tmp
+// with its output in server.log; the directories are removed afterwards
+// unless --keep is given.
+//
+// Usage: cluster_bench.exe [-k nodes] [--base-port port] [--server path]
+//        [--loadgen path] [--server-arg arg]... [--config key=value]...
+//        [--keep] [--json]
+//        [-- chat_loadgen options]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <csignal>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+struct ClusterOptions {
+    int nodes = 3;
+    int base_port = 9100;
+    std::string server = "./server.exe";
+    std::string loadgen = "./chat_loadgen.exe";
+    std::vector<std::string> server_args;
+    std::vector<std::string> config_lines; // Added to every node's server_config.txt
+    std::vector<std::string> loadgen_args;
+    bool keep = false;
+    bool json = false;
+};
+
+struct ClusterNode {
+    int index = 0;
+    std::string id;  // server_id, "node<i>"
+    std::string dir;
+    pid_t pid = -1;
+    int console = -1; // Write end of the server's stdin
+    int chat_port = 0;
+    int link_port = 0;
+    int metrics_port = 0;
+};
+
+typedef std::map<std::string, double> MetricSample; // "name{labels}" -> value
+
+static bool canConnect(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool ok = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    close(fd);
+    return ok;
+}
+
+static std::string httpGet(int port, const std::string& path) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return std::string();
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    std::string response;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        std::string request = "GET " + path + " HTTP/1.0\r\n\r\n";
+        if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size())) {
+            char buffer[16384];
+            ssize_t bytes;
+            while ((bytes = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+                response.append(buffer, static_cast<size_t>(bytes));
+            }
+        }
+    }
+    close(fd);
+    size_t body = response.find("\r\n\r\n");
+    return body == std::string::npos ? std::string() : response.substr(body + 4);
+}
+
+static MetricSample scrape(const ClusterNode& node) {
+    MetricSample sample;
+    std::string body = httpGet(node.metrics_port, "/metrics");
+    size_t start = 0;
+    while (start < body.size()) {
+        size_t end = body.find('\n', start);
+        if (end == std::string::npos) {
+            end = body.size();
+        }
+        std::string line = body.substr(start, end - start);
+        start = end + 1;
+        size_t space = line.rfind(' ');
+        if (line.empty() || line[0] == '#' || space == std::string::npos) {
+            continue;
+        }
+        sample[line.substr(0, space)] = std::atof(line.c_str() + space + 1);
+    }
+    return sample;
+}
+
+static double metric(const MetricSample& sample, const std::string& key) {
+    auto it = sample.find(key);
+    return it == sample.end() ? 0.0 : it->second;
+}
+
+// Runs argv to completion and returns its stdout
+static int runAndCapture(const std::vector<std::string>& argv, std::string& output) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        std::vector<char*> args;
+        for (const std::string& arg : argv) {
+            args.push_back(const_cast<char*>(arg.c_str()));
+        }
+        args.push_back(nullptr);
+        execv(args[0], args.data());
+        std::perror("exec");
+        _exit(127);
+    }
+    close(pipe_fds[1]);
+    char buffer[4096];
+    ssize_t bytes;
+    while ((bytes = read(pipe_fds[0], buffer, sizeof(buffer))) > 0) {
+        output.append(buffer, static_cast<size_t>(bytes));
+    }
+    close(pipe_fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+class LocalCluster {
+public:
+    explicit LocalCluster(const ClusterOptions& options) : options(options) {}
+
+    ~LocalCluster() {
+        stop();
+        if (!root.empty() && !options.keep) {
+            std::error_code ignored;
+            std::filesystem::remove_all(root, ignored);
+        }
+    }
+
+    bool start() {
+        char pattern[] = "/tmp/chat_cluster_XXXXXX";
+        if (!mkdtemp(pattern)) {
+            std::perror("mkdtemp");
+            return false;
+        }
+        root = pattern;
+        for (int i = 0; i < options.nodes; ++i) {
+            ClusterNode node;
+            node.index = i;
+            node.id = "node" + std::to_string(i);
+            node.dir = root + "/" + node.id;
+            node.chat_port = options.base_port + i;
+            node.link_port = options.base_port + 100 + i;
+            node.metrics_port = options.base_port + 200 + i;
+            nodes.push_back(node);
+            if (!startNode(nodes.back())) {
+                return false;
+            }
+        }
+        for (const ClusterNode& node : nodes) {
+            if (!waitFor([&node]() { return canConnect(node.chat_port) && canConnect(node.metrics_port); })) {
+                std::cerr << "Error: " << node.id << " did not come up; see " << node.dir << "/server.log\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Every pair gets one link; node j dials every node before it
+    bool linkFullMesh() {
+        for (size_t j = 1; j < nodes.size(); ++j) {
+            for (size_t i = 0; i < j; ++i) {
+                command(nodes[j], "connect 127.0.0.1:" + std::to_string(nodes[i].link_port));
+            }
+        }
+        double expected = static_cast<double>(nodes.size() - 1);
+        for (const ClusterNode& node : nodes) {
+            if (!waitFor([&node, expected]() { return metric(scrape(node), "chat_interserver_links") == expected; })) {
+                std::cerr << "Error: " << node.id << " did not link to every other node; see " << node.dir
+                          << "/server.log\n";
+                return false;
+            }
+        }
+        // The handshakes that name each link's peer follow the connects
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        return true;
+    }
+
+    void stop() {
+        for (ClusterNode& node : nodes) {
+            if (node.console >= 0) {
+                command(node, "quit");
+                close(node.console);
+                node.console = -1;
+            }
+        }
+        for (ClusterNode& node : nodes) {
+            if (node.pid <= 0) {
+                continue;
+            }
+            for (int waited_ms = 0; waited_ms < 5000; waited_ms += 50) {
+                if (waitpid(node.pid, nullptr, WNOHANG) == node.pid) {
+                    node.pid = -1;
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            if (node.pid > 0) {
+                kill(node.pid, SIGKILL);
+                waitpid(node.pid, nullptr, 0);
+                node.pid = -1;
+            }
+        }
+    }
+
+    std::vector<MetricSample> scrapeAll() const {
+        std::vector<MetricSample> samples;
+        for (const ClusterNode& node : nodes) {
+            samples.push_back(scrape(node));
+        }
+        return samples;
+    }
+
+    const std::vector<ClusterNode>& getNodes() const { return nodes; }
+    const std::string& getRoot() const { return root; }
+
+private:
+    const ClusterOptions& options;
+    std::string root;
+    std::vector<ClusterNode> nodes;
+
+    bool startNode(ClusterNode& node) {
+        std::filesystem::create_directories(node.dir);
+        std::ofstream config(node.dir + "/server_config.txt");
+        config << "server_id=" << node.id << "\n";
+        config << "enable_interserver_communication=true\n";
+        config << "interserver_port=" << node.link_port << "\n";
+        config << "metrics_port=" << node.metrics_port << "\n";
+        for (const std::string& line : options.config_lines) {
+            config << line << "\n";
+        }
+        config.close();
+
+        int console[2];
+        if (pipe(console) != 0) {
+            std::perror("pipe");
+            return false;
+        }
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::perror("fork");
+            return false;
+        }
+        if (pid == 0) {
+            if (chdir(node.dir.c_str()) != 0) {
+                _exit(127);
+            }
+            int log = open("server.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            dup2(console[0], STDIN_FILENO);
+            dup2(log, STDOUT_FILENO);
+            dup2(log, STDERR_FILENO);
+            close(console[0]);
+            close(console[1]);
+            close(log);
+            std::vector<std::string> argv = {options.server, "-p", std::to_string(node.chat_port), "-m", "100000"};
+            argv.insert(argv.end(), options.server_args.begin(), options.server_args.end());
+            std::vector<char*> args;
+            for (const std::string& arg : argv) {
+                args.push_back(const_cast<char*>(arg.c_str()));
+            }
+            args.push_back(nullptr);
+            execv(args[0], args.data());
+            std::perror("exec");
+            _exit(127);
+        }
+        close(console[0]);
+        fcntl(console[1], F_SETFD, FD_CLOEXEC); // Not inherited by later nodes
+        node.pid = pid;
+        node.console = console[1];
+        return true;
+    }
+
+    void command(const ClusterNode& node, const std::string& line) {
+        std::string text = line + "\n";
+        if (node.console >= 0 && write(node.console, text.data(), text.size()) < 0) {
+            std::cerr << "Warning: cannot send '" << line << "' to " << node.id << "\n";
+        }
+    }
+
+    template <typename Ready>
+    static bool waitFor(Ready ready) {
+        for (int waited_ms = 0; waited_ms < 10000; waited_ms += 100) {
+            if (ready()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    }
+};
+
+static void showUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options] [-- chat_loadgen options]\n";
+    std::cout << "Options:\n";
+    std::cout << "  -k <nodes>          Servers to start (default: 3)\n";
+    std::cout << "  --base-port <port>  Node i: chat base+i, links base+100+i, metrics base+200+i (default: 9100)\n";
+    std::cout << "  --server <path>     Server binary (default: ./server.exe)\n";
+    std::cout << "  --loadgen <path>    Load generator binary (default: ./chat_loadgen.exe)\n";
+    std::cout << "  --server-arg <arg>  Extra server argument, e.g. --io-uring (repeatable)\n";
+    std::cout << "  --config <k=v>      Extra server_config.txt line for every node, e.g.\n";
+    std::cout << "                      interserver_batch_delay_us=0 (repeatable)\n";
+    std::cout << "  --keep              Keep the node directories and logs\n";
+    std::cout << "  --json              Print the results as JSON\n";
+    std::cout << "Example: " << program_name << " -k 4 -- -c 400 -r 2000 -d 10\n";
+}
+
+static std::string absolutePath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    return error ? path : absolute.string();
+}
+
+int main(int argc, char* argv[]) {
+    ClusterOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--") {
+            options.loadgen_args.assign(argv + i + 1, argv + argc);
+            break;
+        } else if (arg == "-k" && has_value) {
+            options.nodes = std::atoi(argv[++i]);
+        } else if (arg == "--base-port" && has_value) {
+            options.base_port = std::atoi(argv[++i]);
+        } else if (arg == "--server" && has_value) {
+            options.server = argv[++i];
+        } else if (arg == "--loadgen" && has_value) {
+            options.loadgen = argv[++i];
+        } else if (arg == "--server-arg" && has_value) {
+            options.server_args.push_back(argv[++i]);
+        } else if (arg == "--config" && has_value) {
+            options.config_lines.push_back(argv[++i]);
+        } else if (arg == "--keep") {
+            options.keep = true;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else if (arg == "--help") {
+            showUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Error: Unknown option " << arg << "\n";
+            showUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.nodes < 1 || options.base_port <= 0 || options.base_port + 200 + options.nodes > 65535) {
+        std::cerr << "Error: Invalid option value\n";
+        return 1;
+    }
+    options.server = absolutePath(options.server);
+    options.loadgen = absolutePath(options.loadgen);
+    signal(SIGPIPE, SIG_IGN); // A server that died must not take the harness with it
+
+    LocalCluster cluster(options);
+    if (!cluster.start() || !cluster.linkFullMesh()) {
+        return 1;
+    }
+    const std::vector<ClusterNode>& nodes = cluster.getNodes();
+
+    std::vector<std::string> loadgen = {options.loadgen, "--servers"};
+    std::string servers;
+    for (const ClusterNode& node : nodes) {
+        servers += (servers.empty() ? "" : ",") + std::string("127.0.0.1:") + std::to_string(node.chat_port);
+    }
+    loadgen.push_back(servers);
+    loadgen.insert(loadgen.end(), options.loadgen_args.begin(), options.loadgen_args.end());
+    if (options.json) {
+        loadgen.push_back("--json");
+    }
+
+    std::vector<MetricSample> before = cluster.scrapeAll();
+    auto started = std::chrono::steady_clock::now();
+    std::string report;
+    int status = runAndCapture(loadgen, report);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    std::vector<MetricSample> after = cluster.scrapeAll();
+    if (status != 0) {
+        std::cerr << "Error: chat_loadgen exited with status " << status << "\n" << report;
+        return 1;
+    }
+
+    auto delta = [&](size_t node, const std::string& key) {
+        return metric(after[node], key) - metric(before[node], key);
+    };
+    auto link = [](const char* name, const std::string& peer, const char* direction) {
+        return std::string(name) + "{peer=\"" + peer + "\",direction=\"" + direction + "\"}";
+    };
+    // Messages per send() on a link, i.e. how well it batched
+    auto per_write = [&](size_t node, const std::string& peer) {
+        double writes = delta(node, "chat_interserver_link_writes_total{peer=\"" + peer + "\"}");
+        return writes > 0 ? delta(node, link("chat_interserver_link_messages_total", peer, "sent")) / writes : 0.0;
+    };
+
+    if (options.json) {
+        // Reopen chat_loadgen's object to append the cluster figures
+        size_t close_brace = report.rfind('}');
+        report.erase(close_brace == std::string::npos ? 0 : close_brace);
+        while (!report.empty() && (report.back() == '\n' || report.back() == ' ')) {
+            report.pop_back();
+        }
+        std::printf("%s,\n  \"nodes\": %zu, \"links\": %zu, \"elapsed_s\": %.3f,\n  \"node_stats\": [\n",
+                    report.c_str(), nodes.size(), nodes.size() * (nodes.size() - 1) / 2, elapsed);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            std::printf("    {\"node\": \"%s\", \"forwarded_out_per_s\": %.1f, \"forwarded_in_per_s\": %.1f, "
+                        "\"delivered_per_s\": %.1f}%s\n",
+                        nodes[i].id.c_str(), delta(i, "chat_interserver_sent_total") / elapsed,
+                        delta(i, "chat_interserver_received_total") / elapsed,
+                        delta(i, "chat_messages_delivered_total") / elapsed, i + 1 < nodes.size() ? "," : "");
+        }
+        std::printf("  ],\n  \"link_stats\": [\n");
+        bool first = true;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            for (size_t j = 0; j < nodes.size(); ++j) {
+                if (i == j) {
+                    continue;
+                }
+                const std::string& peer = nodes[j].id;
+                std::printf("%s    {\"from\": \"%s\", \"to\": \"%s\", \"messages_per_s\": %.1f, \"bytes_per_s\": %.1f, "
+                            "\"messages_per_write\": %.2f}",
+                            first ? "" : ",\n", nodes[i].id.c_str(), peer.c_str(),
+                            delta(i, link("chat_interserver_link_messages_total", peer, "sent")) / elapsed,
+                            delta(i, link("chat_interserver_link_bytes_total", peer, "sent")) / elapsed,
+                            per_write(i, peer));
+                first = false;
+            }
+        }
+        std::printf("\n  ]\n}\n");
+        return 0;
+    }
+
+    std::printf("=== Cluster: %zu nodes, full mesh of %zu links (%s) ===\n", nodes.size(),
+                nodes.size() * (nodes.size() - 1) / 2, cluster.getRoot().c_str());
+    std::printf("%s\n", report.c_str());
+    std::printf("=== Inter-server traffic over %.1f s ===\n", elapsed);
+    std::printf("%-8s %16s %16s %14s\n", "node", "forwarded out/s", "forwarded in/s", "delivered/s");
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        std::printf("%-8s %16.1f %16.1f %14.1f\n", nodes[i].id.c_str(),
+                    delta(i, "chat_interserver_sent_total") / elapsed,
+                    delta(i, "chat_interserver_received_total") / elapsed,
+                    delta(i, "chat_messages_delivered_total") / elapsed);
+    }
+    std::printf("\n%-18s %12s %12s %12s\n", "link", "messages/s", "KiB/s", "msgs/write");
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (size_t j = 0; j < nodes.size(); ++j) {
+            if (i == j) {
+                continue;
+            }
+            const std::string& peer = nodes[j].id;
+            std::string name = nodes[i].id + " -> " + peer;
+            std::printf("%-18s %12.1f %12.2f %12.2f\n", name.c_str(),
+                        delta(i, link("chat_interserver_link_messages_total", peer, "sent")) / elapsed,
+                        delta(i, link("chat_interserver_link_bytes_total", peer, "sent")) / elapsed / 1024.0,
+                        per_write(i, peer));
+        }
+    }
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cerr << "cluster_bench needs Linux (fork/exec and loopback servers)\n";
+    return 1;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#include "command_parser.h"
+
+static bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+std::string_view nextToken(std::string_view& rest) {
+    size_t start = 0;
+    while (start < rest.size() && isSpace(rest[start])) {
+        ++start;
+    }
+    size_t end = start;
+    while (end < rest.size() && !isSpace(rest[end])) {
+        ++end;
+    }
+    std::string_view token = rest.substr(start, end - start);
+    rest.remove_prefix(end);
+    return token;
+}
+
+bool parseCount(std::string_view token, size_t& value) {
+    if (token.empty() || token.size() > 9) {
+        return false;
+    }
+    size_t result = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        result = result * 10 + static_cast<size_t>(c - '0');
+    }
+    value = result;
+    return true;
+}
@@ -0,0 +1,108 @@
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Slash commands understood by the chat server
+enum class ChatCommand {
+    UNKNOWN,
+    QUIT,
+    LIST,
+    HELP,
+    PM,
+    JOIN,
+    PART,
+    ROOMS,
+    HISTORY,
+    SEARCH,
+    PING,
+    COUNT // Number of values; keep last
+};
+
+struct CommandName {
+    std::string_view name;
+    ChatCommand command;
+};
+
+// Add new commands here and a handler in ChatServer's dispatch table
+constexpr CommandName CHAT_COMMANDS[] = {
+    {"/quit", ChatCommand::QUIT},
+    {"/list", ChatCommand::LIST},
+    {"/help", ChatCommand::HELP},
+    {"/pm", ChatCommand::PM},
+    {"/join", ChatCommand::JOIN},
+    {"/part", ChatCommand::PART},
+    {"/rooms", ChatCommand::ROOMS},
+    {"/history", ChatCommand::HISTORY},
+    {"/search", ChatCommand::SEARCH},
+    {"/ping", ChatCommand::PING},
+};
+
+// Perfect hash over CHAT_COMMANDS: a seeded FNV-1a of the name, masked to
+// the table size. The seed is searched for at compile time, so every
+// command lands in its own slot and a lookup is one hash plus one compare.
+constexpr size_t COMMAND_TABLE_SIZE = 32; // Power of two, more than the commands
+
+constexpr size_t commandHash(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    }
+    return hash & (COMMAND_TABLE_SIZE - 1);
+}
+
+constexpr bool commandSeedWorks(uint32_t seed) {
+    bool used[COMMAND_TABLE_SIZE] = {};
+    for (const CommandName& entry : CHAT_COMMANDS) {
+        size_t slot = commandHash(entry.name, seed);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findCommandSeed() {
+    for (uint32_t seed = 0; seed < 100000; ++seed) {
+        if (commandSeedWorks(seed)) {
+            return seed;
+        }
+    }
+    return UINT32_MAX;
+}
+
+struct CommandTable {
+    uint32_t seed;
+    CommandName slots[COMMAND_TABLE_SIZE];
+};
+
+constexpr CommandTable buildCommandTable() {
+    CommandTable table{findCommandSeed(), {}};
+    for (size_t i = 0; i < COMMAND_TABLE_SIZE; ++i) {
+        table.slots[i] = CommandName{std::string_view(), ChatCommand::UNKNOWN};
+    }
+    for (const CommandName& entry : CHAT_COMMANDS) {
+        table.slots[commandHash(entry.name, table.seed)] = entry;
+    }
+    return table;
+}
+
+constexpr CommandTable COMMAND_TABLE = buildCommandTable();
+static_assert(COMMAND_TABLE.seed != UINT32_MAX, "no perfect hash seed for CHAT_COMMANDS; grow COMMAND_TABLE_SIZE");
+
+constexpr ChatCommand lookupCommand(std::string_view name) {
+    const CommandName& slot = COMMAND_TABLE.slots[commandHash(name, COMMAND_TABLE.seed)];
+    return slot.name == name ? slot.command : ChatCommand::UNKNOWN;
+}
+
+// Returns the next whitespace-separated token of `rest` and advances `rest`
+// to just after it. Empty when no token is left. Views only; never copies.
+std::string_view nextToken(std::string_view& rest);
+
+// Parses a whole unsigned decimal token; false for anything else
+bool parseCount(std::string_view token, size_t& value);
+
+#endif // COMMAND_PARSER_H
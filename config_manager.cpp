@@ -37,6 +37,86 @@ bool ConfigManager::loadConfig() {
                 config.port = std::stoi(value);
             } else if (key == "max_clients") {
                 config.max_clients = std::stoi(value);
+            } else if (key == "shard_count") {
+                config.shard_count = std::stoi(value);
+            } else if (key == "max_line_length") {
+                config.max_line_length = std::stoi(value);
+            } else if (key == "outbound_high_watermark") {
+                config.outbound_limits.high_watermark = std::stoul(value);
+            } else if (key == "outbound_low_watermark") {
+                config.outbound_limits.low_watermark = std::stoul(value);
+            } else if (key == "slow_consumer_policy") {
+                if (!parseSlowConsumerPolicy(value, config.outbound_limits.policy)) {
+                    std::cout << "Warning: Unknown slow_consumer_policy '" << value << "', using "
+                              << slowConsumerPolicyName(config.outbound_limits.policy) << "\n";
+                }
+            } else if (key == "log_sink") {
+                if (!parseLogSink(value, config.logging.sink)) {
+                    std::cout << "Warning: Unknown log_sink '" << value << "', using "
+                              << logSinkName(config.logging.sink) << "\n";
+                }
+            } else if (key == "log_file") {
+                config.logging.file_path = value;
+            } else if (key == "log_rotate_bytes") {
+                config.logging.rotate_bytes = std::stoul(value);
+            } else if (key == "log_rotate_files") {
+                config.logging.rotate_files = std::stoi(value);
+            } else if (key == "log_queue_size") {
+                config.logging.queue_size = std::stoul(value);
+            } else if (key == "log_timestamps") {
+                config.logging.monotonic_timestamps = (value == "monotonic");
+            } else if (key == "max_rooms") {
+                config.max_rooms = std::stoi(value);
+            } else if (key == "history_messages") {
+                config.history.max_messages = std::stoul(value);
+            } else if (key == "history_bytes") {
+                config.history.max_bytes = std::stoul(value);
+            } else if (key == "history_replay") {
+                config.history.replay_count = std::stoul(value);
+            } else if (key == "store_enabled") {
+                config.store.enabled = (value == "true");
+            } else if (key == "store_dir") {
+                config.store.directory = value;
+            } else if (key == "store_segment_bytes") {
+                config.store.segment_bytes = std::stoul(value);
+            } else if (key == "store_sync_ms") {
+                config.store.sync_interval_ms = std::stoi(value);
+            } else if (key == "store_index_bytes") {
+                config.store.index_interval_bytes = std::stoul(value);
+            } else if (key == "store_queue_size") {
+                config.store.queue_size = std::stoul(value);
+            } else if (key == "mailbox_enabled") {
+                config.mailbox.enabled = (value == "true");
+            } else if (key == "mailbox_dir") {
+                config.mailbox.directory = value;
+            } else if (key == "mailbox_max_messages") {
+                config.mailbox.max_messages = std::stoul(value);
+            } else if (key == "mailbox_max_bytes") {
+                config.mailbox.max_bytes = std::stoul(value);
+            } else if (key == "mailbox_total_bytes") {
+                config.mailbox.max_total_bytes = std::stoul(value);
+            } else if (key == "mailbox_ttl_hours") {
+                config.mailbox.ttl_hours = std::stoi(value);
+            } else if (key == "handshake_timeout_s") {
+                config.timeouts.handshake_s = std::stoi(value);
+            } else if (key == "keepalive_s") {
+                config.timeouts.keepalive_s = std::stoi(value);
+            } else if (key == "keepalive_timeout_s") {
+                config.timeouts.keepalive_timeout_s = std::stoi(value);
+            } else if (key == "idle_timeout_s") {
+                config.timeouts.idle_s = std::stoi(value);
+            } else if (key == "metrics_port") {
+                config.metrics_port = std::stoi(value);
+            } else if (key == "metrics_address") {
+                config.metrics_address = value;
+            } else if (key == "interserver_heartbeat_s") {
+                config.interserver_heartbeat_s = std::stoi(value);
+            } else if (key == "interserver_timeout_s") {
+                config.interserver_timeout_s = std::stoi(value);
+            } else if (key == "interserver_batch_delay_us") {
+                config.interserver_batch_delay_us = std::stoi(value);
+            } else if (key == "interserver_batch_bytes") {
+                config.interserver_batch_bytes = std::stoi(value);
             } else if (key == "interserver_port") {
                 config.interserver_port = std::stoi(value);
             } else if (key == "network_password") {
@@ -70,7 +150,44 @@ bool ConfigManager::saveConfig() {
     file << "server_name=" << config.server_name << std::endl;
     file << "port=" << config.port << std::endl;
     file << "max_clients=" << config.max_clients << std::endl;
+    file << "shard_count=" << config.shard_count << std::endl;
+    file << "max_line_length=" << config.max_line_length << std::endl;
+    file << "outbound_high_watermark=" << config.outbound_limits.high_watermark << std::endl;
+    file << "outbound_low_watermark=" << config.outbound_limits.low_watermark << std::endl;
+    file << "slow_consumer_policy=" << slowConsumerPolicyName(config.outbound_limits.policy) << std::endl;
+    file << "log_sink=" << logSinkName(config.logging.sink) << std::endl;
+    file << "log_file=" << config.logging.file_path << std::endl;
+    file << "log_rotate_bytes=" << config.logging.rotate_bytes << std::endl;
+    file << "log_rotate_files=" << config.logging.rotate_files << std::endl;
+    file << "log_queue_size=" << config.logging.queue_size << std::endl;
+    file << "log_timestamps=" << (config.logging.monotonic_timestamps ? "monotonic" : "wall") << std::endl;
+    file << "max_rooms=" << config.max_rooms << std::endl;
+    file << "history_messages=" << config.history.max_messages << std::endl;
+    file << "history_bytes=" << config.history.max_bytes << std::endl;
+    file << "history_replay=" << config.history.replay_count << std::endl;
+    file << "store_enabled=" << (config.store.enabled ? "true" : "false") << std::endl;
+    file << "store_dir=" << config.store.directory << std::endl;
+    file << "store_segment_bytes=" << config.store.segment_bytes << std::endl;
+    file << "store_sync_ms=" << config.store.sync_interval_ms << std::endl;
+    file << "store_index_bytes=" << config.store.index_interval_bytes << std::endl;
+    file << "store_queue_size=" << config.store.queue_size << std::endl;
+    file << "mailbox_enabled=" << (config.mailbox.enabled ? "true" : "false") << std::endl;
+    file << "mailbox_dir=" << config.mailbox.directory << std::endl;
+    file << "mailbox_max_messages=" << config.mailbox.max_messages << std::endl;
+    file << "mailbox_max_bytes=" << config.mailbox.max_bytes << std::endl;
+    file << "mailbox_total_bytes=" << config.mailbox.max_total_bytes << std::endl;
+    file << "mailbox_ttl_hours=" << config.mailbox.ttl_hours << std::endl;
+    file << "handshake_timeout_s=" << config.timeouts.handshake_s << std::endl;
+    file << "keepalive_s=" << config.timeouts.keepalive_s << std::endl;
+    file << "keepalive_timeout_s=" << config.timeouts.keepalive_timeout_s << std::endl;
+    file << "idle_timeout_s=" << config.timeouts.idle_s << std::endl;
+    file << "metrics_port=" << config.metrics_port << std::endl;
+    file << "metrics_address=" << config.metrics_address << std::endl;
     file << "interserver_port=" << config.interserver_port << std::endl;
+    file << "interserver_heartbeat_s=" << config.interserver_heartbeat_s << std::endl;
+    file << "interserver_timeout_s=" << config.interserver_timeout_s << std::endl;
+    file << "interserver_batch_delay_us=" << config.interserver_batch_delay_us << std::endl;
+    file << "interserver_batch_bytes=" << config.interserver_batch_bytes << std::endl;
     file << "network_password=" << config.network_password << std::endl;
     file << "network_name=" << config.network_name << std::endl;
     file << "enable_interserver_communication=" << (config.enable_interserver_communication ? "true" : "false") << std::endl;
@@ -106,7 +223,48 @@ std::string ConfigManager::getConfigSummary() const {
     ss << "Server Name: " << config.server_name << "\n";
     ss << "Port: " << config.port << "\n";
     ss << "Max Clients: " << config.max_clients << "\n";
+    ss << "Max Line Length: " << config.max_line_length << "\n";
+    ss << "Output Queue: " << config.outbound_limits.low_watermark << "-" << config.outbound_limits.high_watermark
+       << " bytes (" << slowConsumerPolicyName(config.outbound_limits.policy) << ")\n";
+    ss << "Shards: " << (config.shard_count > 0 ? std::to_string(config.shard_count) : "auto") << "\n";
+    ss << "Logging: " << logSinkName(config.logging.sink);
+    if (config.logging.sink == LogSinkType::ROTATING_FILE) {
+        ss << " " << config.logging.file_path << " (rotate at " << config.logging.rotate_bytes
+           << " bytes, keep " << config.logging.rotate_files << ")";
+    }
+    ss << ", queue " << config.logging.queue_size
+       << (config.logging.monotonic_timestamps ? ", monotonic timestamps" : "") << "\n";
+    ss << "Max Rooms: " << config.max_rooms << "\n";
+    ss << "History: " << config.history.max_messages << " messages / " << config.history.max_bytes
+       << " bytes per room, " << config.history.replay_count << " replayed on join\n";
+    ss << "Message Store: ";
+    if (config.store.enabled) {
+        ss << config.store.directory << " (" << config.store.segment_bytes << "-byte segments, sync every "
+           << config.store.sync_interval_ms << " ms)\n";
+    } else {
+        ss << "disabled\n";
+    }
+    ss << "Offline Mailboxes: ";
+    if (config.mailbox.enabled) {
+        ss << config.mailbox.directory << " (" << config.mailbox.max_messages << " messages / "
+           << config.mailbox.max_bytes << " bytes per user, " << config.mailbox.max_total_bytes << " bytes total, "
+           << config.mailbox.ttl_hours << " h TTL)\n";
+    } else {
+        ss << "disabled\n";
+    }
+    ss << "Timeouts: handshake " << config.timeouts.handshake_s << " s, keepalive " << config.timeouts.keepalive_s
+       << " s (+" << config.timeouts.keepalive_timeout_s << " s), idle " << config.timeouts.idle_s << " s\n";
+    ss << "Metrics Endpoint: ";
+    if (config.metrics_port > 0) {
+        ss << "http://" << config.metrics_address << ":" << config.metrics_port << "/metrics\n";
+    } else {
+        ss << "disabled\n";
+    }
     ss << "Inter-server Port: " << config.interserver_port << "\n";
+    ss << "Inter-server Liveness: heartbeat " << config.interserver_heartbeat_s << " s, timeout "
+       << config.interserver_timeout_s << " s\n";
+    ss << "Inter-server Batching: up to " << config.interserver_batch_delay_us << " us or "
+       << config.interserver_batch_bytes << " bytes\n";
     ss << "Network Name: " << config.network_name << "\n";
     ss << "Inter-server Communication: " << (config.enable_interserver_communication ? "Enabled" : "Disabled") << "\n";
     ss << "User Sync: " << (config.enable_user_sync ? "Enabled" : "Disabled") << "\n";
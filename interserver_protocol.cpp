@@ -1,93 +1,206 @@
 #include "interserver_protocol.h"
-#include <iostream>
-#include <sstream>
-#include <iomanip>
+#include "timestamp_cache.h"
 #include <random>
-#include <algorithm>
+#include <stdexcept>
 
-// Message serialization functions
-std::string serializeServerMessage(const ServerMessage& msg) {
-    std::stringstream ss;
+namespace {
+
+void appendVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
 
-    // Format: TYPE|SERVER_ID|TARGET_SERVER_ID|TIMESTAMP|PAYLOAD
-    ss << static_cast<int>(msg.type) << "|"
-       << msg.server_id << "|"
-       << msg.target_server_id << "|"
-       << std::chrono::duration_cast<std::chrono::seconds>(
-           msg.timestamp.time_since_epoch()).count() << "|"
-       << msg.payload;
+size_t varintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
 
-    return ss.str();
+void appendString(std::string& out, std::string_view text) {
+    appendVarint(out, text.size());
+    out.append(text.data(), text.size());
 }
 
-ServerMessage deserializeServerMessage(const std::string& data) {
-    std::stringstream ss(data);
-    std::string token;
-    std::vector<std::string> tokens;
+size_t stringSize(std::string_view text) {
+    return varintSize(text.size()) + text.size();
+}
 
-    // Split by '|'
-    while (std::getline(ss, token, '|')) {
-        tokens.push_back(token);
+// Reads fields from one frame body; every read is bounds-checked and fails
+// rather than running past the end
+class FieldReader {
+public:
+    explicit FieldReader(std::string_view data) : data(data) {}
+
+    bool readByte(uint8_t& value) {
+        if (position == data.size()) {
+            return false;
+        }
+        value = static_cast<uint8_t>(data[position++]);
+        return true;
     }
 
-    if (tokens.size() < 5) {
-        throw std::runtime_error("Invalid message format");
+    bool readVarint(uint64_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte;
+            if (!readByte(byte) || (shift == 63 && byte > 1)) {
+                return false;
+            }
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
     }
 
-    ServerMessage msg(
-        static_cast<ServerMessageType>(std::stoi(tokens[0])),
-        tokens[1],
-        tokens[2],
-        tokens[4]
-    );
+    bool readString(std::string_view& text) {
+        uint64_t length;
+        if (!readVarint(length) || length > data.size() - position) {
+            return false;
+        }
+        text = data.substr(position, static_cast<size_t>(length));
+        position += static_cast<size_t>(length);
+        return true;
+    }
 
-    // Parse timestamp
-    auto timestamp_seconds = std::chrono::seconds(std::stoll(tokens[3]));
-    msg.timestamp = std::chrono::system_clock::time_point(timestamp_seconds);
+private:
+    std::string_view data;
+    size_t position = 0;
+};
 
-    return msg;
+uint64_t toUnixMs(std::chrono::system_clock::time_point time) {
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+    return ms > 0 ? static_cast<uint64_t>(ms) : 0;
 }
 
-std::string serializeServerInfo(const ServerInfo& info) {
-    std::stringstream ss;
+std::chrono::system_clock::time_point fromUnixMs(int64_t ms) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(ms)));
+}
 
-    // Format: ID|NAME|HOST|PORT|MAX_CLIENTS|CURRENT_CLIENTS|LAST_SEEN|CONNECTED
-    ss << info.server_id << "|"
-       << info.server_name << "|"
-       << info.host << "|"
-       << info.port << "|"
-       << info.max_clients << "|"
-       << info.current_clients << "|"
-       << std::chrono::duration_cast<std::chrono::seconds>(
-           info.last_seen.time_since_epoch()).count() << "|"
-       << (info.is_connected ? "1" : "0");
+} // namespace
 
-    return ss.str();
+ServerMessage ServerMessageView::toMessage() const {
+    ServerMessage msg(type, std::string(server_id), std::string(target_server_id), std::string(payload));
+    msg.timestamp = fromUnixMs(timestamp_ms);
+    return msg;
 }
 
-ServerInfo deserializeServerInfo(const std::string& data) {
-    std::stringstream ss(data);
-    std::string token;
-    std::vector<std::string> tokens;
+ServerDecodeStatus decodeServerMessage(std::string_view data, ServerMessageView& message, size_t& consumed) {
+    // The length prefix may itself be split across reads; five bytes cover
+    // any length up to MAX_SERVER_MESSAGE_SIZE
+    uint64_t length = 0;
+    size_t prefix = 0;
+    for (int shift = 0;; shift += 7) {
+        if (prefix == data.size()) {
+            return ServerDecodeStatus::NEED_MORE;
+        }
+        if (shift > 28) {
+            return ServerDecodeStatus::INVALID;
+        }
+        uint8_t byte = static_cast<uint8_t>(data[prefix++]);
+        length |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    if (length > MAX_SERVER_MESSAGE_SIZE) {
+        return ServerDecodeStatus::INVALID;
+    }
+    if (data.size() - prefix < length) {
+        return ServerDecodeStatus::NEED_MORE;
+    }
 
-    // Split by '|'
-    while (std::getline(ss, token, '|')) {
-        tokens.push_back(token);
+    FieldReader body(data.substr(prefix, static_cast<size_t>(length)));
+    uint8_t version;
+    uint64_t type;
+    uint64_t timestamp;
+    if (!body.readByte(version) || version != INTERSERVER_WIRE_VERSION ||
+        !body.readVarint(type) || type > INT32_MAX ||
+        !body.readVarint(timestamp) || timestamp > INT64_MAX ||
+        !body.readString(message.server_id) ||
+        !body.readString(message.target_server_id) ||
+        !body.readString(message.payload)) {
+        return ServerDecodeStatus::INVALID;
     }
+    message.type = static_cast<ServerMessageType>(type);
+    message.timestamp_ms = static_cast<int64_t>(timestamp);
+    consumed = prefix + static_cast<size_t>(length);
+    return ServerDecodeStatus::OK;
+}
 
-    if (tokens.size() < 8) {
-        throw std::runtime_error("Invalid server info format");
+void appendServerMessage(std::string& out, const ServerMessage& msg) {
+    uint64_t type = static_cast<uint64_t>(static_cast<int>(msg.type));
+    uint64_t timestamp = toUnixMs(msg.timestamp);
+    size_t length = 1 + varintSize(type) + varintSize(timestamp) + stringSize(msg.server_id) +
+                    stringSize(msg.target_server_id) + stringSize(msg.payload);
+
+    out.reserve(out.size() + varintSize(length) + length);
+    appendVarint(out, length);
+    out.push_back(static_cast<char>(INTERSERVER_WIRE_VERSION));
+    appendVarint(out, type);
+    appendVarint(out, timestamp);
+    appendString(out, msg.server_id);
+    appendString(out, msg.target_server_id);
+    appendString(out, msg.payload);
+}
+
+// Message serialization functions
+std::string serializeServerMessage(const ServerMessage& msg) {
+    std::string data;
+    appendServerMessage(data, msg);
+    return data;
+}
+
+ServerMessage deserializeServerMessage(const std::string& data) {
+    ServerMessageView view;
+    size_t consumed = 0;
+    if (decodeServerMessage(data, view, consumed) != ServerDecodeStatus::OK || consumed != data.size()) {
+        throw std::runtime_error("Invalid message format");
     }
+    return view.toMessage();
+}
 
-    ServerInfo info(tokens[0], tokens[1], tokens[2], std::stoi(tokens[3]));
-    info.max_clients = std::stoi(tokens[4]);
-    info.current_clients = std::stoi(tokens[5]);
+std::string serializeServerInfo(const ServerInfo& info) {
+    std::string data;
+    data.reserve(stringSize(info.server_id) + stringSize(info.server_name) + stringSize(info.host) + 32);
+
+    // Fields: ID, NAME, HOST, PORT, MAX_CLIENTS, CURRENT_CLIENTS, LAST_SEEN (ms), CONNECTED (byte)
+    appendString(data, info.server_id);
+    appendString(data, info.server_name);
+    appendString(data, info.host);
+    appendVarint(data, static_cast<uint32_t>(info.port));
+    appendVarint(data, static_cast<uint32_t>(info.max_clients));
+    appendVarint(data, static_cast<uint32_t>(info.current_clients));
+    appendVarint(data, toUnixMs(info.last_seen));
+    data.push_back(info.is_connected ? 1 : 0);
+
+    return data;
+}
 
-    // Parse timestamp
-    auto timestamp_seconds = std::chrono::seconds(std::stoll(tokens[6]));
-    info.last_seen = std::chrono::system_clock::time_point(timestamp_seconds);
+ServerInfo deserializeServerInfo(const std::string& data) {
+    FieldReader reader(data);
+    std::string_view id, name, host;
+    uint64_t port, max_clients, current_clients, last_seen;
+    uint8_t connected;
+    if (!reader.readString(id) || !reader.readString(name) || !reader.readString(host) ||
+        !reader.readVarint(port) || !reader.readVarint(max_clients) || !reader.readVarint(current_clients) ||
+        !reader.readVarint(last_seen) || last_seen > INT64_MAX || !reader.readByte(connected)) {
+        throw std::runtime_error("Invalid server info format");
+    }
 
-    info.is_connected = (tokens[7] == "1");
+    ServerInfo info{std::string(id), std::string(name), std::string(host), static_cast<int>(static_cast<uint32_t>(port))};
+    info.max_clients = static_cast<int>(static_cast<uint32_t>(max_clients));
+    info.current_clients = static_cast<int>(static_cast<uint32_t>(current_clients));
+    info.last_seen = fromUnixMs(static_cast<int64_t>(last_seen));
+    info.is_connected = connected != 0;
 
     return info;
 }
@@ -112,12 +225,10 @@ std::string generateServerId() {
 }
 
 std::string getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+    std::string timestamp;
+    timestamp.reserve(ISO_TIME_LENGTH);
+    appendIsoTime(timestamp);
+    return timestamp;
 }
 
 bool isServerTimeout(const std::chrono::system_clock::time_point& last_seen) {
@@ -1,7 +1,10 @@
 #ifndef INTERSERVER_PROTOCOL_H
 #define INTERSERVER_PROTOCOL_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
 #include <chrono>
@@ -14,6 +17,7 @@ enum class ServerMessageType {
     SERVER_REGISTER = 102,
     SERVER_REGISTER_ACK = 103,
     SERVER_DISCONNECT = 104,
+    SERVER_HEARTBEAT = 105, // Keeps a quiet link alive; carries nothing
 
     // Message forwarding
     MSG_FORWARD_PUBLIC = 200,
@@ -93,9 +97,53 @@ const int MAX_SERVERS_PER_NETWORK = 100;
 const int SERVER_TIMEOUT_SECONDS = 300; // 5 minutes
 const int HANDSHAKE_TIMEOUT_SECONDS = 30;
 
-// Message serialization functions
+// Wire format of a server-to-server link. Each message is one frame:
+//
+//   varint  length     bytes after this field
+//   uint8   version    INTERSERVER_WIRE_VERSION
+//   varint  type       ServerMessageType
+//   varint  timestamp  milliseconds since the Unix epoch
+//   string  server_id
+//   string  target_server_id
+//   string  payload
+//
+// A varint is unsigned LEB128 (7 bits per byte, low bits first, high bit
+// set on all but the last byte); a string is a varint byte count followed
+// by the bytes. Strings may hold any byte, '|' and '\n' included. Bytes
+// after the payload are skipped, so fields can be added at the end without
+// a new version. A frame of another version, or longer than
+// MAX_SERVER_MESSAGE_SIZE, ends the link.
+const uint8_t INTERSERVER_WIRE_VERSION = 1;
+const size_t MAX_SERVER_MESSAGE_SIZE = 1024 * 1024;
+
+// A decoded frame. The strings point into the buffer it was decoded from.
+struct ServerMessageView {
+    ServerMessageType type;
+    int64_t timestamp_ms;
+    std::string_view server_id;
+    std::string_view target_server_id;
+    std::string_view payload;
+
+    ServerMessage toMessage() const; // Owning copy
+};
+
+enum class ServerDecodeStatus {
+    OK,        // `message` holds the first frame, `consumed` its size
+    NEED_MORE, // The buffer ends inside the first frame
+    INVALID    // Corrupt, too long or of an unknown version
+};
+
+// Decodes the frame at the front of `data` without copying or allocating
+ServerDecodeStatus decodeServerMessage(std::string_view data, ServerMessageView& message, size_t& consumed);
+
+// Appends one frame, so several messages can share a buffer
+void appendServerMessage(std::string& out, const ServerMessage& msg);
+
+// Message serialization functions. deserializeServerMessage expects exactly
+// one complete frame and throws std::runtime_error otherwise.
 std::string serializeServerMessage(const ServerMessage& msg);
 ServerMessage deserializeServerMessage(const std::string& data);
+// ServerInfo uses the same varint and string fields, without a frame
 std::string serializeServerInfo(const ServerInfo& info);
 ServerInfo deserializeServerInfo(const std::string& data);
 
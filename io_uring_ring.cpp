@@ -0,0 +1,399 @@
+#include "io_uring_ring.h"
+
+#ifdef CHAT_HAVE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+    int sysIoUringSetup(unsigned entries, io_uring_params* params) {
+        return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int sysIoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+        return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    int sysIoUringRegister(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+        return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+    }
+}
+
+IoUringRing::IoUringRing()
+    : ring_fd(-1), features(0),
+      sq_ring_ptr(nullptr), sq_ring_size(0), sq_head(nullptr), sq_tail(nullptr), sq_mask(nullptr),
+      sq_array(nullptr), sqes(nullptr), sqes_size(0), sq_entries(0), sqe_head(0), sqe_tail(0),
+      cq_ring_ptr(nullptr), cq_ring_size(0), cq_head(nullptr), cq_tail(nullptr), cq_mask(nullptr), cqes(nullptr),
+      buffer_ring_usable(false), legacy_buffers(false), buf_ring(nullptr), buf_ring_size(0), buffers(nullptr), buffer_count(0), buffer_size(0),
+      buffer_group(0), buf_ring_pending(0), enter_calls(0) {}
+
+IoUringRing::~IoUringRing() {
+    shutdown();
+}
+
+bool IoUringRing::init(unsigned entries) {
+    // Probe before our own ring exists so a misbehaving kernel has nothing to corrupt
+    buffer_ring_usable = probeBufferRing();
+    return setupRing(entries);
+}
+
+bool IoUringRing::setupRing(unsigned entries) {
+    io_uring_params params{};
+    int fd = sysIoUringSetup(entries, &params);
+    if (fd < 0) {
+        return false;
+    }
+    ring_fd = fd;
+    features = params.features;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring_ptr = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring_ptr == MAP_FAILED) {
+        sq_ring_ptr = nullptr;
+        shutdown();
+        return false;
+    }
+
+    if (features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring_ptr = sq_ring_ptr;
+    } else {
+        cq_ring_ptr = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring_ptr == MAP_FAILED) {
+            cq_ring_ptr = nullptr;
+            shutdown();
+            return false;
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd, IORING_OFF_SQES);
+    if (sqes_ptr == MAP_FAILED) {
+        shutdown();
+        return false;
+    }
+    sqes = static_cast<io_uring_sqe*>(sqes_ptr);
+
+    char* sq = static_cast<char*>(sq_ring_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries = params.sq_entries;
+    sqe_head = sqe_tail = *sq_tail;
+
+    char* cq = static_cast<char*>(cq_ring_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    return true;
+}
+
+void IoUringRing::shutdown() {
+    if (buf_ring) {
+        if (ring_fd >= 0) {
+            io_uring_buf_reg reg{};
+            reg.bgid = buffer_group;
+            sysIoUringRegister(ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        }
+        munmap(buf_ring, buf_ring_size);
+        buf_ring = nullptr;
+    }
+    if (sqes) {
+        munmap(sqes, sqes_size);
+        sqes = nullptr;
+    }
+    if (cq_ring_ptr && cq_ring_ptr != sq_ring_ptr) {
+        munmap(cq_ring_ptr, cq_ring_size);
+    }
+    cq_ring_ptr = nullptr;
+    if (sq_ring_ptr) {
+        munmap(sq_ring_ptr, sq_ring_size);
+        sq_ring_ptr = nullptr;
+    }
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+    // Freed last: the kernel may still reference buffers until the ring is gone
+    free(buffers);
+    buffers = nullptr;
+}
+
+bool IoUringRing::supportsOps(std::initializer_list<int> opcodes) const {
+    if (ring_fd < 0) {
+        return false;
+    }
+
+    size_t probe_size = sizeof(io_uring_probe) + IORING_OP_LAST * sizeof(io_uring_probe_op);
+    std::vector<char> storage(probe_size, 0);
+    auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (sysIoUringRegister(ring_fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) < 0) {
+        return false;
+    }
+
+    for (int opcode : opcodes) {
+        if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IoUringRing::kernelAtLeast(int major, int minor) {
+    utsname info{};
+    if (uname(&info) != 0) {
+        return false;
+    }
+    int kernel_major = 0, kernel_minor = 0;
+    if (std::sscanf(info.release, "%d.%d", &kernel_major, &kernel_minor) != 2) {
+        return false;
+    }
+    return kernel_major > major || (kernel_major == major && kernel_minor >= minor);
+}
+
+io_uring_sqe* IoUringRing::getSqe() {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    if (sqe_tail - head >= sq_entries) {
+        return nullptr;
+    }
+    io_uring_sqe* sqe = &sqes[sqe_tail & *sq_mask];
+    ++sqe_tail;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+unsigned IoUringRing::sqSpaceLeft() const {
+    unsigned head = __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+    return sq_entries - (sqe_tail - head);
+}
+
+unsigned IoUringRing::flushSubmissions() {
+    unsigned tail = *sq_tail;
+    unsigned count = sqe_tail - sqe_head;
+    for (unsigned i = 0; i < count; ++i) {
+        sq_array[tail & *sq_mask] = sqe_head & *sq_mask;
+        ++tail;
+        ++sqe_head;
+    }
+    __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+    return count;
+}
+
+int IoUringRing::submit() {
+    return submitAndWait(0);
+}
+
+int IoUringRing::submitAndWait(unsigned wait_nr) {
+    unsigned to_submit = flushSubmissions();
+    if (to_submit == 0 && wait_nr == 0) {
+        return 0;
+    }
+    enter_calls.fetch_add(1, std::memory_order_relaxed);
+    int ret = sysIoUringEnter(ring_fd, to_submit, wait_nr, wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    return ret < 0 ? -errno : ret;
+}
+
+bool IoUringRing::registerBufferRing(uint16_t group, unsigned count, unsigned size) {
+    // The kernel requires a power-of-two entry count
+    if (ring_fd < 0 || count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        return false;
+    }
+
+    buffers = static_cast<char*>(malloc(static_cast<size_t>(count) * size));
+    if (!buffers) {
+        return false;
+    }
+    buffer_count = count;
+    buffer_size = size;
+    buffer_group = group;
+
+    if (buffer_ring_usable && registerRing()) {
+        return true;
+    }
+
+    legacy_buffers = true;
+    if (provideBuffers(0, count) && buffersSelectable()) {
+        return true;
+    }
+    legacy_buffers = false;
+    free(buffers);
+    buffers = nullptr;
+    return false;
+}
+
+// Registered buffer rings misbehave on some kernels: the buffers are never
+// handed out, or the pinned ring memory ends up aliasing another ring's
+// pages. Try one in a child process first so a broken kernel cannot
+// corrupt this one.
+bool IoUringRing::probeBufferRing() {
+    pid_t pid = fork();
+    if (pid < 0) {
+        return false;
+    }
+    if (pid == 0) {
+        IoUringRing probe;
+        bool ok = probe.setupRing(8);
+        if (ok) {
+            probe.buffer_count = 8;
+            probe.buffer_size = 64;
+            probe.buffers = static_cast<char*>(malloc(probe.buffer_count * probe.buffer_size));
+            ok = probe.buffers && probe.registerRing() &&
+                 __atomic_load_n(probe.sq_head, __ATOMIC_ACQUIRE) == probe.sqe_tail;
+        }
+        _exit(ok ? 0 : 1);
+    }
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool IoUringRing::registerRing() {
+    buf_ring_size = buffer_count * sizeof(io_uring_buf);
+    void* ring_mem = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if (ring_mem == MAP_FAILED) {
+        return false;
+    }
+
+    // Fill the ring before registering it; the kernel pins whatever backs it
+    std::memset(ring_mem, 0, buf_ring_size);
+    buf_ring = static_cast<io_uring_buf_ring*>(ring_mem);
+    for (unsigned i = 0; i < buffer_count; ++i) {
+        recycleBuffer(static_cast<uint16_t>(i));
+    }
+    publishBuffers();
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring_mem);
+    reg.ring_entries = buffer_count;
+    reg.bgid = buffer_group;
+    if (sysIoUringRegister(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0) {
+        if (buffersSelectable()) {
+            return true;
+        }
+        sysIoUringRegister(ring_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+    }
+    buf_ring = nullptr;
+    munmap(ring_mem, buf_ring_size);
+    return false;
+}
+
+void IoUringRing::recycleBuffer(uint16_t buffer_id) {
+    if (legacy_buffers) {
+        io_uring_sqe* sqe = getSqe();
+        if (!sqe) {
+            submit();
+            sqe = getSqe();
+        }
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        sqe->fd = 1;
+        sqe->addr = reinterpret_cast<uint64_t>(bufferData(buffer_id));
+        sqe->len = buffer_size;
+        sqe->off = buffer_id;
+        sqe->buf_group = buffer_group;
+        sqe->user_data = INTERNAL_USER_DATA;
+        return;
+    }
+
+    unsigned index = (buf_ring->tail + buf_ring_pending) & (buffer_count - 1);
+    io_uring_buf& buf = buf_ring->bufs[index];
+    buf.addr = reinterpret_cast<uint64_t>(bufferData(buffer_id));
+    buf.len = buffer_size;
+    buf.bid = buffer_id;
+    ++buf_ring_pending;
+}
+
+void IoUringRing::publishBuffers() {
+    if (!buf_ring || buf_ring_pending == 0) {
+        return;
+    }
+    __atomic_store_n(&buf_ring->tail, static_cast<uint16_t>(buf_ring->tail + buf_ring_pending), __ATOMIC_RELEASE);
+    buf_ring_pending = 0;
+}
+
+// Only valid during setup, while no other operation is outstanding
+int IoUringRing::waitInternalCompletion() {
+    if (submitAndWait(1) < 0) {
+        return -EIO;
+    }
+    unsigned head = *cq_head;
+    if (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        return -EIO;
+    }
+    io_uring_cqe cqe = cqes[head & *cq_mask];
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+
+    if (cqe.res >= 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+        recycleBuffer(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+        publishBuffers();
+        if (legacy_buffers) {
+            waitInternalCompletion();
+        }
+    }
+    return cqe.res;
+}
+
+bool IoUringRing::provideBuffers(uint16_t first_id, unsigned count) {
+    io_uring_sqe* sqe = getSqe();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(bufferData(first_id));
+    sqe->len = buffer_size;
+    sqe->off = first_id;
+    sqe->buf_group = buffer_group;
+    sqe->user_data = INTERNAL_USER_DATA;
+    return waitInternalCompletion() >= 0;
+}
+
+// Receive one byte through buffer selection to prove the kernel really
+// hands out our buffers
+bool IoUringRing::buffersSelectable() {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        return false;
+    }
+
+    bool ok = false;
+    io_uring_sqe* sqe = getSqe();
+    if (sqe && write(pair[1], "x", 1) == 1) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = pair[0];
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = buffer_group;
+        sqe->user_data = INTERNAL_USER_DATA;
+        ok = waitInternalCompletion() == 1;
+    }
+
+    close(pair[0]);
+    close(pair[1]);
+    return ok;
+}
+
+#endif // CHAT_HAVE_IO_URING
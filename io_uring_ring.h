@@ -0,0 +1,129 @@
+#ifndef IO_URING_RING_H
+#define IO_URING_RING_H
+
+// Minimal io_uring wrapper built directly on the kernel ABI, so the server
+// does not need liburing. Only compiled in on Linux with io_uring headers.
+#if defined(__linux__) && defined(__has_include)
+    #if __has_include(<linux/io_uring.h>)
+        #define CHAT_HAVE_IO_URING 1
+    #endif
+#endif
+
+#ifdef CHAT_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+class IoUringRing {
+private:
+    int ring_fd;
+    unsigned features;
+
+    // Submission queue
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned sq_entries;
+    unsigned sqe_head;  // First SQE not yet handed to the kernel
+    unsigned sqe_tail;  // Next SQE to hand out
+
+    // Completion queue
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    io_uring_cqe* cqes;
+
+    // Provided buffers for multishot recv: a registered buffer ring when the
+    // kernel honours it, otherwise IORING_OP_PROVIDE_BUFFERS
+    bool buffer_ring_usable;
+    bool legacy_buffers;
+    io_uring_buf_ring* buf_ring;
+    size_t buf_ring_size;
+    char* buffers;
+    unsigned buffer_count;
+    unsigned buffer_size;
+    uint16_t buffer_group;
+    unsigned buf_ring_pending; // Recycled buffers not yet published
+
+    std::atomic<uint64_t> enter_calls;
+
+public:
+    // user_data reserved for the ring's own bookkeeping SQEs
+    static constexpr uint64_t INTERNAL_USER_DATA = 0;
+
+    IoUringRing();
+    ~IoUringRing();
+
+    IoUringRing(const IoUringRing&) = delete;
+    IoUringRing& operator=(const IoUringRing&) = delete;
+
+    // Lifecycle. init() returns false when the kernel has no io_uring.
+    bool init(unsigned entries);
+    void shutdown();
+    bool isInitialized() const { return ring_fd >= 0; }
+
+    // Capability checks
+    bool supportsOps(std::initializer_list<int> opcodes) const;
+    static bool kernelAtLeast(int major, int minor);
+
+    // Submission. getSqe() returns a zeroed SQE or nullptr if the SQ is full.
+    io_uring_sqe* getSqe();
+    unsigned sqSpaceLeft() const;
+    int submit();
+    int submitAndWait(unsigned wait_nr);
+
+    // Completion. Calls handler(const io_uring_cqe&) for every ready CQE.
+    template <typename Handler>
+    unsigned forEachCompletion(Handler&& handler) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        unsigned seen = 0;
+        while (head != tail) {
+            io_uring_cqe cqe = cqes[head & *cq_mask];
+            ++head;
+            ++seen;
+            // Release the slot before the handler may queue more work
+            __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+            if (cqe.user_data != INTERNAL_USER_DATA) {
+                handler(cqe);
+            }
+        }
+        publishBuffers();
+        return seen;
+    }
+
+    // Provided buffers
+    bool registerBufferRing(uint16_t group, unsigned count, unsigned size);
+    uint16_t bufferGroup() const { return buffer_group; }
+    unsigned bufferSize() const { return buffer_size; }
+    const char* bufferData(uint16_t buffer_id) const { return buffers + static_cast<size_t>(buffer_id) * buffer_size; }
+    void recycleBuffer(uint16_t buffer_id);
+    bool usesLegacyBuffers() const { return legacy_buffers; }
+
+    // Statistics
+    uint64_t getEnterCalls() const { return enter_calls.load(std::memory_order_relaxed); }
+
+private:
+    unsigned flushSubmissions();
+    void publishBuffers();
+    bool setupRing(unsigned entries);
+    static bool probeBufferRing();
+    bool registerRing();
+    bool buffersSelectable();
+    bool provideBuffers(uint16_t first_id, unsigned count);
+    int waitInternalCompletion();
+};
+
+#endif // CHAT_HAVE_IO_URING
+
+#endif // IO_URING_RING_H
@@ -0,0 +1,114 @@
+#include "line_decoder.h"
+#include <algorithm>
+#include <cstring>
+
+LineDecoder::LineDecoder(size_t max_line_length)
+    : mask(0), max_line_length(max_line_length), head(0), tail(0), scanned(0), discarding(false) {
+    // Room for a maximal line plus "\r\n", and never smaller than one recv
+    size_t capacity = 1024;
+    while (capacity < max_line_length + 2) {
+        capacity <<= 1;
+    }
+    ring.resize(capacity);
+    mask = capacity - 1;
+}
+
+char* LineDecoder::writePtr() {
+    return ring.data() + (tail & mask);
+}
+
+size_t LineDecoder::writableBytes() const {
+    size_t free_bytes = ring.size() - buffered();
+    size_t to_end = ring.size() - static_cast<size_t>(tail & mask);
+    return std::min(free_bytes, to_end);
+}
+
+void LineDecoder::commit(size_t bytes) {
+    tail += bytes;
+}
+
+size_t LineDecoder::append(const char* data, size_t length) {
+    size_t copied = 0;
+    while (copied < length) {
+        size_t chunk = std::min(length - copied, writableBytes());
+        if (chunk == 0) {
+            break;
+        }
+        std::memcpy(writePtr(), data + copied, chunk);
+        commit(chunk);
+        copied += chunk;
+    }
+    return copied;
+}
+
+bool LineDecoder::findNewline(uint64_t& position) {
+    while (scanned < tail) {
+        size_t offset = static_cast<size_t>(scanned & mask);
+        size_t length = static_cast<size_t>(std::min<uint64_t>(tail - scanned, ring.size() - offset));
+        const char* start = ring.data() + offset;
+        const void* found = std::memchr(start, '\n', length);
+        if (found) {
+            position = scanned + static_cast<size_t>(static_cast<const char*>(found) - start);
+            scanned = position + 1;
+            return true;
+        }
+        scanned += length;
+    }
+    return false;
+}
+
+LineDecoder::Status LineDecoder::next(std::string_view& line) {
+    uint64_t newline;
+    while (discarding) {
+        if (!findNewline(newline)) {
+            head = tail;
+            return Status::NEED_MORE;
+        }
+        head = newline + 1;
+        discarding = false;
+    }
+
+    if (!findNewline(newline)) {
+        if (buffered() > max_line_length + 1) { // +1 for a pending '\r'
+            head = tail;
+            discarding = true;
+            return Status::TOO_LONG;
+        }
+        if (head == tail) {
+            // Empty: restart at the front so the next recv is contiguous
+            head = tail = scanned = 0;
+        }
+        return Status::NEED_MORE;
+    }
+
+    size_t length = static_cast<size_t>(newline - head);
+    size_t offset = static_cast<size_t>(head & mask);
+    head = newline + 1;
+    if (length > 0 && ring[(newline - 1) & mask] == '\r') {
+        --length;
+    }
+    if (length > max_line_length) {
+        return Status::TOO_LONG;
+    }
+
+    if (offset + length <= ring.size()) {
+        line = std::string_view(ring.data() + offset, length);
+    } else {
+        size_t first = ring.size() - offset;
+        scratch.assign(ring.data() + offset, first);
+        scratch.append(ring.data(), length - first);
+        line = scratch;
+    }
+    return Status::LINE;
+}
+
+void LineDecoder::drainBuffered(std::string& out) {
+    while (head < tail) {
+        size_t offset = static_cast<size_t>(head & mask);
+        size_t length = static_cast<size_t>(std::min<uint64_t>(tail - head, ring.size() - offset));
+        out.append(ring.data() + offset, length);
+        head += length;
+    }
+    head = tail = scanned = 0;
+    discarding = false;
+}
@@ -0,0 +1,59 @@
+#ifndef LINE_DECODER_H
+#define LINE_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Longest chat line accepted from a client, excluding the line ending
+const size_t DEFAULT_MAX_LINE_LENGTH = 4096;
+
+// Incremental '\n' framing over a per-connection receive ring buffer.
+// Bytes are received straight into the ring (writePtr/commit) or copied in
+// (append); next() then hands out every complete line as a string_view into
+// the ring, so one recv can yield many messages and a message can span
+// several recvs.
+class LineDecoder {
+public:
+    enum class Status {
+        LINE,       // `line` holds the next message, without "\r\n"
+        NEED_MORE,  // No complete line buffered
+        TOO_LONG    // A line exceeded the limit and is being discarded
+    };
+
+    explicit LineDecoder(size_t max_line_length = DEFAULT_MAX_LINE_LENGTH);
+
+    // Contiguous free space for recv(); commit() what was written
+    char* writePtr();
+    size_t writableBytes() const;
+    void commit(size_t bytes);
+
+    // Copies as much of data as fits and returns the number of bytes taken
+    size_t append(const char* data, size_t length);
+
+    // The returned view stays valid until the next commit() or append()
+    Status next(std::string_view& line);
+
+    // Moves every byte not yet returned as a line into `out` and empties the
+    // decoder; used when a connection switches to another framing
+    void drainBuffered(std::string& out);
+
+    size_t buffered() const { return static_cast<size_t>(tail - head); }
+    size_t maxLineLength() const { return max_line_length; }
+
+private:
+    std::vector<char> ring;
+    size_t mask;
+    size_t max_line_length;
+    uint64_t head;        // First unconsumed byte
+    uint64_t tail;        // One past the last received byte
+    uint64_t scanned;     // Bytes before this are known not to hold '\n'
+    bool discarding;      // Dropping the rest of an over-long line
+    std::string scratch;  // Lines that wrap around the end of the ring
+
+    bool findNewline(uint64_t& position);
+};
+
+#endif // LINE_DECODER_H
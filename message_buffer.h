@@ -0,0 +1,16 @@
+#ifndef MESSAGE_BUFFER_H
+#define MESSAGE_BUFFER_H
+
+#include <memory>
+#include <string>
+
+// Immutable, reference-counted wire bytes. A broadcast is formatted once and
+// every recipient's output queue holds a reference to the same buffer, which
+// is freed once the last recipient has written it.
+typedef std::shared_ptr<const std::string> MessageBuffer;
+
+inline MessageBuffer makeMessageBuffer(std::string bytes) {
+    return std::make_shared<const std::string>(std::move(bytes));
+}
+
+#endif // MESSAGE_BUFFER_H
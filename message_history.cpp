@@ -0,0 +1,49 @@
+#include "message_history.h"
+#include <algorithm>
+
+MessageHistory::MessageHistory(const HistoryLimits& limits)
+    : ring_capacity(0), head(0), count(0), bytes(0), max_bytes(limits.max_bytes) {
+    if (limits.max_messages > 0) {
+        ring_capacity = 1;
+        while (ring_capacity < limits.max_messages) {
+            ring_capacity <<= 1;
+        }
+    }
+}
+
+void MessageHistory::dropOldest() {
+    bytes -= ring[head]->size();
+    ring[head].reset();
+    head = (head + 1) & (ring_capacity - 1);
+    --count;
+}
+
+void MessageHistory::append(const MessageBuffer& message) {
+    if (ring_capacity == 0 || message->size() > max_bytes) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ring.empty()) {
+        ring.resize(ring_capacity);
+    }
+    if (count == ring.size()) {
+        dropOldest();
+    }
+    while (count > 0 && bytes + message->size() > max_bytes) {
+        dropOldest();
+    }
+    ring[(head + count) & (ring_capacity - 1)] = message;
+    bytes += message->size();
+    ++count;
+}
+
+std::vector<MessageBuffer> MessageHistory::recent(size_t limit) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t n = std::min(limit, count);
+    std::vector<MessageBuffer> messages;
+    messages.reserve(n);
+    for (size_t i = count - n; i < count; ++i) {
+        messages.push_back(ring[(head + i) & (ring_capacity - 1)]);
+    }
+    return messages;
+}
@@ -0,0 +1,51 @@
+#ifndef MESSAGE_HISTORY_H
+#define MESSAGE_HISTORY_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "message_buffer.h"
+
+const size_t DEFAULT_HISTORY_MESSAGES = 128;       // Per room
+const size_t DEFAULT_HISTORY_BYTES = 64 * 1024;    // Per room
+const size_t DEFAULT_HISTORY_REPLAY = 20;          // Replayed when joining a room
+
+struct HistoryLimits {
+    size_t max_messages; // Ring capacity, rounded up to a power of two; 0 disables history
+    size_t max_bytes;    // Oldest messages are dropped past this many bytes
+    size_t replay_count; // Messages replayed on joining a room
+
+    HistoryLimits() : max_messages(DEFAULT_HISTORY_MESSAGES),
+                      max_bytes(DEFAULT_HISTORY_BYTES),
+                      replay_count(DEFAULT_HISTORY_REPLAY) {}
+};
+
+// Fixed-capacity ring of a room's recent chat lines. Entries are the same
+// MessageBuffers live delivery queued, so recording a message and replaying
+// it later cost a reference count each, never a copy or a re-format. The
+// ring is one contiguous array indexed with a mask, allocated only once
+// the room has something to keep. Thread-safe.
+class MessageHistory {
+private:
+    mutable std::mutex mutex;
+    std::vector<MessageBuffer> ring; // Allocated on the first append
+    size_t ring_capacity;
+    size_t head;   // Index of the oldest message
+    size_t count;
+    size_t bytes;  // Total size of the held messages
+    size_t max_bytes;
+
+    void dropOldest();
+
+public:
+    explicit MessageHistory(const HistoryLimits& limits);
+
+    void append(const MessageBuffer& message);
+
+    // Up to `limit` most recent messages, oldest first
+    std::vector<MessageBuffer> recent(size_t limit) const;
+
+    size_t capacity() const { return ring_capacity; }
+};
+
+#endif // MESSAGE_HISTORY_H
@@ -0,0 +1,682 @@
+#include "message_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static void putUint16(char* out, uint16_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+}
+
+static void putUint32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static void putUint64(char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static uint16_t getUint16(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t getUint32(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static uint64_t getUint64(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+struct Crc32Table {
+    uint32_t entries[256];
+
+    Crc32Table() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+    }
+};
+
+uint32_t crc32(const char* data, size_t length) {
+    static const Crc32Table table;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table.entries[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+MessageStore::MessageStore(const MessageStoreConfig& config)
+    : config(config), next_sequence(1), stopping(false), durable_sequence(0), dropped(0), syncs(0), failed(false) {
+    this->config.segment_bytes = std::max<size_t>(this->config.segment_bytes, 4096);
+    this->config.index_interval_bytes = std::max<size_t>(this->config.index_interval_bytes, 1);
+    this->config.queue_size = std::max<size_t>(this->config.queue_size, 2);
+}
+
+MessageStore::~MessageStore() {
+    stop();
+}
+
+uint64_t MessageStore::append(std::string_view room, std::string_view username, std::string_view text) {
+    room = room.substr(0, UINT16_MAX);
+    username = username.substr(0, UINT16_MAX);
+
+    // Encoded outside the lock; the writer fills in the CRC
+    size_t body_size = RECORD_FIXED_BODY + room.size() + username.size() + text.size();
+    std::string record(RECORD_HEADER_SIZE + RECORD_FIXED_BODY, '\0');
+    record.reserve(RECORD_HEADER_SIZE + body_size);
+    putUint32(&record[0], static_cast<uint32_t>(body_size));
+    putUint16(&record[RECORD_HEADER_SIZE + 16], static_cast<uint16_t>(room.size()));
+    putUint16(&record[RECORD_HEADER_SIZE + 18], static_cast<uint16_t>(username.size()));
+    record.append(room).append(username).append(text);
+
+    uint64_t sequence;
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (stopping || !writer.joinable() || pending.size() >= config.queue_size ||
+            failed.load(std::memory_order_relaxed)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+        // Stamped under the lock so sequence and time order agree
+        sequence = next_sequence++;
+        putUint64(&record[RECORD_HEADER_SIZE], sequence);
+        putUint64(&record[RECORD_HEADER_SIZE + 8], static_cast<uint64_t>(nowMs()));
+        pending.push_back(std::move(record));
+        wake = (pending.size() == config.queue_size / 2);
+    }
+    if (wake) {
+        // Half full: write now rather than at the end of the interval
+        queue_cv.notify_one();
+    }
+    return sequence;
+}
+
+uint64_t MessageStore::nextSequence() const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    return next_sequence;
+}
+
+size_t MessageStore::segmentCount() const {
+    std::lock_guard<std::mutex> lock(segments_mutex);
+    return segments.size();
+}
+
+std::string MessageStore::segmentPath(uint64_t base_sequence, const char* extension) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%020llu", static_cast<unsigned long long>(base_sequence));
+    return config.directory + "/" + name + extension;
+}
+
+#ifndef _WIN32
+
+MessageStore::Segment::~Segment() {
+    if (index_map != nullptr) {
+        munmap(const_cast<char*>(index_map), index_map_bytes);
+    }
+    if (log_fd >= 0) {
+        ::close(log_fd);
+    }
+    if (index_fd >= 0) {
+        ::close(index_fd);
+    }
+}
+
+size_t MessageStore::Segment::indexSize() const {
+    return index_map != nullptr ? index_map_bytes / INDEX_ENTRY_SIZE : live_index.size();
+}
+
+MessageStore::IndexEntry MessageStore::Segment::indexAt(size_t i) const {
+    if (index_map == nullptr) {
+        return live_index[i];
+    }
+    const char* entry = index_map + i * INDEX_ENTRY_SIZE;
+    return IndexEntry{getUint64(entry), static_cast<int64_t>(getUint64(entry + 8)), getUint64(entry + 16)};
+}
+
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+static int syncData(int fd) {
+    #ifdef __linux__
+    return fdatasync(fd);
+    #else
+    return fsync(fd);
+    #endif
+}
+
+// Calls fn(offset, body, body_length) for each intact record between
+// `offset` and `end`. Returns the offset of the first record that was torn,
+// corrupt or refused by fn (by returning false), or where the scan ended.
+// Reads `chunk_bytes` at a time (more for a record that does not fit).
+template <typename Fn>
+static uint64_t forEachRecord(int fd, uint64_t offset, uint64_t end, Fn&& fn, size_t chunk_bytes = 256 * 1024) {
+    std::vector<char> buffer(chunk_bytes);
+    while (offset + 8 <= end) {
+        size_t want = static_cast<size_t>(std::min<uint64_t>(buffer.size(), end - offset));
+        ssize_t got = pread(fd, buffer.data(), want, static_cast<off_t>(offset));
+        if (got < 8) {
+            break;
+        }
+        size_t position = 0;
+        while (position + 8 <= static_cast<size_t>(got)) {
+            uint32_t body_length = getUint32(&buffer[position]);
+            if (body_length < 20 || body_length > 64 * 1024 * 1024) {
+                return offset + position; // Corrupt length
+            }
+            size_t record_length = 8 + static_cast<size_t>(body_length);
+            if (position + record_length > static_cast<size_t>(got)) {
+                if (offset + position + record_length > end) {
+                    return offset + position; // Torn record
+                }
+                if (position == 0) {
+                    buffer.resize(record_length); // Larger than the buffer
+                }
+                break;
+            }
+            const char* body = &buffer[position + 8];
+            if (crc32(body, body_length) != getUint32(&buffer[position + 4])) {
+                return offset + position;
+            }
+            if (!fn(offset + position, body, static_cast<size_t>(body_length))) {
+                return offset + position;
+            }
+            position += record_length;
+        }
+        offset += position;
+    }
+    return offset;
+}
+
+static StoredMessage decodeRecord(const char* body, size_t length) {
+    StoredMessage message;
+    message.sequence = getUint64(body);
+    message.timestamp_ms = static_cast<int64_t>(getUint64(body + 8));
+    size_t room_length = getUint16(body + 16);
+    size_t user_length = getUint16(body + 18);
+    size_t header = 20;
+    room_length = std::min(room_length, length - header);
+    user_length = std::min(user_length, length - header - room_length);
+    message.room.assign(body + header, room_length);
+    message.username.assign(body + header + room_length, user_length);
+    message.text.assign(body + header + room_length + user_length, length - header - room_length - user_length);
+    return message;
+}
+
+// The text of an encoded record, as queued by append()
+static std::string_view recordText(const std::string& record) {
+    const char* body = record.data() + 8;
+    size_t skip = 20 + getUint16(body + 16) + getUint16(body + 18);
+    return std::string_view(record).substr(std::min(8 + skip, record.size()));
+}
+
+bool MessageStore::start() {
+    if (writer.joinable()) {
+        return true;
+    }
+    if (mkdir(config.directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        return false;
+    }
+
+    std::vector<uint64_t> bases;
+    DIR* dir = opendir(config.directory.c_str());
+    if (dir == nullptr) {
+        return false;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() == 24 && name.compare(20, 4, ".seg") == 0 &&
+            name.find_first_not_of("0123456789") == 20) {
+            bases.push_back(std::stoull(name.substr(0, 20)));
+        }
+    }
+    closedir(dir);
+    std::sort(bases.begin(), bases.end());
+
+    uint64_t last_sequence = 0;
+    for (size_t i = 0; i < bases.size(); ++i) {
+        if (!openSegment(bases[i], false)) {
+            return false;
+        }
+        Segment& segment = *segments.back();
+        struct stat index_stat;
+        bool sealed = (i + 1 < bases.size());
+        if (sealed && fstat(segment.index_fd, &index_stat) == 0 && index_stat.st_size > 0) {
+            struct stat log_stat;
+            fstat(segment.log_fd, &log_stat);
+            segment.written_bytes.store(static_cast<uint64_t>(log_stat.st_size));
+            segment.index_map_bytes = static_cast<size_t>(index_stat.st_size) / INDEX_ENTRY_SIZE * INDEX_ENTRY_SIZE;
+            void* map = mmap(nullptr, segment.index_map_bytes, PROT_READ, MAP_SHARED, segment.index_fd, 0);
+            if (map == MAP_FAILED) {
+                return false;
+            }
+            segment.index_map = static_cast<const char*>(map);
+            continue;
+        }
+        // The active segment, or a sealed one that lost its index
+        uint64_t segment_last = 0;
+        if (!recoverActive(segment, segment_last)) {
+            return false;
+        }
+        last_sequence = std::max(last_sequence, segment_last);
+        if (sealed && !sealSegment(segment)) {
+            return false;
+        }
+    }
+
+    if (segments.empty()) {
+        if (!openSegment(1, true)) {
+            return false;
+        }
+    } else if (last_sequence == 0) {
+        last_sequence = segments.back()->base_sequence - 1;
+    }
+
+    next_sequence = std::max(last_sequence + 1, segments.back()->base_sequence);
+    durable_sequence.store(next_sequence - 1);
+    stopping = false;
+    writer = std::thread(&MessageStore::writerLoop, this);
+    return true;
+}
+
+void MessageStore::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!writer.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    queue_cv.notify_one();
+    writer.join();
+}
+
+bool MessageStore::openSegment(uint64_t base_sequence, bool create) {
+    auto segment = std::make_shared<Segment>();
+    segment->base_sequence = base_sequence;
+    int flags = O_RDWR | O_APPEND | (create ? O_CREAT | O_TRUNC : 0);
+    segment->log_fd = ::open(segmentPath(base_sequence, ".seg").c_str(), flags, 0644);
+    segment->index_fd = ::open(segmentPath(base_sequence, ".idx").c_str(), O_RDWR | O_APPEND | O_CREAT, 0644);
+    if (segment->log_fd < 0 || segment->index_fd < 0) {
+        return false;
+    }
+    if (create && ftruncate(segment->index_fd, 0) != 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(segments_mutex);
+    segments.push_back(std::move(segment));
+    return true;
+}
+
+// Validates every record, cuts off a torn or corrupt tail and rebuilds the
+// segment's index from what is left
+bool MessageStore::recoverActive(Segment& segment, uint64_t& last_sequence) {
+    struct stat log_stat;
+    if (fstat(segment.log_fd, &log_stat) != 0) {
+        return false;
+    }
+    std::vector<IndexEntry> index;
+    std::string index_bytes;
+    uint64_t last_indexed = 0;
+    uint64_t expected = segment.base_sequence;
+    uint64_t valid = forEachRecord(segment.log_fd, 0, static_cast<uint64_t>(log_stat.st_size),
+                                   [&](uint64_t offset, const char* body, size_t) {
+        uint64_t sequence = getUint64(body);
+        if (sequence != expected) {
+            return false;
+        }
+        if (index.empty() || offset - last_indexed >= config.index_interval_bytes) {
+            index.push_back(IndexEntry{sequence, static_cast<int64_t>(getUint64(body + 8)), offset});
+            char entry[INDEX_ENTRY_SIZE];
+            putUint64(entry, sequence);
+            std::memcpy(entry + 8, body + 8, 8);
+            putUint64(entry + 16, offset);
+            index_bytes.append(entry, INDEX_ENTRY_SIZE);
+            last_indexed = offset;
+        }
+        last_sequence = sequence;
+        ++expected;
+        return true;
+    });
+    if (valid < static_cast<uint64_t>(log_stat.st_size) && ftruncate(segment.log_fd, static_cast<off_t>(valid)) != 0) {
+        return false;
+    }
+    if (ftruncate(segment.index_fd, 0) != 0 || !writeAll(segment.index_fd, index_bytes.data(), index_bytes.size())) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(segments_mutex);
+    segment.live_index = std::move(index);
+    segment.last_indexed_offset = last_indexed;
+    segment.written_bytes.store(valid, std::memory_order_release);
+    return true;
+}
+
+// Makes a finished segment durable and switches its index to an mmap
+bool MessageStore::sealSegment(Segment& segment) {
+    if (syncData(segment.log_fd) != 0 || syncData(segment.index_fd) != 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(segments_mutex);
+    size_t bytes = segment.live_index.size() * INDEX_ENTRY_SIZE;
+    if (bytes == 0) {
+        return true;
+    }
+    void* map = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, segment.index_fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    segment.index_map = static_cast<const char*>(map);
+    segment.index_map_bytes = bytes;
+    segment.live_index.clear();
+    segment.live_index.shrink_to_fit();
+    return true;
+}
+
+void MessageStore::writerLoop() {
+    std::vector<std::string> batch;
+    auto interval = std::chrono::milliseconds(std::max(1, config.sync_interval_ms));
+    while (true) {
+        bool done;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait_for(lock, interval, [this]() {
+                return stopping || pending.size() >= config.queue_size / 2;
+            });
+            batch.swap(pending);
+            done = stopping;
+        }
+        if (!batch.empty()) {
+            if (failed.load(std::memory_order_relaxed)) {
+                dropped.fetch_add(batch.size(), std::memory_order_relaxed);
+            } else {
+                writeBatch(batch);
+            }
+            batch.clear();
+        }
+        if (done) {
+            break;
+        }
+    }
+}
+
+// One group commit: every queued record in one write, then one fdatasync.
+// If a write fails the segment is cut back to what was written before it
+// and the store stops writing: a later record after the gap would be cut
+// off by recovery, and readers must never see bytes that are not there.
+bool MessageStore::writeBatch(std::vector<std::string>& batch) {
+    std::shared_ptr<Segment> active;
+    {
+        std::lock_guard<std::mutex> lock(segments_mutex);
+        active = segments.back();
+    }
+
+    std::string buffer;
+    std::string index_bytes;
+    std::vector<IndexEntry> new_entries;
+    uint64_t offset = active->written_bytes.load(std::memory_order_relaxed);
+    uint64_t last_sequence = 0;
+    uint64_t committed_offset = offset;
+    uint64_t committed_indexed = active->last_indexed_offset;
+    size_t committed_records = 0;
+    size_t buffered_records = 0;
+    bool ok = true;
+
+    auto flush = [&]() {
+        if (!writeAll(active->log_fd, buffer.data(), buffer.size()) ||
+            !writeAll(active->index_fd, index_bytes.data(), index_bytes.size())) {
+            size_t index_size;
+            {
+                std::lock_guard<std::mutex> lock(segments_mutex);
+                index_size = active->live_index.size() * INDEX_ENTRY_SIZE;
+            }
+            // Cut both files back to what readers and the index know about.
+            // Should that fail too, written_bytes still bounds readers and
+            // start() trims the tail.
+            int truncated = ftruncate(active->log_fd, static_cast<off_t>(committed_offset));
+            truncated |= ftruncate(active->index_fd, static_cast<off_t>(index_size));
+            (void)truncated;
+            active->last_indexed_offset = committed_indexed;
+            failed.store(true, std::memory_order_relaxed);
+            dropped.fetch_add(batch.size() - committed_records, std::memory_order_relaxed);
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(segments_mutex);
+            active->live_index.insert(active->live_index.end(), new_entries.begin(), new_entries.end());
+        }
+        active->written_bytes.store(offset, std::memory_order_release);
+        if (written_handler) {
+            for (size_t i = committed_records; i < committed_records + buffered_records; ++i) {
+                written_handler(getUint64(&batch[i][RECORD_HEADER_SIZE]), recordText(batch[i]));
+            }
+        }
+        committed_offset = offset;
+        committed_indexed = active->last_indexed_offset;
+        committed_records += buffered_records;
+        ok = (syncData(active->log_fd) == 0) && ok;
+        syncs.fetch_add(1, std::memory_order_relaxed);
+        buffer.clear();
+        index_bytes.clear();
+        new_entries.clear();
+        buffered_records = 0;
+        return true;
+    };
+
+    for (std::string& record : batch) {
+        uint64_t sequence = getUint64(&record[RECORD_HEADER_SIZE]);
+        if (offset > 0 && offset + record.size() > config.segment_bytes) {
+            // Roll: finish the current segment and start one at this record
+            if (!flush()) {
+                return false;
+            }
+            ok = sealSegment(*active) && ok;
+            if (!openSegment(sequence, true)) {
+                failed.store(true, std::memory_order_relaxed);
+                dropped.fetch_add(batch.size() - committed_records, std::memory_order_relaxed);
+                return false;
+            }
+            std::lock_guard<std::mutex> lock(segments_mutex);
+            active = segments.back();
+            offset = 0;
+            committed_offset = 0;
+            committed_indexed = 0;
+        }
+        putUint32(&record[4], crc32(record.data() + RECORD_HEADER_SIZE, record.size() - RECORD_HEADER_SIZE));
+        if (offset == 0 || offset - active->last_indexed_offset >= config.index_interval_bytes) {
+            char entry[INDEX_ENTRY_SIZE];
+            putUint64(entry, sequence);
+            std::memcpy(entry + 8, &record[RECORD_HEADER_SIZE + 8], 8);
+            putUint64(entry + 16, offset);
+            index_bytes.append(entry, INDEX_ENTRY_SIZE);
+            new_entries.push_back(IndexEntry{sequence, static_cast<int64_t>(getUint64(entry + 8)), offset});
+            active->last_indexed_offset = offset;
+        }
+        buffer.append(record);
+        offset += record.size();
+        last_sequence = sequence;
+        ++buffered_records;
+    }
+    if (!flush()) {
+        return false;
+    }
+    if (ok) {
+        durable_sequence.store(last_sequence, std::memory_order_release);
+    }
+    return ok;
+}
+
+size_t MessageStore::scanSegment(const std::shared_ptr<Segment>& segment, uint64_t offset, uint64_t from,
+                                 size_t limit, std::vector<StoredMessage>& out) const {
+    size_t added = 0;
+    uint64_t end = segment->written_bytes.load(std::memory_order_acquire);
+    // A point lookup (search results) is one index interval from `offset`
+    size_t chunk = limit <= 16 ? std::max<size_t>(16 * 1024, 2 * config.index_interval_bytes) : 256 * 1024;
+    forEachRecord(segment->log_fd, offset, end, [&](uint64_t, const char* body, size_t length) {
+        if (getUint64(body) < from) {
+            return true;
+        }
+        out.push_back(decodeRecord(body, length));
+        return ++added < limit;
+    }, chunk);
+    return added;
+}
+
+size_t MessageStore::readFrom(uint64_t from, size_t limit, std::vector<StoredMessage>& out) const {
+    std::vector<std::shared_ptr<Segment>> tail;
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(segments_mutex);
+        // Last segment starting at or before `from`
+        auto it = std::upper_bound(segments.begin(), segments.end(), from,
+                                   [](uint64_t sequence, const std::shared_ptr<Segment>& segment) {
+                                       return sequence < segment->base_sequence;
+                                   });
+        if (it != segments.begin()) {
+            --it;
+        }
+        if (it == segments.end()) {
+            return 0;
+        }
+        // Last index entry at or before `from`
+        const Segment& segment = **it;
+        size_t low = 0, high = segment.indexSize();
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (segment.indexAt(mid).sequence <= from) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low > 0) {
+            offset = segment.indexAt(low - 1).offset;
+        }
+        tail.assign(it, segments.end());
+    }
+
+    size_t added = 0;
+    for (size_t i = 0; i < tail.size() && added < limit; ++i) {
+        added += scanSegment(tail[i], i == 0 ? offset : 0, from, limit - added, out);
+    }
+    return added;
+}
+
+uint64_t MessageStore::seekTime(int64_t timestamp_ms) const {
+    std::vector<std::shared_ptr<Segment>> tail;
+    uint64_t offset = 0;
+    {
+        std::lock_guard<std::mutex> lock(segments_mutex);
+        // Last segment whose first record is older than the target
+        size_t first = 0;
+        for (size_t low = 0, high = segments.size(); low < high;) {
+            size_t mid = (low + high) / 2;
+            const Segment& segment = *segments[mid];
+            if (segment.indexSize() > 0 && segment.indexAt(0).timestamp_ms < timestamp_ms) {
+                first = mid;
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (first < segments.size()) {
+            const Segment& segment = *segments[first];
+            size_t low = 0, high = segment.indexSize();
+            while (low < high) {
+                size_t mid = (low + high) / 2;
+                if (segment.indexAt(mid).timestamp_ms < timestamp_ms) {
+                    low = mid + 1;
+                } else {
+                    high = mid;
+                }
+            }
+            if (low > 0) {
+                offset = segment.indexAt(low - 1).offset;
+            }
+            tail.assign(segments.begin() + static_cast<std::ptrdiff_t>(first), segments.end());
+        }
+    }
+
+    for (size_t i = 0; i < tail.size(); ++i) {
+        uint64_t found = 0;
+        uint64_t end = tail[i]->written_bytes.load(std::memory_order_acquire);
+        forEachRecord(tail[i]->log_fd, i == 0 ? offset : 0, end, [&](uint64_t, const char* body, size_t) {
+            if (static_cast<int64_t>(getUint64(body + 8)) >= timestamp_ms) {
+                found = getUint64(body);
+                return false;
+            }
+            return true;
+        });
+        if (found != 0) {
+            return found;
+        }
+    }
+    return nextSequence();
+}
+
+#else // _WIN32: the store needs pread, fdatasync and mmap; it stays disabled
+
+MessageStore::Segment::~Segment() {}
+size_t MessageStore::Segment::indexSize() const { return live_index.size(); }
+MessageStore::IndexEntry MessageStore::Segment::indexAt(size_t i) const { return live_index[i]; }
+
+bool MessageStore::start() { return false; }
+void MessageStore::stop() {}
+void MessageStore::writerLoop() {}
+bool MessageStore::writeBatch(std::vector<std::string>&) { return false; }
+bool MessageStore::openSegment(uint64_t, bool) { return false; }
+bool MessageStore::recoverActive(Segment&, uint64_t&) { return false; }
+bool MessageStore::sealSegment(Segment&) { return false; }
+size_t MessageStore::scanSegment(const std::shared_ptr<Segment>&, uint64_t, uint64_t, size_t,
+                                 std::vector<StoredMessage>&) const { return 0; }
+size_t MessageStore::readFrom(uint64_t, size_t, std::vector<StoredMessage>&) const { return 0; }
+uint64_t MessageStore::seekTime(int64_t) const { return nextSequence(); }
+
+#endif
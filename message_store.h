@@ -0,0 +1,152 @@
+#ifndef MESSAGE_STORE_H
+#define MESSAGE_STORE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+const size_t DEFAULT_STORE_SEGMENT_BYTES = 64 * 1024 * 1024;
+const int DEFAULT_STORE_SYNC_MS = 20;
+const size_t DEFAULT_STORE_INDEX_BYTES = 4096;
+const size_t DEFAULT_STORE_QUEUE_SIZE = 65536;
+
+struct MessageStoreConfig {
+    bool enabled;
+    std::string directory;       // Holds the segment (.seg) and index (.idx) files
+    size_t segment_bytes;        // Roll to a new segment once the current one reaches this size
+    int sync_interval_ms;        // Group-commit interval: one write and one fdatasync per interval
+    size_t index_interval_bytes; // One sparse index entry per this many segment bytes
+    size_t queue_size;           // Records buffered before new ones are dropped
+
+    MessageStoreConfig() : enabled(false), directory("chatlog"), segment_bytes(DEFAULT_STORE_SEGMENT_BYTES),
+                           sync_interval_ms(DEFAULT_STORE_SYNC_MS), index_interval_bytes(DEFAULT_STORE_INDEX_BYTES),
+                           queue_size(DEFAULT_STORE_QUEUE_SIZE) {}
+};
+
+// CRC-32 (IEEE) guarding on-disk records
+uint32_t crc32(const char* data, size_t length);
+
+struct StoredMessage {
+    uint64_t sequence;
+    int64_t timestamp_ms; // Unix time
+    std::string room;
+    std::string username;
+    std::string text;
+};
+
+// Durable, append-only chat log split into segment files.
+//
+// Segment "<first sequence>.seg" holds records back to back:
+//
+//   uint32 body length, uint32 CRC-32 of the body, then the body:
+//   uint64 sequence, int64 timestamp (ms), uint16 room length,
+//   uint16 username length, room, username, text
+//
+// Integers are little-endian. Beside each segment, "<first sequence>.idx"
+// is a sparse index with one 24-byte entry (sequence, timestamp, offset)
+// per index_interval_bytes of log. Sealed segments' indexes are mmap-ed;
+// seeking by sequence or time is a binary search there plus a short scan.
+//
+// append() only encodes the record and queues it. A writer thread
+// group-commits the queue: one write and one fdatasync per sync interval,
+// however many messages arrived. A full queue drops records and counts
+// them instead of blocking the caller. On start() a torn record at the end
+// of the last segment, left by a crash, is truncated away.
+//
+// The written handler sees each message once it is written, on the writer
+// thread and in sequence order, however many threads call append().
+class MessageStore {
+public:
+    explicit MessageStore(const MessageStoreConfig& config);
+    ~MessageStore();
+
+    // Recovers existing segments and starts the writer; false on I/O errors
+    bool start();
+    // Writes and syncs everything queued, then stops the writer
+    void stop();
+
+    // Set before start(); called with each message's sequence and text
+    void setWrittenHandler(std::function<void(uint64_t, std::string_view)> handler) { written_handler = std::move(handler); }
+
+    // Returns the message's sequence number, or 0 if it was dropped
+    uint64_t append(std::string_view room, std::string_view username, std::string_view text);
+
+    // Appends up to `limit` written messages with sequence >= `from` to out
+    size_t readFrom(uint64_t from, size_t limit, std::vector<StoredMessage>& out) const;
+    // Sequence of the first message stamped at or after timestamp_ms;
+    // nextSequence() if there is none
+    uint64_t seekTime(int64_t timestamp_ms) const;
+
+    uint64_t nextSequence() const;
+    uint64_t durableSequence() const { return durable_sequence.load(std::memory_order_acquire); }
+    uint64_t droppedRecords() const { return dropped.load(std::memory_order_relaxed); }
+    uint64_t syncCount() const { return syncs.load(std::memory_order_relaxed); }
+    // A write failed; later messages are dropped until the next start()
+    bool hasFailed() const { return failed.load(std::memory_order_relaxed); }
+    size_t segmentCount() const;
+    const MessageStoreConfig& getConfig() const { return config; }
+
+private:
+    struct IndexEntry {
+        uint64_t sequence;
+        int64_t timestamp_ms;
+        uint64_t offset;
+    };
+
+    struct Segment {
+        uint64_t base_sequence = 0;
+        int log_fd = -1;
+        int index_fd = -1;
+        std::atomic<uint64_t> written_bytes{0}; // Readable prefix of the log
+        // Sealed segments: the mmap-ed index. Active segment: live_index.
+        const char* index_map = nullptr;
+        size_t index_map_bytes = 0;
+        std::vector<IndexEntry> live_index;     // segments_mutex
+        uint64_t last_indexed_offset = 0;       // Writer thread only
+
+        ~Segment();
+        size_t indexSize() const;
+        IndexEntry indexAt(size_t i) const;
+    };
+
+    static constexpr size_t RECORD_HEADER_SIZE = 8;
+    static constexpr size_t RECORD_FIXED_BODY = 20;
+    static constexpr size_t INDEX_ENTRY_SIZE = 24;
+
+    MessageStoreConfig config;
+
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::vector<std::string> pending; // Encoded records, in sequence order
+    uint64_t next_sequence;           // queue_mutex
+    bool stopping;
+
+    mutable std::mutex segments_mutex;
+    std::vector<std::shared_ptr<Segment>> segments; // By base sequence; the last one is active
+
+    std::thread writer;
+    std::atomic<uint64_t> durable_sequence;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> syncs;
+    std::atomic<bool> failed;
+    std::function<void(uint64_t, std::string_view)> written_handler;
+
+    void writerLoop();
+    bool writeBatch(std::vector<std::string>& batch);
+    bool openSegment(uint64_t base_sequence, bool create);
+    bool recoverActive(Segment& segment, uint64_t& last_sequence);
+    bool sealSegment(Segment& segment);
+    std::string segmentPath(uint64_t base_sequence, const char* extension) const;
+    size_t scanSegment(const std::shared_ptr<Segment>& segment, uint64_t offset, uint64_t from, size_t limit,
+                       std::vector<StoredMessage>& out) const;
+};
+
+#endif // MESSAGE_STORE_H
@@ -0,0 +1,225 @@
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+const char* metricName(Metric metric) {
+    switch (metric) {
+        case Metric::RECV_TO_PARSE: return "recv_parse";
+        case Metric::PARSE_TO_ENQUEUE: return "parse_enqueue";
+        case Metric::ENQUEUE_TO_SEND: return "enqueue_send";
+        case Metric::INTERSERVER_FORWARD: return "interserver_forward";
+        case Metric::QUEUE_DEPTH: return "queue_depth";
+        case Metric::COUNT: break;
+    }
+    return "unknown";
+}
+
+LatencyHistogram::LatencyHistogram() : counts(), total(0), value_sum(0), value_max(0) {}
+
+size_t LatencyHistogram::bucketFor(uint64_t value) {
+    const uint64_t exact = 2u << SUB_BITS;
+    if (value < exact) {
+        return static_cast<size_t>(value);
+    }
+    if (value >> MAX_BITS) {
+        return BUCKETS - 1;
+    }
+    int msb = 63;
+    while (!(value >> msb)) {
+        --msb;
+    }
+    int shift = msb - SUB_BITS;
+    size_t sub = static_cast<size_t>(value >> shift) - (1u << SUB_BITS);
+    return exact + static_cast<size_t>(msb - SUB_BITS - 1) * (1u << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpper(size_t bucket) {
+    const size_t exact = 2u << SUB_BITS;
+    if (bucket < exact) {
+        return bucket;
+    }
+    size_t octave = (bucket - exact) >> SUB_BITS;
+    size_t sub = (bucket - exact) & ((1u << SUB_BITS) - 1);
+    int shift = static_cast<int>(octave) + 1;
+    uint64_t lower = static_cast<uint64_t>((1u << SUB_BITS) + sub) << shift;
+    return lower + (uint64_t(1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    add(bucketFor(value), 1);
+    addSum(value, value);
+}
+
+void LatencyHistogram::addSum(uint64_t sum, uint64_t max) {
+    value_sum += sum;
+    value_max = std::max(value_max, max);
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        counts[bucket] += other.counts[bucket];
+    }
+    total += other.total;
+    addSum(other.value_sum, other.value_max);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(p / 100.0 * static_cast<double>(total)));
+    rank = std::min(std::max<uint64_t>(rank, 1), total);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+        seen += counts[bucket];
+        if (seen >= rank) {
+            return std::min(bucketUpper(bucket), value_max);
+        }
+    }
+    return value_max;
+}
+
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t value) const {
+    if (value >= value_max) {
+        return total;
+    }
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < BUCKETS && bucketUpper(bucket) <= value; ++bucket) {
+        seen += counts[bucket];
+    }
+    return seen;
+}
+
+namespace {
+
+// One thread's histograms. Only the owning thread writes, so a relaxed
+// load and store replace an atomic add.
+struct MetricShard {
+    std::atomic<uint64_t> counts[static_cast<size_t>(Metric::COUNT)][LatencyHistogram::BUCKETS];
+    std::atomic<uint64_t> sums[static_cast<size_t>(Metric::COUNT)];
+    std::atomic<uint64_t> maxes[static_cast<size_t>(Metric::COUNT)];
+};
+
+struct ShardRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<MetricShard>> shards; // Never shrinks; readers sum them all
+    std::vector<MetricShard*> idle;                   // Released by exited threads
+};
+
+// Leaked on purpose: detached threads may still record during shutdown
+ShardRegistry& registry() {
+    static ShardRegistry* instance = new ShardRegistry();
+    return *instance;
+}
+
+struct ShardLease {
+    MetricShard* shard = nullptr;
+
+    ~ShardLease() {
+        if (shard) {
+            ShardRegistry& shards = registry();
+            std::lock_guard<std::mutex> lock(shards.mutex);
+            shards.idle.push_back(shard);
+        }
+    }
+};
+
+thread_local ShardLease lease;
+
+MetricShard& threadShard() {
+    if (!lease.shard) {
+        ShardRegistry& shards = registry();
+        std::lock_guard<std::mutex> lock(shards.mutex);
+        if (!shards.idle.empty()) {
+            lease.shard = shards.idle.back();
+            shards.idle.pop_back();
+        } else {
+            shards.shards.push_back(std::unique_ptr<MetricShard>(new MetricShard()));
+            lease.shard = shards.shards.back().get();
+        }
+    }
+    return *lease.shard;
+}
+
+void bump(std::atomic<uint64_t>& counter, uint64_t by) {
+    counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+}
+
+} // namespace
+
+void recordMetric(Metric metric, uint64_t value) {
+    MetricShard& shard = threadShard();
+    size_t index = static_cast<size_t>(metric);
+    bump(shard.counts[index][LatencyHistogram::bucketFor(value)], 1);
+    bump(shard.sums[index], value);
+    if (value > shard.maxes[index].load(std::memory_order_relaxed)) {
+        shard.maxes[index].store(value, std::memory_order_relaxed);
+    }
+}
+
+LatencyHistogram snapshotMetric(Metric metric) {
+    LatencyHistogram merged;
+    size_t index = static_cast<size_t>(metric);
+    ShardRegistry& shards = registry();
+    std::lock_guard<std::mutex> lock(shards.mutex);
+    for (const auto& shard : shards.shards) {
+        for (size_t bucket = 0; bucket < LatencyHistogram::BUCKETS; ++bucket) {
+            uint64_t count = shard->counts[index][bucket].load(std::memory_order_relaxed);
+            if (count) {
+                merged.add(bucket, count);
+            }
+        }
+        merged.addSum(shard->sums[index].load(std::memory_order_relaxed),
+                      shard->maxes[index].load(std::memory_order_relaxed));
+    }
+    return merged;
+}
+
+static void appendSample(std::string& out, const std::string& name, const std::string& labels,
+                         const char* le, double value) {
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.9g", value);
+    out.append(name);
+    if (!labels.empty() || le) {
+        out.push_back('{');
+        out.append(labels);
+        if (le) {
+            if (!labels.empty()) {
+                out.push_back(',');
+            }
+            out.append("le=\"").append(le).append("\"");
+        }
+        out.push_back('}');
+    }
+    out.push_back(' ');
+    out.append(number);
+    out.push_back('\n');
+}
+
+void appendPrometheusHistogram(std::string& out, const std::string& name, const std::string& labels,
+                               const LatencyHistogram& histogram, uint64_t first_bound, double scale) {
+    static const uint64_t steps[] = {10, 25, 50}; // Tenths of the decade
+    char le[32];
+    uint64_t decade = std::max<uint64_t>(first_bound, 1);
+    bool done = false;
+    while (!done) {
+        for (uint64_t step : steps) {
+            uint64_t bound = decade * step / 10;
+            std::snprintf(le, sizeof(le), "%.9g", static_cast<double>(bound) * scale);
+            appendSample(out, name + "_bucket", labels, le, static_cast<double>(histogram.countAtOrBelow(bound)));
+            if (bound >= histogram.max()) {
+                done = true;
+                break;
+            }
+        }
+        decade *= 10;
+    }
+    appendSample(out, name + "_bucket", labels, "+Inf", static_cast<double>(histogram.count()));
+    appendSample(out, name + "_sum", labels, nullptr, static_cast<double>(histogram.sum()) * scale);
+    appendSample(out, name + "_count", labels, nullptr, static_cast<double>(histogram.count()));
+}
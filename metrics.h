@@ -0,0 +1,80 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// What the server measures. Latencies are in nanoseconds; QUEUE_DEPTH is a
+// client's unsent output in bytes, sampled at every enqueue.
+enum class Metric {
+    RECV_TO_PARSE,       // recv completed -> line or frame decoded
+    PARSE_TO_ENQUEUE,    // decoded -> its first output queued
+    ENQUEUE_TO_SEND,     // queued -> the send that wrote its last byte returned
+    INTERSERVER_FORWARD, // ServerManager::sendMessage to every peer
+    QUEUE_DEPTH,
+    COUNT
+};
+
+const char* metricName(Metric metric); // "recv_parse", ...
+
+// Log-linear (HDR-style) histogram: values below 32 are exact, larger ones
+// fall into 16 buckets per power of two, so any recorded value is known to
+// within 1/16 of itself. Values past 2^40 are clamped. Plain counts: this
+// is the merged, read-side form; recording goes through recordMetric().
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int MAX_BITS = 40;
+    static constexpr size_t BUCKETS = (2u << SUB_BITS) + (MAX_BITS - SUB_BITS - 1) * (1u << SUB_BITS);
+
+    LatencyHistogram();
+
+    void record(uint64_t value);
+    void add(size_t bucket, uint64_t count) { counts[bucket] += count; total += count; }
+    void addSum(uint64_t value_sum, uint64_t value_max);
+    void merge(const LatencyHistogram& other);
+
+    uint64_t count() const { return total; }
+    uint64_t sum() const { return value_sum; }
+    uint64_t max() const { return value_max; }
+    double mean() const { return total ? static_cast<double>(value_sum) / total : 0.0; }
+    // Upper bound of the bucket holding the p-th percentile (0-100)
+    uint64_t percentile(double p) const;
+    // Recorded values known to be <= value; exact at bucket bounds
+    uint64_t countAtOrBelow(uint64_t value) const;
+
+    static size_t bucketFor(uint64_t value);
+    static uint64_t bucketUpper(size_t bucket); // Largest value in the bucket
+
+private:
+    uint64_t counts[BUCKETS];
+    uint64_t total;
+    uint64_t value_sum;
+    uint64_t value_max;
+};
+
+inline uint64_t metricsNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Records into the calling thread's own histograms: no lock and no shared
+// cache line, only relaxed stores that a reader may observe one sample
+// late. A thread's histograms go back to a pool when it exits and keep
+// their counts for the next thread, so short-lived threads cost nothing
+// extra.
+void recordMetric(Metric metric, uint64_t value);
+
+// Sum over every thread, at some point during the call
+LatencyHistogram snapshotMetric(Metric metric);
+
+// Prometheus text exposition of a histogram: cumulative `le` buckets at
+// 1-2.5-5 steps between `first_bound` and the largest value seen, then
+// _sum and _count. `scale` converts values to the exported unit (1e-9 for
+// nanoseconds to seconds). `labels` is empty or like `stage="recv_parse"`.
+void appendPrometheusHistogram(std::string& out, const std::string& name, const std::string& labels,
+                               const LatencyHistogram& histogram, uint64_t first_bound, double scale);
+
+#endif // METRICS_H
@@ -0,0 +1,114 @@
+#include "metrics_endpoint.h"
+#include <cstring>
+
+#ifdef _WIN32
+    #define SHUT_RDWR SD_BOTH
+#else
+    #include <sys/select.h>
+#endif
+
+static const size_t MAX_REQUEST_BYTES = 8192;
+
+MetricsEndpoint::MetricsEndpoint(std::function<std::string()> render)
+    : render(std::move(render)), running(false), listener(INVALID_SOCKET), port(0) {}
+
+MetricsEndpoint::~MetricsEndpoint() {
+    stop();
+}
+
+bool MetricsEndpoint::start(const std::string& address, int listen_port) {
+    SOCKET socket_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (socket_fd == INVALID_SOCKET) {
+        return false;
+    }
+    int on = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&on), sizeof(on));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(listen_port));
+    if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) <= 0 ||
+        bind(socket_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR ||
+        listen(socket_fd, 16) == SOCKET_ERROR) {
+        close(socket_fd);
+        return false;
+    }
+
+    listener = socket_fd;
+    port = listen_port;
+    running = true;
+    thread = std::thread(&MetricsEndpoint::serveLoop, this);
+    return true;
+}
+
+void MetricsEndpoint::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    if (thread.joinable()) {
+        thread.join();
+    }
+    close(listener);
+    listener = INVALID_SOCKET;
+}
+
+void MetricsEndpoint::serveLoop() {
+    SOCKET socket_fd = listener;
+    while (running) {
+        // Wake up now and then to notice stop()
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(socket_fd, &readable);
+        timeval timeout{0, 200 * 1000};
+        if (select(static_cast<int>(socket_fd) + 1, &readable, nullptr, nullptr, &timeout) <= 0) {
+            continue;
+        }
+        SOCKET client = accept(socket_fd, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        serve(client);
+        shutdown(client, SHUT_RDWR);
+        close(client);
+    }
+}
+
+void MetricsEndpoint::serve(SOCKET client) {
+    // A scraper that stalls must not hold the endpoint forever
+    #ifdef _WIN32
+    DWORD receive_timeout = 2000;
+    #else
+    timeval receive_timeout{2, 0};
+    #endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&receive_timeout),
+               sizeof(receive_timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.find("\n\n") == std::string::npos) {
+        int bytes = recv(client, buffer, sizeof(buffer), 0);
+        if (bytes <= 0 || request.size() + static_cast<size_t>(bytes) > MAX_REQUEST_BYTES) {
+            return;
+        }
+        request.append(buffer, static_cast<size_t>(bytes));
+    }
+
+    std::string status = "404 Not Found";
+    std::string body = "Not found. Try /metrics\n";
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 14, "GET /metrics\r\n") == 0) {
+        status = "200 OK";
+        body = render();
+    }
+    std::string response = "HTTP/1.0 " + status + "\r\n"
+                           "Content-Type: text/plain; version=0.0.4\r\n"
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                           "Connection: close\r\n\r\n" + body;
+    size_t offset = 0;
+    while (offset < response.size()) {
+        int sent = send(client, response.data() + offset, static_cast<int>(response.size() - offset), 0);
+        if (sent <= 0) {
+            return;
+        }
+        offset += static_cast<size_t>(sent);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef METRICS_ENDPOINT_H
+#define METRICS_ENDPOINT_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #define close closesocket
+#else
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <unistd.h>
+    typedef int SOCKET;
+    #define INVALID_SOCKET -1
+    #define SOCKET_ERROR -1
+#endif
+
+// Minimal HTTP/1.0 server for metric scrapers. GET /metrics answers with
+// whatever `render` returns (Prometheus text format); anything else gets a
+// 404. One thread serves one request at a time, which is plenty for a
+// scraper polling every few seconds, and it binds to loopback by default so
+// nothing is exposed beyond the host.
+class MetricsEndpoint {
+public:
+    explicit MetricsEndpoint(std::function<std::string()> render);
+    ~MetricsEndpoint();
+
+    // False if the address cannot be bound
+    bool start(const std::string& address, int port);
+    void stop();
+
+    int getPort() const { return port; }
+
+private:
+    std::function<std::string()> render;
+    std::atomic<bool> running;
+    std::thread thread;
+    SOCKET listener;
+    int port;
+
+    void serveLoop();
+    void serve(SOCKET client);
+};
+
+#endif // METRICS_ENDPOINT_H
@@ -0,0 +1,479 @@
+#include "offline_mailbox.h"
+#include "message_store.h"
+#include <algorithm>
+#include <chrono>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <cstdio>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+static const uint8_t RECORD_PUT = 1;
+static const uint8_t RECORD_DRAIN = 2;
+static const uint8_t RECORD_SEEN = 3;
+static const size_t RECORD_HEADER_SIZE = 8;
+static const size_t DRAIN_FIXED_BODY = 19; // type, id, timestamp, recipient length
+static const size_t PUT_FIXED_BODY = 21;   // ... and sender length
+
+static void putUint16(char* out, uint16_t value) {
+    out[0] = static_cast<char>(value);
+    out[1] = static_cast<char>(value >> 8);
+}
+
+static void putUint32(char* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static void putUint64(char* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+static uint16_t getUint16(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t getUint32(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static uint64_t getUint64(const char* in) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(in);
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Fills in the length and CRC of a record whose body follows the header
+static void sealRecord(std::string& record) {
+    size_t body_length = record.size() - RECORD_HEADER_SIZE;
+    putUint32(&record[0], static_cast<uint32_t>(body_length));
+    putUint32(&record[4], crc32(record.data() + RECORD_HEADER_SIZE, body_length));
+}
+
+OfflineMailbox::OfflineMailbox(const MailboxConfig& config)
+    : config(config), ttl_ms(static_cast<int64_t>(std::max(config.ttl_hours, 1)) * 3600 * 1000), total_bytes(0),
+      message_count(0), next_id(1), expired(0), live_bytes(0), logging(false), stopping(false), log_fd(-1),
+      log_bytes(0) {}
+
+OfflineMailbox::~OfflineMailbox() {
+    close();
+}
+
+std::string OfflineMailbox::logPath() const {
+    return config.directory + "/mailbox.log";
+}
+
+uint64_t OfflineMailbox::putRecordBytes(const std::string& recipient, const MailboxMessage& message) {
+    return RECORD_HEADER_SIZE + PUT_FIXED_BODY + recipient.size() + message.sender.size() + message.text.size();
+}
+
+std::string OfflineMailbox::encodePut(const std::string& recipient, const MailboxMessage& message) {
+    std::string record(RECORD_HEADER_SIZE + PUT_FIXED_BODY, '\0');
+    record.reserve(static_cast<size_t>(putRecordBytes(recipient, message)));
+    char* body = &record[RECORD_HEADER_SIZE];
+    body[0] = static_cast<char>(RECORD_PUT);
+    putUint64(body + 1, message.id);
+    putUint64(body + 9, static_cast<uint64_t>(message.timestamp_ms));
+    putUint16(body + 17, static_cast<uint16_t>(recipient.size()));
+    putUint16(body + 19, static_cast<uint16_t>(message.sender.size()));
+    record.append(recipient).append(message.sender).append(message.text);
+    sealRecord(record);
+    return record;
+}
+
+// DRAIN and SEEN records
+std::string OfflineMailbox::encodeNameRecord(uint8_t type, const std::string& name, uint64_t id,
+                                             int64_t timestamp_ms) {
+    std::string record(RECORD_HEADER_SIZE + DRAIN_FIXED_BODY, '\0');
+    char* body = &record[RECORD_HEADER_SIZE];
+    body[0] = static_cast<char>(type);
+    putUint64(body + 1, id);
+    putUint64(body + 9, static_cast<uint64_t>(timestamp_ms));
+    putUint16(body + 17, static_cast<uint16_t>(name.size()));
+    record.append(name);
+    sealRecord(record);
+    return record;
+}
+
+bool OfflineMailbox::open() {
+    if (!config.enabled) {
+        return true;
+    }
+    bool opened = openLog();
+    writer = std::thread(&OfflineMailbox::writerLoop, this);
+    return opened;
+}
+
+void OfflineMailbox::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    writer_cv.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    closeLog();
+}
+
+void OfflineMailbox::queueLocked(const std::string& record) {
+    if (!logging) {
+        return;
+    }
+    bool wake = pending.empty();
+    pending.append(record);
+    if (wake) {
+        writer_cv.notify_one();
+    }
+}
+
+OfflineMailbox::DepositResult OfflineMailbox::deposit(const std::string& recipient, std::string_view sender,
+                                                      std::string_view text) {
+    if (!config.enabled || recipient.empty() || recipient.size() > UINT16_MAX || sender.size() > UINT16_MAX) {
+        return DepositResult::DISABLED;
+    }
+    int64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (known_users.count(recipient) == 0) {
+        return DepositResult::UNKNOWN_RECIPIENT;
+    }
+
+    auto it = mailboxes.find(recipient);
+    if (it != mailboxes.end() &&
+        (it->second.messages.size() >= config.max_messages || it->second.bytes + text.size() > config.max_bytes)) {
+        return DepositResult::MAILBOX_FULL;
+    }
+    if (text.size() > config.max_bytes) {
+        return DepositResult::MAILBOX_FULL;
+    }
+    if (total_bytes + text.size() > config.max_total_bytes) {
+        return DepositResult::STORE_FULL;
+    }
+
+    MailboxMessage message{next_id++, now, std::string(sender), std::string(text)};
+    queueLocked(encodePut(recipient, message));
+    live_bytes += putRecordBytes(recipient, message);
+    Mailbox& mailbox = it != mailboxes.end() ? it->second : mailboxes[recipient];
+    mailbox.bytes += message.text.size();
+    total_bytes += message.text.size();
+    ++message_count;
+    mailbox.messages.push_back(std::move(message));
+    return DepositResult::STORED;
+}
+
+std::vector<MailboxMessage> OfflineMailbox::drain(const std::string& recipient) {
+    std::vector<MailboxMessage> delivered;
+    if (!config.enabled || recipient.empty() || recipient.size() > UINT16_MAX) {
+        return delivered;
+    }
+    int64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(mutex);
+    rememberLocked(recipient);
+    auto it = mailboxes.find(recipient);
+    if (it == mailboxes.end()) {
+        return delivered;
+    }
+    Mailbox& mailbox = it->second;
+    uint64_t last_id = mailbox.messages.back().id;
+    delivered.reserve(mailbox.messages.size());
+    for (MailboxMessage& message : mailbox.messages) {
+        live_bytes -= putRecordBytes(recipient, message);
+        if (message.timestamp_ms + ttl_ms <= now) {
+            ++expired;
+            continue;
+        }
+        delivered.push_back(std::move(message));
+    }
+    total_bytes -= mailbox.bytes;
+    message_count -= mailbox.messages.size();
+    mailboxes.erase(it);
+
+    queueLocked(encodeNameRecord(RECORD_DRAIN, recipient, last_id, now));
+    return delivered;
+}
+
+void OfflineMailbox::rememberLocked(const std::string& username) {
+    if (known_users.insert(username).second) {
+        live_bytes += RECORD_HEADER_SIZE + DRAIN_FIXED_BODY + username.size();
+        queueLocked(encodeNameRecord(RECORD_SEEN, username, 0, nowMs()));
+    }
+}
+
+void OfflineMailbox::removeMessage(const std::string& recipient, Mailbox& mailbox, const MailboxMessage& message) {
+    live_bytes -= putRecordBytes(recipient, message);
+    mailbox.bytes -= message.text.size();
+    total_bytes -= message.text.size();
+    --message_count;
+}
+
+// Mailboxes are in time order, so expiry only ever pops from the front
+void OfflineMailbox::expireLocked(int64_t now_ms) {
+    for (auto it = mailboxes.begin(); it != mailboxes.end();) {
+        Mailbox& mailbox = it->second;
+        while (!mailbox.messages.empty() && mailbox.messages.front().timestamp_ms + ttl_ms <= now_ms) {
+            removeMessage(it->first, mailbox, mailbox.messages.front());
+            mailbox.messages.pop_front();
+            ++expired;
+        }
+        it = mailbox.messages.empty() ? mailboxes.erase(it) : std::next(it);
+    }
+}
+
+// The SEEN records of every known name and the PUT records of every
+// waiting message: a log equivalent to the current one plus everything queued
+std::string OfflineMailbox::snapshotLocked() const {
+    std::string snapshot;
+    snapshot.reserve(static_cast<size_t>(live_bytes));
+    int64_t now = nowMs();
+    for (const std::string& username : known_users) {
+        snapshot.append(encodeNameRecord(RECORD_SEEN, username, 0, now));
+    }
+    for (const auto& entry : mailboxes) {
+        for (const MailboxMessage& message : entry.second.messages) {
+            snapshot.append(encodePut(entry.first, message));
+        }
+    }
+    return snapshot;
+}
+
+// Does all the disk work, so deposit() and drain() never wait on it. The
+// mailbox lock is held only to take the queued records, expire messages
+// and take a compaction snapshot.
+void OfflineMailbox::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    int64_t next_sweep_ms = nowMs() + SWEEP_INTERVAL_MS;
+    int64_t next_compact_ms = 0;
+    while (true) {
+        int64_t now = nowMs();
+        if (now >= next_sweep_ms) {
+            expireLocked(now);
+            next_sweep_ms = now + SWEEP_INTERVAL_MS;
+        }
+
+        std::string records;
+        records.swap(pending);
+        bool compact = log_fd >= 0 && now >= next_compact_ms && log_bytes >= COMPACT_MIN_BYTES &&
+                       live_bytes * 2 < log_bytes;
+        std::string snapshot;
+        if (compact) {
+            // The snapshot already holds whatever the queued records did
+            snapshot = snapshotLocked();
+        }
+        if (compact || !records.empty()) {
+            lock.unlock();
+            bool replaced = compact && replaceLog(snapshot);
+            bool written = replaced || appendLog(records);
+            lock.lock();
+            if (compact && !replaced) {
+                next_compact_ms = now + SWEEP_INTERVAL_MS; // The old log is intact; retry later
+            }
+            if (!written) {
+                // Keep serving from memory rather than failing private messages
+                logging = false;
+                pending.clear();
+            }
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+        writer_cv.wait_for(lock, std::chrono::milliseconds(next_sweep_ms - now),
+                           [this] { return stopping || !pending.empty(); });
+    }
+}
+
+size_t OfflineMailbox::recipientCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return mailboxes.size();
+}
+
+size_t OfflineMailbox::messageCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return message_count;
+}
+
+size_t OfflineMailbox::totalBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_bytes;
+}
+
+uint64_t OfflineMailbox::expiredCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return expired;
+}
+
+#ifndef _WIN32
+
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = ::write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool OfflineMailbox::openLog() {
+    if (mkdir(config.directory.c_str(), 0700) != 0 && errno != EEXIST) {
+        return false;
+    }
+    // Private messages: readable by the server's user only
+    int fd = ::open(logPath().c_str(), O_RDWR | O_APPEND | O_CREAT, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat log_stat;
+    if (fstat(fd, &log_stat) != 0) {
+        ::close(fd);
+        return false;
+    }
+    std::string log(static_cast<size_t>(log_stat.st_size), '\0');
+    size_t got = 0;
+    while (got < log.size()) {
+        ssize_t n = pread(fd, &log[got], log.size() - got, static_cast<off_t>(got));
+        if (n <= 0) {
+            break;
+        }
+        got += static_cast<size_t>(n);
+    }
+    log.resize(got);
+
+    int64_t now = nowMs();
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t offset = 0;
+    while (offset + RECORD_HEADER_SIZE <= log.size()) {
+        uint32_t body_length = getUint32(&log[offset]);
+        if (body_length < DRAIN_FIXED_BODY || offset + RECORD_HEADER_SIZE + body_length > log.size()) {
+            break; // Torn tail
+        }
+        const char* body = &log[offset + RECORD_HEADER_SIZE];
+        if (crc32(body, body_length) != getUint32(&log[offset + 4])) {
+            break;
+        }
+        uint8_t type = static_cast<uint8_t>(body[0]);
+        uint64_t id = getUint64(body + 1);
+        int64_t timestamp_ms = static_cast<int64_t>(getUint64(body + 9));
+        size_t recipient_length = getUint16(body + 17);
+        next_id = std::max(next_id, id + 1);
+        if (type == RECORD_PUT && body_length >= PUT_FIXED_BODY) {
+            size_t sender_length = getUint16(body + 19);
+            if (PUT_FIXED_BODY + recipient_length + sender_length > body_length) {
+                break;
+            }
+            if (timestamp_ms + ttl_ms > now) {
+                const char* strings = body + PUT_FIXED_BODY;
+                std::string recipient(strings, recipient_length);
+                rememberLocked(recipient);
+                MailboxMessage message{id, timestamp_ms, std::string(strings + recipient_length, sender_length),
+                                       std::string(strings + recipient_length + sender_length,
+                                                   body_length - PUT_FIXED_BODY - recipient_length - sender_length)};
+                Mailbox& mailbox = mailboxes[recipient];
+                mailbox.bytes += message.text.size();
+                total_bytes += message.text.size();
+                ++message_count;
+                live_bytes += putRecordBytes(recipient, message);
+                mailbox.messages.push_back(std::move(message));
+            }
+        } else if (type == RECORD_SEEN && DRAIN_FIXED_BODY + recipient_length <= body_length) {
+            rememberLocked(std::string(body + DRAIN_FIXED_BODY, recipient_length));
+        } else if (type == RECORD_DRAIN && DRAIN_FIXED_BODY + recipient_length <= body_length) {
+            auto it = mailboxes.find(std::string(body + DRAIN_FIXED_BODY, recipient_length));
+            if (it != mailboxes.end()) {
+                Mailbox& mailbox = it->second;
+                while (!mailbox.messages.empty() && mailbox.messages.front().id <= id) {
+                    removeMessage(it->first, mailbox, mailbox.messages.front());
+                    mailbox.messages.pop_front();
+                }
+                if (mailbox.messages.empty()) {
+                    mailboxes.erase(it);
+                }
+            }
+        } else {
+            break;
+        }
+        offset += RECORD_HEADER_SIZE + body_length;
+    }
+    if (offset < log.size() && ftruncate(fd, static_cast<off_t>(offset)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    log_fd = fd;
+    log_bytes = offset;
+    logging = true;
+    return true;
+}
+
+void OfflineMailbox::closeLog() {
+    if (log_fd >= 0) {
+        ::close(log_fd);
+        log_fd = -1;
+    }
+}
+
+bool OfflineMailbox::appendLog(const std::string& records) {
+    if (log_fd < 0) {
+        return false;
+    }
+    if (!writeAll(log_fd, records.data(), records.size())) {
+        closeLog();
+        return false;
+    }
+    log_bytes += records.size();
+    return true;
+}
+
+// Writes the snapshot to a new file and swaps it in; false leaves the old
+// log in use
+bool OfflineMailbox::replaceLog(const std::string& snapshot) {
+    std::string temp_path = logPath() + ".tmp";
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    if (!writeAll(fd, snapshot.data(), snapshot.size()) || fsync(fd) != 0 ||
+        std::rename(temp_path.c_str(), logPath().c_str()) != 0) {
+        ::close(fd);
+        unlink(temp_path.c_str());
+        return false;
+    }
+    ::close(log_fd);
+    log_fd = fd;
+    log_bytes = snapshot.size();
+    return true;
+}
+
+#else
+
+// Memory only: mailboxes last until the server stops
+bool OfflineMailbox::openLog() { return true; }
+void OfflineMailbox::closeLog() {}
+bool OfflineMailbox::appendLog(const std::string&) { return true; }
+bool OfflineMailbox::replaceLog(const std::string&) { return true; }
+
+#endif
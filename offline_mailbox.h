@@ -0,0 +1,138 @@
+#ifndef OFFLINE_MAILBOX_H
+#define OFFLINE_MAILBOX_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+const size_t DEFAULT_MAILBOX_MAX_MESSAGES = 100;
+const size_t DEFAULT_MAILBOX_MAX_BYTES = 64 * 1024;
+const size_t DEFAULT_MAILBOX_TOTAL_BYTES = 16 * 1024 * 1024;
+const int DEFAULT_MAILBOX_TTL_HOURS = 7 * 24;
+
+struct MailboxConfig {
+    bool enabled;
+    std::string directory;  // Holds mailbox.log
+    size_t max_messages;    // Per recipient
+    size_t max_bytes;       // Message text per recipient
+    size_t max_total_bytes; // Message text across all mailboxes
+    int ttl_hours;          // Undelivered messages expire after this long
+
+    MailboxConfig() : enabled(false), directory("mailbox"), max_messages(DEFAULT_MAILBOX_MAX_MESSAGES),
+                      max_bytes(DEFAULT_MAILBOX_MAX_BYTES), max_total_bytes(DEFAULT_MAILBOX_TOTAL_BYTES),
+                      ttl_hours(DEFAULT_MAILBOX_TTL_HOURS) {}
+};
+
+struct MailboxMessage {
+    uint64_t id;
+    int64_t timestamp_ms; // Unix time
+    std::string sender;
+    std::string text;
+};
+
+// Private messages for users who are offline, held until they next join.
+//
+// Mailboxes live in memory, indexed by recipient, and are backed by an
+// append-only log, <directory>/mailbox.log, replayed on open(). Records use
+// the message store's framing (uint32 body length, uint32 CRC-32, body):
+//
+//   PUT:   uint8 1, uint64 id, int64 timestamp (ms), uint16 recipient
+//          length, uint16 sender length, recipient, sender, text
+//   DRAIN: uint8 2, uint64 id, int64 timestamp (ms), uint16 recipient
+//          length, recipient; every message to recipient up to id is gone
+//   SEEN:  as DRAIN with type 3 and id 0; recipient has joined before
+//
+// Only names that have joined (or already have mail waiting) can receive
+// messages; others get UNKNOWN_RECIPIENT, so a mistyped name does not
+// collect mail. Usernames are not authenticated, though: whoever next joins
+// under a known name receives its mail.
+//
+// Expired messages need no record: replay skips them by timestamp.
+//
+// deposit() and drain() only change the in-memory mailboxes and queue the
+// record; they never touch the disk, so callers may hold their own locks.
+// A writer thread appends queued records in one write, expires messages
+// once a minute and, once most of the log is delivered or expired,
+// rewrites it with only the live messages. Appends are not synced, so a
+// server crash loses at most what was still queued and a power failure
+// may lose the last few deposits.
+class OfflineMailbox {
+public:
+    enum class DepositResult { STORED, MAILBOX_FULL, STORE_FULL, UNKNOWN_RECIPIENT, DISABLED };
+
+    explicit OfflineMailbox(const MailboxConfig& config);
+    ~OfflineMailbox();
+
+    // Replays the log and starts the writer. False if the log cannot be
+    // opened; mailboxes then stay in memory only (always so on Windows).
+    bool open();
+    // Writes what is queued and stops the writer
+    void close();
+
+    DepositResult deposit(const std::string& recipient, std::string_view sender, std::string_view text);
+    // Removes and returns the recipient's unexpired messages, oldest first.
+    // Call on every join: it also makes the name known, so it can be sent
+    // mail from then on.
+    std::vector<MailboxMessage> drain(const std::string& recipient);
+
+    size_t recipientCount() const;
+    size_t messageCount() const;
+    size_t totalBytes() const;
+    uint64_t expiredCount() const;
+    const MailboxConfig& getConfig() const { return config; }
+
+private:
+    struct Mailbox {
+        std::deque<MailboxMessage> messages; // Oldest first
+        size_t bytes = 0;                    // Text bytes
+    };
+
+    static constexpr int64_t SWEEP_INTERVAL_MS = 60 * 1000;
+    static constexpr size_t COMPACT_MIN_BYTES = 1024 * 1024;
+
+    MailboxConfig config;
+    int64_t ttl_ms;
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Mailbox> mailboxes;
+    std::unordered_set<std::string> known_users; // Names that may be sent mail
+    size_t total_bytes;
+    size_t message_count;
+    uint64_t next_id;
+    uint64_t expired;
+    uint64_t live_bytes;  // Log bytes of the SEEN records and of the PUT records still in mailboxes
+    std::string pending;  // Encoded records waiting for the writer
+    bool logging;         // Records are queued only while the log is open
+    bool stopping;
+    std::condition_variable writer_cv;
+    std::thread writer;
+
+    int log_fd;           // -1 when memory only; writer thread only once started
+    uint64_t log_bytes;   // Current log size; likewise
+
+    void rememberLocked(const std::string& username);
+    void removeMessage(const std::string& recipient, Mailbox& mailbox, const MailboxMessage& message);
+    void expireLocked(int64_t now_ms);
+    void queueLocked(const std::string& record);
+    std::string snapshotLocked() const;
+    void writerLoop();
+    // Platform parts: replay, append, replace the log with a snapshot
+    bool openLog();
+    void closeLog();
+    bool appendLog(const std::string& records);
+    bool replaceLog(const std::string& snapshot);
+    std::string logPath() const;
+    static std::string encodePut(const std::string& recipient, const MailboxMessage& message);
+    static std::string encodeNameRecord(uint8_t type, const std::string& name, uint64_t id, int64_t timestamp_ms);
+    static uint64_t putRecordBytes(const std::string& recipient, const MailboxMessage& message);
+};
+
+#endif // OFFLINE_MAILBOX_H
@@ -0,0 +1,124 @@
+#include "outbound_queue.h"
+#include "metrics.h"
+#include <algorithm>
+
+const char* slowConsumerPolicyName(SlowConsumerPolicy policy) {
+    switch (policy) {
+        case SlowConsumerPolicy::DROP_OLDEST: return "drop_oldest";
+        case SlowConsumerPolicy::DISCONNECT: return "disconnect";
+    }
+    return "unknown";
+}
+
+bool parseSlowConsumerPolicy(const std::string& name, SlowConsumerPolicy& policy) {
+    if (name == "drop_oldest") {
+        policy = SlowConsumerPolicy::DROP_OLDEST;
+    } else if (name == "disconnect") {
+        policy = SlowConsumerPolicy::DISCONNECT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void setSlice(OutboundSlice& slice, const char* data, size_t length) {
+#ifdef _WIN32
+    slice.buf = const_cast<char*>(data);
+    slice.len = static_cast<ULONG>(length);
+#else
+    slice.iov_base = const_cast<char*>(data);
+    slice.iov_len = length;
+#endif
+}
+
+OutboundQueue::OutboundQueue(const OutboundLimits& limits)
+    : sent_offset(0), queued_bytes(0), queued_messages(0), dropped_messages(0), limits(limits) {}
+
+void OutboundQueue::adjust(size_t bytes_added, size_t bytes_removed, size_t messages_added, size_t messages_removed) {
+    queued_bytes.store(queued_bytes.load(std::memory_order_relaxed) + bytes_added - bytes_removed,
+                       std::memory_order_relaxed);
+    queued_messages.store(queued_messages.load(std::memory_order_relaxed) + messages_added - messages_removed,
+                          std::memory_order_relaxed);
+}
+
+bool OutboundQueue::push(const MessageBuffer& message, uint64_t enqueued_ns) {
+    if (!message || message->empty()) {
+        return true;
+    }
+    if (bytes() + message->size() > limits.high_watermark) {
+        if (limits.policy == SlowConsumerPolicy::DISCONNECT) {
+            return false;
+        }
+        // Messages already being written cannot be dropped without
+        // corrupting the stream, so only waiting ones go
+        size_t dropped = 0;
+        size_t dropped_bytes = 0;
+        while (!waiting.empty() && bytes() - dropped_bytes + message->size() > limits.low_watermark) {
+            dropped_bytes += waiting.front().message->size();
+            waiting.pop_front();
+            ++dropped;
+        }
+        adjust(0, dropped_bytes, 0, dropped);
+        dropped_messages.store(droppedMessages() + dropped, std::memory_order_relaxed);
+    }
+
+    waiting.push_back(Pending{message, enqueued_ns});
+    adjust(message->size(), 0, 1, 0);
+    recordMetric(Metric::QUEUE_DEPTH, bytes());
+    return true;
+}
+
+size_t OutboundQueue::prepare(OutboundSlice* slices, size_t max_slices) {
+    // Everything already handed out goes first, then newly waiting messages
+    while (!waiting.empty() && sending.size() < max_slices) {
+        sending.push_back(std::move(waiting.front()));
+        waiting.pop_front();
+    }
+
+    size_t count = 0;
+    for (size_t i = 0; i < sending.size() && count < max_slices; ++i) {
+        size_t offset = (i == 0) ? sent_offset : 0;
+        const std::string& data = *sending[i].message;
+        setSlice(slices[count++], data.data() + offset, data.size() - offset);
+    }
+    return count;
+}
+
+void OutboundQueue::consume(size_t sent) {
+    size_t consumed = std::min(sent, bytes());
+    size_t completed = 0;
+    uint64_t now = 0;
+    while (sent > 0 && !sending.empty()) {
+        size_t remaining = sending.front().message->size() - sent_offset;
+        if (sent < remaining) {
+            sent_offset += sent;
+            break;
+        }
+        sent -= remaining;
+        if (now == 0) {
+            now = metricsNowNs();
+        }
+        recordMetric(Metric::ENQUEUE_TO_SEND, now - std::min(now, sending.front().enqueued_ns));
+        sending.pop_front();
+        sent_offset = 0;
+        ++completed;
+    }
+    adjust(0, consumed, 0, completed);
+}
+
+void OutboundQueue::clearWaiting() {
+    size_t dropped_bytes = 0;
+    for (const auto& pending : waiting) {
+        dropped_bytes += pending.message->size();
+    }
+    adjust(0, dropped_bytes, 0, waiting.size());
+    waiting.clear();
+}
+
+void OutboundQueue::clear() {
+    sending.clear();
+    waiting.clear();
+    sent_offset = 0;
+    queued_bytes.store(0, std::memory_order_relaxed);
+    queued_messages.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include "message_buffer.h"
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    typedef WSABUF OutboundSlice; // For WSASend
+#else
+    #include <sys/uio.h>
+    typedef iovec OutboundSlice;  // For writev/sendmsg
+#endif
+
+// What to do with a client whose unsent output passes the high watermark
+enum class SlowConsumerPolicy {
+    DROP_OLDEST, // Drop the oldest unsent messages down to the low watermark
+    DISCONNECT   // Disconnect the client
+};
+
+const size_t DEFAULT_OUTBOUND_HIGH_WATERMARK = 1024 * 1024;
+const size_t DEFAULT_OUTBOUND_LOW_WATERMARK = 256 * 1024;
+
+struct OutboundLimits {
+    size_t high_watermark;
+    size_t low_watermark;
+    SlowConsumerPolicy policy;
+
+    OutboundLimits() : high_watermark(DEFAULT_OUTBOUND_HIGH_WATERMARK),
+                       low_watermark(DEFAULT_OUTBOUND_LOW_WATERMARK),
+                       policy(SlowConsumerPolicy::DROP_OLDEST) {}
+};
+
+const char* slowConsumerPolicyName(SlowConsumerPolicy policy);
+bool parseSlowConsumerPolicy(const std::string& name, SlowConsumerPolicy& policy);
+
+// Bounded per-client queue of outgoing messages. Entries are shared
+// MessageBuffers, so a broadcast costs one copy of its bytes no matter how
+// many clients queue it. prepare() gathers the
+// unsent bytes of many messages into one slice array so a single
+// writev/sendmsg (or io_uring SENDMSG) drains them; consume() retires what
+// the kernel accepted. Messages handed out by prepare() stay put until they
+// are consumed, so their memory can be referenced by an in-flight send.
+// Each message carries the time it was queued; consume() records the
+// enqueue -> send latency of every message it completes, and push() the
+// queue depth.
+// Not thread-safe; callers serialise access. bytes(), messages() and
+// droppedMessages() may be read from any thread, for stats.
+class OutboundQueue {
+private:
+    struct Pending {
+        MessageBuffer message;
+        uint64_t enqueued_ns; // metricsNowNs()
+    };
+
+    std::deque<Pending> sending; // Handed out by prepare(); never dropped
+    std::deque<Pending> waiting;
+    size_t sent_offset;              // Bytes of sending.front() already written
+    std::atomic<size_t> queued_bytes;    // Unsent bytes in both deques
+    std::atomic<size_t> queued_messages; // Messages in both deques
+    std::atomic<uint64_t> dropped_messages;
+    OutboundLimits limits;
+
+    // Single writer, so plain stores; the atomics only make reads safe
+    void adjust(size_t bytes_added, size_t bytes_removed, size_t messages_added, size_t messages_removed);
+
+public:
+    explicit OutboundQueue(const OutboundLimits& limits = OutboundLimits());
+
+    // Returns false when the client must be disconnected (DISCONNECT policy).
+    // enqueued_ns is when the sender queued it, which may be earlier than
+    // this call if it crossed threads on the way.
+    bool push(const MessageBuffer& message, uint64_t enqueued_ns);
+
+    // Fills up to max_slices slices with unsent data and returns the count
+    size_t prepare(OutboundSlice* slices, size_t max_slices);
+    void consume(size_t bytes);
+
+    // Drops everything not yet handed out by prepare()
+    void clearWaiting();
+    // Drops everything; only once no send references the queue any more
+    void clear();
+
+    bool empty() const { return queued_bytes.load(std::memory_order_relaxed) == 0; }
+    bool inFlight() const { return !sending.empty(); }
+    size_t bytes() const { return queued_bytes.load(std::memory_order_relaxed); }
+    size_t messages() const { return queued_messages.load(std::memory_order_relaxed); }
+    uint64_t droppedMessages() const { return dropped_messages.load(std::memory_order_relaxed); }
+};
+
+#endif // OUTBOUND_QUEUE_H
@@ -0,0 +1,243 @@
+#ifndef ROOM_INDEX_H
+#define ROOM_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "message_history.h"
+
+const uint32_t NO_ROOM = UINT32_MAX; // Room id meaning "none"
+
+// Set of room ids, one bit per id. Room ids are dense and reused, so a
+// client's membership stays a few words even with thousands of rooms.
+class RoomSet {
+private:
+    std::vector<uint64_t> words;
+
+public:
+    bool contains(uint32_t id) const {
+        size_t word = id / 64;
+        return word < words.size() && (words[word] >> (id % 64)) & 1;
+    }
+
+    void insert(uint32_t id) {
+        size_t word = id / 64;
+        if (word >= words.size()) {
+            words.resize(word + 1, 0);
+        }
+        words[word] |= uint64_t(1) << (id % 64);
+    }
+
+    void erase(uint32_t id) {
+        size_t word = id / 64;
+        if (word < words.size()) {
+            words[word] &= ~(uint64_t(1) << (id % 64));
+        }
+    }
+
+    bool empty() const {
+        for (uint64_t word : words) {
+            if (word != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void clear() { words.clear(); }
+
+    // Calls fn(uint32_t id) in ascending order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t i = 0; i < words.size(); ++i) {
+            for (uint64_t bits = words[i]; bits != 0; bits &= bits - 1) {
+                fn(static_cast<uint32_t>(i * 64 + static_cast<size_t>(__builtin_ctzll(bits))));
+            }
+        }
+    }
+};
+
+// Rooms by name and by dense id, each with a copy-on-write member list.
+// Joins and parts publish a new list; fan-out takes the current one and
+// iterates it without holding the owner's lock, touching only that room's
+// members. Each room also keeps its recent chat lines. Empty rooms are
+// dropped, with their history, and their ids reused, except the ones
+// created with persistent set. Not thread-safe; the owner serialises access
+// (the MessageHistory objects are thread-safe on their own).
+template <typename ClientT>
+class RoomIndex {
+public:
+    typedef std::shared_ptr<ClientT> Handle;
+    typedef std::vector<Handle> MemberList;
+
+private:
+    struct Room {
+        std::string name;
+        std::shared_ptr<const MemberList> members;
+        std::shared_ptr<MessageHistory> history;
+        bool in_use = false;
+        bool persistent = false;
+    };
+
+    std::vector<Room> rooms;            // Indexed by room id
+    std::vector<uint32_t> free_ids;     // Ids of dropped rooms, reused first
+    std::map<std::string, uint32_t> by_name; // Ordered for listings
+    size_t max_rooms;
+    HistoryLimits history_limits;
+
+    uint32_t create(const std::string& name, bool persistent) {
+        if (by_name.size() >= max_rooms) {
+            return NO_ROOM;
+        }
+        uint32_t id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            free_ids.pop_back();
+        } else {
+            id = static_cast<uint32_t>(rooms.size());
+            rooms.emplace_back();
+        }
+        Room& room = rooms[id];
+        room.name = name;
+        room.members = std::make_shared<const MemberList>();
+        room.history = std::make_shared<MessageHistory>(history_limits);
+        room.in_use = true;
+        room.persistent = persistent;
+        by_name.emplace(name, id);
+        return id;
+    }
+
+    void drop(uint32_t id) {
+        Room& room = rooms[id];
+        by_name.erase(room.name);
+        room = Room();
+        free_ids.push_back(id);
+    }
+
+public:
+    RoomIndex(size_t max_rooms, const HistoryLimits& history_limits)
+        : max_rooms(max_rooms), history_limits(history_limits) {}
+
+    // Creates a room that stays when its last member parts
+    uint32_t createPersistent(const std::string& name) {
+        uint32_t id = find(name);
+        if (id != NO_ROOM) {
+            rooms[id].persistent = true;
+            return id;
+        }
+        return create(name, true);
+    }
+
+    uint32_t find(const std::string& name) const {
+        auto it = by_name.find(name);
+        return it == by_name.end() ? NO_ROOM : it->second;
+    }
+
+    // Adds the client to the named room, creating it if needed, and records
+    // the id in `membership`. NO_ROOM when the room limit is reached.
+    uint32_t join(const std::string& name, const Handle& client, RoomSet& membership) {
+        uint32_t id = find(name);
+        if (id == NO_ROOM) {
+            id = create(name, false);
+            if (id == NO_ROOM) {
+                return NO_ROOM;
+            }
+        }
+        if (!membership.contains(id)) {
+            Room& room = rooms[id];
+            auto members = std::make_shared<MemberList>();
+            members->reserve(room.members->size() + 1);
+            *members = *room.members;
+            members->push_back(client);
+            room.members = std::move(members);
+            membership.insert(id);
+        }
+        return id;
+    }
+
+    // Returns false if the client was not a member
+    bool part(uint32_t id, const ClientT* client, RoomSet& membership) {
+        if (!membership.contains(id) || id >= rooms.size() || !rooms[id].in_use) {
+            return false;
+        }
+        membership.erase(id);
+        Room& room = rooms[id];
+        if (room.members->size() == 1 && !room.persistent) {
+            drop(id);
+            return true;
+        }
+        auto members = std::make_shared<MemberList>();
+        members->reserve(room.members->size());
+        for (const Handle& member : *room.members) {
+            if (member.get() != client) {
+                members->push_back(member);
+            }
+        }
+        room.members = std::move(members);
+        return true;
+    }
+
+    // Removes the client from every room it is in
+    void partAll(const ClientT* client, RoomSet& membership) {
+        RoomSet joined = membership;
+        joined.forEach([&](uint32_t id) { part(id, client, membership); });
+    }
+
+    // Current members; the list stays valid after later joins and parts
+    std::shared_ptr<const MemberList> members(uint32_t id) const {
+        if (id >= rooms.size() || !rooms[id].in_use) {
+            return std::shared_ptr<const MemberList>();
+        }
+        return rooms[id].members;
+    }
+
+    // Recent chat lines; stays valid after the room is dropped
+    std::shared_ptr<MessageHistory> history(uint32_t id) const {
+        if (id >= rooms.size() || !rooms[id].in_use) {
+            return std::shared_ptr<MessageHistory>();
+        }
+        return rooms[id].history;
+    }
+
+    const std::string& name(uint32_t id) const { return rooms[id].name; }
+    size_t size() const { return by_name.size(); }
+
+    // Calls fn(uint32_t id, const std::string& name, size_t member_count)
+    // for up to `count` rooms starting at index `first`, in name order
+    template <typename Fn>
+    void forEachInRange(size_t first, size_t count, Fn&& fn) const {
+        auto it = by_name.begin();
+        for (size_t i = 0; i < first && it != by_name.end(); ++i) {
+            ++it;
+        }
+        for (; it != by_name.end() && count > 0; ++it, --count) {
+            fn(it->second, it->first, rooms[it->second].members->size());
+        }
+    }
+};
+
+// Canonical "#name" for a /join or /part argument, or "" if the name is not
+// 1-32 letters, digits, '-' or '_' (a leading '#' is optional)
+inline std::string normalizeRoomName(std::string_view name) {
+    if (!name.empty() && name[0] == '#') {
+        name.remove_prefix(1);
+    }
+    if (name.empty() || name.size() > 32) {
+        return std::string();
+    }
+    for (char c : name) {
+        bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+        if (!valid) {
+            return std::string();
+        }
+    }
+    std::string room = "#";
+    room.append(name);
+    return room;
+}
+
+#endif // ROOM_INDEX_H
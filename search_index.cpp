@@ -0,0 +1,547 @@
+#include "search_index.h"
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+static void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Appends the ids of one posting list. Each varint is the distance from the
+// previous id; the first one is the distance from the segment's base id.
+static void decodePostings(std::string_view bytes, uint64_t base, std::vector<uint64_t>& ids) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(bytes.data());
+    const unsigned char* end = p + bytes.size();
+    uint64_t id = base;
+    while (p < end) {
+        uint64_t delta = 0;
+        int shift = 0;
+        while (p < end) {
+            unsigned char byte = *p++;
+            delta |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+            shift += 7;
+        }
+        id += delta;
+        ids.push_back(id);
+    }
+}
+
+static bool isTermByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+void tokenizeForSearch(std::string_view text, std::vector<std::string>& terms) {
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !isTermByte(static_cast<unsigned char>(text[i]))) {
+            ++i;
+        }
+        size_t start = i;
+        while (i < text.size() && isTermByte(static_cast<unsigned char>(text[i]))) {
+            ++i;
+        }
+        if (i > start) {
+            std::string term(text.substr(start, std::min(i - start, MAX_SEARCH_TERM_LENGTH)));
+            for (char& c : term) {
+                if (c >= 'A' && c <= 'Z') {
+                    c = static_cast<char>(c - 'A' + 'a');
+                }
+            }
+            terms.push_back(std::move(term));
+        }
+    }
+}
+
+static bool startsWith(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+struct SearchIndex::Term {
+    std::string text;
+    bool prefix;
+};
+
+// A searchable set of messages with ids in [min_id, max_id]
+class SearchIndex::Source {
+public:
+    uint64_t min_id = 0;
+    uint64_t max_id = 0;
+    size_t messages = 0;
+
+    virtual ~Source() {}
+    // Ascending ids of the messages containing `term` (any term starting
+    // with it when `prefix` is set)
+    virtual void collect(std::string_view term, bool prefix, std::vector<uint64_t>& ids) const = 0;
+    virtual size_t bytes() const = 0;
+};
+
+// Newest messages, appended in place. Hash lookup per term; a prefix query
+// scans the terms, which stays cheap because the table is sealed at
+// seal_messages messages.
+class SearchIndex::MemTable : public SearchIndex::Source {
+public:
+    struct Postings {
+        std::string bytes;
+        uint64_t last_id = 0;
+    };
+    std::unordered_map<std::string, Postings> terms;
+    size_t posting_bytes = 0;
+
+    void add(uint64_t id, const std::vector<std::string>& message_terms) {
+        if (messages == 0) {
+            min_id = id;
+        }
+        max_id = id;
+        ++messages;
+        for (const std::string& term : message_terms) {
+            auto inserted = terms.try_emplace(term);
+            Postings& postings = inserted.first->second;
+            if (!inserted.second && postings.last_id == id) {
+                continue; // Repeated within this message
+            }
+            size_t before = postings.bytes.size();
+            putVarint(postings.bytes, id - (inserted.second ? min_id : postings.last_id));
+            posting_bytes += postings.bytes.size() - before;
+            postings.last_id = id;
+        }
+    }
+
+    void collect(std::string_view term, bool prefix, std::vector<uint64_t>& ids) const override {
+        if (!prefix) {
+            auto it = terms.find(std::string(term));
+            if (it != terms.end()) {
+                decodePostings(it->second.bytes, min_id, ids);
+            }
+            return;
+        }
+        size_t lists = 0;
+        for (const auto& entry : terms) {
+            if (startsWith(entry.first, term)) {
+                decodePostings(entry.second.bytes, min_id, ids);
+                ++lists;
+            }
+        }
+        if (lists > 1) {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+    }
+
+    size_t bytes() const override { return posting_bytes; }
+};
+
+// Immutable segment: sorted terms and their posting lists, each packed
+// into one contiguous buffer. Exact terms are a binary search; a prefix is
+// the contiguous range of terms starting with it.
+class SearchIndex::Segment : public SearchIndex::Source {
+public:
+    std::string term_bytes;
+    std::vector<size_t> term_offsets{0};    // termCount() + 1 entries
+    std::string postings;
+    std::vector<size_t> posting_offsets{0}; // termCount() + 1 entries
+
+    Segment() {}
+
+    // Rewrites a frozen MemTable; its posting bytes are reused unchanged
+    explicit Segment(const MemTable& table) {
+        min_id = table.min_id;
+        max_id = table.max_id;
+        messages = table.messages;
+        std::vector<const std::pair<const std::string, MemTable::Postings>*> sorted;
+        sorted.reserve(table.terms.size());
+        size_t term_total = 0;
+        for (const auto& entry : table.terms) {
+            sorted.push_back(&entry);
+            term_total += entry.first.size();
+        }
+        std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+        term_bytes.reserve(term_total);
+        postings.reserve(table.posting_bytes);
+        term_offsets.reserve(sorted.size() + 1);
+        posting_offsets.reserve(sorted.size() + 1);
+        for (const auto* entry : sorted) {
+            appendTerm(entry->first, entry->second.bytes);
+        }
+    }
+
+    size_t termCount() const { return term_offsets.size() - 1; }
+
+    std::string_view term(size_t i) const {
+        return std::string_view(term_bytes).substr(term_offsets[i], term_offsets[i + 1] - term_offsets[i]);
+    }
+
+    std::string_view postingsOf(size_t i) const {
+        return std::string_view(postings).substr(posting_offsets[i], posting_offsets[i + 1] - posting_offsets[i]);
+    }
+
+    void appendTerm(std::string_view term, std::string_view term_postings) {
+        term_bytes.append(term);
+        term_offsets.push_back(term_bytes.size());
+        postings.append(term_postings);
+        posting_offsets.push_back(postings.size());
+    }
+
+    size_t lowerBound(std::string_view key) const {
+        size_t low = 0, high = termCount();
+        while (low < high) {
+            size_t mid = (low + high) / 2;
+            if (term(mid) < key) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    void collect(std::string_view key, bool prefix, std::vector<uint64_t>& ids) const override {
+        size_t i = lowerBound(key);
+        if (!prefix) {
+            if (i < termCount() && term(i) == key) {
+                decodePostings(postingsOf(i), min_id, ids);
+            }
+            return;
+        }
+        size_t lists = 0;
+        for (; i < termCount() && startsWith(term(i), key); ++i, ++lists) {
+            decodePostings(postingsOf(i), min_id, ids);
+        }
+        if (lists > 1) {
+            std::sort(ids.begin(), ids.end());
+            ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+        }
+    }
+
+    size_t bytes() const override { return postings.size() + term_bytes.size(); }
+};
+
+SearchIndex::SearchIndex(size_t seal_messages)
+    : seal_messages(std::max<size_t>(seal_messages, 1)), memtable(new MemTable), older(new MemTable),
+      sources(std::make_shared<const SourceList>()), stopping(false) {}
+
+SearchIndex::~SearchIndex() {
+    stop();
+}
+
+void SearchIndex::start() {
+    std::lock_guard<std::mutex> lock(jobs_mutex);
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = std::thread(&SearchIndex::workerLoop, this);
+    }
+}
+
+void SearchIndex::stop() {
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        if (!worker.joinable()) {
+            return;
+        }
+        stopping = true;
+    }
+    jobs_cv.notify_one();
+    worker.join();
+}
+
+void SearchIndex::add(uint64_t id, std::string_view text) {
+    std::vector<std::string> terms;
+    tokenizeForSearch(text, terms); // Outside the lock
+    std::lock_guard<std::mutex> lock(memtable_mutex);
+    memtable->add(id, terms);
+    if (memtable->messages >= seal_messages) {
+        freeze(memtable);
+    }
+}
+
+void SearchIndex::addOlder(uint64_t id, std::string_view text) {
+    std::vector<std::string> terms;
+    tokenizeForSearch(text, terms);
+    std::lock_guard<std::mutex> lock(memtable_mutex);
+    older->add(id, terms);
+    if (older->messages >= seal_messages) {
+        freeze(older);
+    }
+}
+
+void SearchIndex::finishOlder() {
+    std::lock_guard<std::mutex> lock(memtable_mutex);
+    if (older->messages > 0) {
+        freeze(older);
+    }
+}
+
+// Caller holds memtable_mutex. The frozen table stays searchable while the
+// worker turns it into a Segment.
+void SearchIndex::freeze(std::unique_ptr<MemTable>& table) {
+    std::shared_ptr<const MemTable> frozen(table.release());
+    table.reset(new MemTable);
+    publish(frozen);
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        to_seal.push_back(frozen);
+    }
+    jobs_cv.notify_one();
+}
+
+void SearchIndex::publish(const std::shared_ptr<const Source>& source) {
+    std::lock_guard<std::mutex> lock(sources_mutex);
+    auto list = std::make_shared<SourceList>(*sources);
+    auto position = std::upper_bound(list->begin(), list->end(), source->min_id,
+                                     [](uint64_t id, const std::shared_ptr<const Source>& s) { return id < s->min_id; });
+    list->insert(position, source);
+    std::atomic_store(&sources, std::shared_ptr<const SourceList>(std::move(list)));
+}
+
+// Swaps a run of adjacent sources for the one that replaces them
+void SearchIndex::replace(const std::vector<const Source*>& old_sources, const std::shared_ptr<const Source>& merged) {
+    std::lock_guard<std::mutex> lock(sources_mutex);
+    auto list = std::make_shared<SourceList>(*sources);
+    auto first = std::find_if(list->begin(), list->end(),
+                              [&](const std::shared_ptr<const Source>& s) { return s.get() == old_sources.front(); });
+    if (first == list->end() || static_cast<size_t>(list->end() - first) < old_sources.size()) {
+        return;
+    }
+    for (size_t i = 0; i < old_sources.size(); ++i) {
+        if (first[static_cast<std::ptrdiff_t>(i)].get() != old_sources[i]) {
+            return;
+        }
+    }
+    *first = merged;
+    list->erase(first + 1, first + static_cast<std::ptrdiff_t>(old_sources.size()));
+    std::atomic_store(&sources, std::shared_ptr<const SourceList>(std::move(list)));
+}
+
+void SearchIndex::workerLoop() {
+    while (true) {
+        std::shared_ptr<const MemTable> job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            jobs_cv.wait(lock, [this]() { return stopping || !to_seal.empty(); });
+            if (to_seal.empty()) {
+                return; // Stopping, and everything frozen is sealed
+            }
+            job = to_seal.front();
+            to_seal.pop_front();
+        }
+        replace({job.get()}, std::make_shared<const Segment>(*job));
+        while (mergeOnce()) {
+        }
+    }
+}
+
+// Merges the first run of MERGE_FACTOR adjacent sealed segments in the same
+// size tier (seal_messages x 4^tier). Returns false if there was none.
+bool SearchIndex::mergeOnce() {
+    std::shared_ptr<const SourceList> snapshot = std::atomic_load(&sources);
+    auto tier = [this](const Source& source) {
+        int level = 0;
+        for (size_t size = seal_messages * MERGE_FACTOR; source.messages >= size; size *= MERGE_FACTOR) {
+            ++level;
+        }
+        return level;
+    };
+
+    std::vector<const Segment*> run;
+    for (const auto& source : *snapshot) {
+        const Segment* segment = dynamic_cast<const Segment*>(source.get());
+        if (segment == nullptr || (!run.empty() && tier(*segment) != tier(*run.front()))) {
+            run.clear();
+        }
+        if (segment != nullptr) {
+            run.push_back(segment);
+            if (run.size() == MERGE_FACTOR) {
+                break;
+            }
+        }
+    }
+    if (run.size() < MERGE_FACTOR) {
+        return false;
+    }
+
+    // K-way merge of the sorted term lists. Id ranges are disjoint and
+    // increasing, so each merged posting list is the inputs' lists in order.
+    auto merged = std::make_shared<Segment>();
+    merged->min_id = run.front()->min_id;
+    merged->max_id = run.back()->max_id;
+    for (const Segment* segment : run) {
+        merged->messages += segment->messages;
+    }
+    std::vector<size_t> positions(run.size(), 0);
+    std::vector<uint64_t> ids;
+    std::string encoded;
+    while (true) {
+        std::string_view smallest;
+        bool found = false;
+        for (size_t j = 0; j < run.size(); ++j) {
+            if (positions[j] < run[j]->termCount() && (!found || run[j]->term(positions[j]) < smallest)) {
+                smallest = run[j]->term(positions[j]);
+                found = true;
+            }
+        }
+        if (!found) {
+            break;
+        }
+        std::string term(smallest);
+        ids.clear();
+        for (size_t j = 0; j < run.size(); ++j) {
+            if (positions[j] < run[j]->termCount() && run[j]->term(positions[j]) == term) {
+                decodePostings(run[j]->postingsOf(positions[j]), run[j]->min_id, ids);
+                ++positions[j];
+            }
+        }
+        encoded.clear();
+        uint64_t previous = merged->min_id;
+        for (uint64_t id : ids) {
+            putVarint(encoded, id - previous);
+            previous = id;
+        }
+        merged->appendTerm(term, encoded);
+    }
+
+    std::vector<const Source*> old_sources(run.begin(), run.end());
+    replace(old_sources, merged);
+    return true;
+}
+
+// Each term's posting list within one source, one list per term. Stops
+// early once a term has no postings, since nothing can match then.
+void SearchIndex::collectTerms(const Source& source, const std::vector<Term>& terms, TermIds& lists) {
+    lists.assign(terms.size(), std::vector<uint64_t>());
+    for (size_t i = 0; i < terms.size(); ++i) {
+        source.collect(terms[i].text, terms[i].prefix, lists[i]);
+        if (lists[i].empty()) {
+            return;
+        }
+    }
+}
+
+// Intersects the posting lists and appends the matches, newest first,
+// until `limit` results are collected
+void SearchIndex::intersect(TermIds& lists, size_t limit, std::vector<uint64_t>& results) {
+    if (lists.empty()) {
+        return;
+    }
+    std::vector<uint64_t> matches;
+    std::vector<uint64_t> both;
+    matches.swap(lists[0]);
+    for (size_t i = 1; i < lists.size() && !matches.empty(); ++i) {
+        both.clear();
+        std::set_intersection(matches.begin(), matches.end(), lists[i].begin(), lists[i].end(),
+                              std::back_inserter(both));
+        matches.swap(both);
+    }
+    for (auto it = matches.rbegin(); it != matches.rend() && results.size() < limit; ++it) {
+        results.push_back(*it);
+    }
+}
+
+void SearchIndex::evaluate(const Source& source, const std::vector<Term>& terms, size_t limit,
+                           std::vector<uint64_t>& results) {
+    TermIds lists;
+    collectTerms(source, terms, lists);
+    intersect(lists, limit, results);
+}
+
+std::vector<uint64_t> SearchIndex::search(std::string_view query, size_t limit) const {
+    // Whitespace-separated words; a trailing '*' makes the word's last term a prefix
+    std::vector<Term> terms;
+    std::vector<std::string> words;
+    size_t i = 0;
+    while (i < query.size()) {
+        while (i < query.size() && (query[i] == ' ' || query[i] == '\t')) {
+            ++i;
+        }
+        size_t start = i;
+        while (i < query.size() && query[i] != ' ' && query[i] != '\t') {
+            ++i;
+        }
+        std::string_view word = query.substr(start, i - start);
+        bool prefix = !word.empty() && word.back() == '*';
+        words.clear();
+        tokenizeForSearch(word, words);
+        for (size_t w = 0; w < words.size(); ++w) {
+            Term term{words[w], prefix && w + 1 == words.size()};
+            bool duplicate = std::any_of(terms.begin(), terms.end(), [&](const Term& t) {
+                return t.text == term.text && t.prefix == term.prefix;
+            });
+            if (!duplicate) {
+                terms.push_back(std::move(term));
+            }
+        }
+    }
+
+    std::vector<uint64_t> results;
+    if (terms.empty() || limit == 0) {
+        return results;
+    }
+    std::shared_ptr<const SourceList> snapshot;
+    TermIds newest;
+    TermIds backfill;
+    uint64_t backfill_min = 0;
+    {
+        // Taken together so a concurrent freeze cannot hide messages. The
+        // memtables' postings are only copied here and intersected after
+        // the lock is released, so add() waits for no more than the copy.
+        std::lock_guard<std::mutex> lock(memtable_mutex);
+        snapshot = std::atomic_load(&sources);
+        collectTerms(*memtable, terms, newest);
+        if (older->messages > 0) {
+            collectTerms(*older, terms, backfill);
+            backfill_min = older->min_id;
+        }
+    }
+    intersect(newest, limit, results);
+    // The backfill memtable sits below the newest sources and above the
+    // backfill batches already frozen
+    bool backfill_done = backfill.empty();
+    for (auto it = snapshot->rbegin(); it != snapshot->rend() && results.size() < limit; ++it) {
+        if (!backfill_done && (*it)->max_id < backfill_min) {
+            intersect(backfill, limit, results);
+            backfill_done = true;
+        }
+        evaluate(**it, terms, limit, results);
+    }
+    if (!backfill_done) {
+        intersect(backfill, limit, results);
+    }
+    return results;
+}
+
+size_t SearchIndex::messageCount() const {
+    std::shared_ptr<const SourceList> snapshot;
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(memtable_mutex);
+        snapshot = std::atomic_load(&sources);
+        count = memtable->messages + older->messages;
+    }
+    for (const auto& source : *snapshot) {
+        count += source->messages;
+    }
+    return count;
+}
+
+size_t SearchIndex::segmentCount() const {
+    return std::atomic_load(&sources)->size();
+}
+
+size_t SearchIndex::postingBytes() const {
+    std::shared_ptr<const SourceList> snapshot;
+    size_t bytes;
+    {
+        std::lock_guard<std::mutex> lock(memtable_mutex);
+        snapshot = std::atomic_load(&sources);
+        bytes = memtable->bytes() + older->bytes();
+    }
+    for (const auto& source : *snapshot) {
+        bytes += source->bytes();
+    }
+    return bytes;
+}
@@ -0,0 +1,98 @@
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+const size_t DEFAULT_SEARCH_SEAL_MESSAGES = 65536; // Messages per in-memory segment before it is sealed
+const size_t MAX_SEARCH_TERM_LENGTH = 32;         // Longer words are indexed by their first 32 bytes
+
+// Appends the search terms of `text`: lowercased runs of ASCII letters and
+// digits, and of non-ASCII bytes (so UTF-8 words stay whole)
+void tokenizeForSearch(std::string_view text, std::vector<std::string>& terms);
+
+// Incremental inverted index over message ids (the message store's
+// sequence numbers). Each term maps to a posting list of the ids whose text
+// contains it, stored as varint deltas.
+//
+// New messages go into an in-memory segment. Once it holds seal_messages
+// messages it is frozen and a background thread rewrites it as a sealed
+// segment: sorted terms (so a prefix is a contiguous range) over one
+// posting blob. The same thread merges runs of four similar-sized sealed
+// segments, so a long history ends up in O(log n) segments. Segments cover
+// disjoint, increasing id ranges, and readers take a copy-on-write snapshot
+// of the segment list, so a query never waits for a merge.
+//
+// A query is a list of terms that must all match (AND). A term ending in
+// '*' matches every term with that prefix. Segments are evaluated newest
+// first and the search stops once `limit` results are found.
+class SearchIndex {
+public:
+    explicit SearchIndex(size_t seal_messages = DEFAULT_SEARCH_SEAL_MESSAGES);
+    ~SearchIndex();
+
+    // Starts and stops the background sealing and merging thread
+    void start();
+    void stop();
+
+    // Indexes a new message; ids must increase from call to call
+    void add(uint64_t id, std::string_view text);
+    // Indexes messages older than everything passed to add(), such as a
+    // backfill from disk; ids must increase from call to call. They are
+    // searchable at once; finishOlder() seals the last partial batch.
+    void addOlder(uint64_t id, std::string_view text);
+    void finishOlder();
+
+    // Ids of the newest `limit` messages matching `query`, newest first
+    std::vector<uint64_t> search(std::string_view query, size_t limit) const;
+
+    size_t messageCount() const;
+    size_t segmentCount() const;
+    size_t postingBytes() const;
+
+private:
+    class Source;
+    class MemTable;
+    class Segment;
+    struct Term;
+
+    typedef std::vector<std::shared_ptr<const Source>> SourceList;
+    typedef std::vector<std::vector<uint64_t>> TermIds;
+
+    static constexpr size_t MERGE_FACTOR = 4;
+
+    size_t seal_messages;
+
+    mutable std::mutex memtable_mutex;
+    std::unique_ptr<MemTable> memtable; // Newest messages; ids above every source's
+    std::unique_ptr<MemTable> older;    // addOlder() batch; ids below every source's
+
+    std::mutex sources_mutex; // Serialises writers of `sources`
+    std::shared_ptr<const SourceList> sources; // Ordered by id; use std::atomic_load/store
+
+    std::thread worker;
+    std::mutex jobs_mutex;
+    std::condition_variable jobs_cv;
+    std::deque<std::shared_ptr<const MemTable>> to_seal;
+    bool stopping;
+
+    void freeze(std::unique_ptr<MemTable>& table);
+    void publish(const std::shared_ptr<const Source>& source);
+    void replace(const std::vector<const Source*>& old_sources, const std::shared_ptr<const Source>& merged);
+    void workerLoop();
+    bool mergeOnce();
+    static void collectTerms(const Source& source, const std::vector<Term>& terms, TermIds& lists);
+    static void intersect(TermIds& lists, size_t limit, std::vector<uint64_t>& results);
+    static void evaluate(const Source& source, const std::vector<Term>& terms, size_t limit,
+                         std::vector<uint64_t>& results);
+};
+
+#endif // SEARCH_INDEX_H
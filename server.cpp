@@ -2,15 +2,39 @@
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <string>
 #include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
 #include <map>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <unordered_map>
+#include <deque>
+#include <cstring>
 #include "interserver_protocol.h"
 #include "server_config.h"
 #include "server_manager.h"
+#include "io_uring_ring.h"
+#include "line_decoder.h"
+#include "outbound_queue.h"
+#include "message_buffer.h"
+#include "client_registry.h"
+#include "user_directory.h"
+#include "async_logger.h"
+#include "timestamp_cache.h"
+#include "command_parser.h"
+#include "binary_frame.h"
+#include "room_index.h"
+#include "message_store.h"
+#include "search_index.h"
+#include "offline_mailbox.h"
+#include "timing_wheel.h"
+#include "metrics.h"
+#include "metrics_endpoint.h"
 
 #ifdef _WIN32
 #include <winsock2.h>
@@ -18,55 +42,318 @@
 // #pragma comment(lib, "ws2_32.lib") // Not needed for g++, use -lws2_32 in linker
 typedef int socklen_t;
 #define close closesocket
+#define SHUT_RDWR SD_BOTH
 #else
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
     #include <unistd.h>
     #include <netdb.h>
+    #include <csignal>
     typedef int SOCKET;
     #define INVALID_SOCKET -1
     #define SOCKET_ERROR -1
 #endif
 
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <fcntl.h>
+    #include <cerrno>
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+// Client I/O model used by ChatServer
+enum class IoBackend {
+    BLOCKING,   // One blocking thread per client
+    EPOLL,      // Non-blocking sockets on per-core epoll shards (Linux only)
+    IO_URING    // Completion-based io_uring ring; falls back to EPOLL if unsupported
+};
+
+const char* ioBackendName(IoBackend backend) {
+    switch (backend) {
+        case IoBackend::BLOCKING: return "blocking";
+        case IoBackend::EPOLL: return "epoll";
+        case IoBackend::IO_URING: return "io_uring";
+    }
+    return "unknown";
+}
+
+// Counters behind the --bench report
+struct IoStats {
+    std::atomic<uint64_t> syscalls{0};           // I/O syscalls issued on the client path
+    std::atomic<uint64_t> messages_delivered{0}; // Payloads handed to a client's send path
+};
+
+// How long a mutex is held, for the --bench report
+struct LockHoldStats {
+    std::atomic<uint64_t> holds{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+
+    void record(uint64_t ns) {
+        holds.fetch_add(1, std::memory_order_relaxed);
+        total_ns.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = max_ns.load(std::memory_order_relaxed);
+        while (ns > seen && !max_ns.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// lock_guard that records its hold time
+class TimedLockGuard {
+private:
+    std::mutex& mutex;
+    LockHoldStats& stats;
+    std::chrono::steady_clock::time_point acquired;
+
+public:
+    TimedLockGuard(std::mutex& m, LockHoldStats& s) : mutex(m), stats(s) {
+        mutex.lock();
+        acquired = std::chrono::steady_clock::now();
+    }
+    ~TimedLockGuard() {
+        auto held = std::chrono::steady_clock::now() - acquired;
+        mutex.unlock();
+        stats.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(held).count()));
+    }
+    TimedLockGuard(const TimedLockGuard&) = delete;
+    TimedLockGuard& operator=(const TimedLockGuard&) = delete;
+};
+
 class ChatServer {
 private:
-    struct Client {
+    // Connection state machine
+    enum class ClientState {
+        AWAITING_USERNAME,
+        JOINED,
+        CLOSING
+    };
+
+    struct Client : std::enable_shared_from_this<Client> {
         SOCKET socket;
         std::string username;
         std::string ip_address;
         std::chrono::system_clock::time_point join_time;
-        bool active;
+        std::atomic<bool> active;
+        ClientState state;
+        LineDecoder input; // Only touched by the thread reading this socket
+        std::unique_ptr<FrameDecoder> frames; // Replaces `input` once the client negotiates binary framing
+        std::atomic<bool> binary;             // Output is framed; set after `frames`
+
+        // Output not yet accepted by the kernel. Guarded by send_mutex, except
+        // on the io_uring backend where only the ring thread touches it.
+        OutboundQueue outbound;
+        std::mutex send_mutex;
+        std::atomic<bool> slow_consumer; // Passed the high watermark under DISCONNECT
+
+        // Blocking backend only
+        std::condition_variable send_cv; // Wakes the client's writer thread
+
+        // Reactor backend only
+        size_t reactor_index;
+        bool flush_pending;     // A flush is scheduled on the reactor (send_mutex)
+        bool watching_writable; // EPOLLOUT registered (reactor thread)
+        uint64_t connection_id; // Unique per connection; the registry key
+
+        // Chat rooms (rooms_mutex)
+        RoomSet rooms;          // Ids of the rooms this client is in
+        uint32_t current_room;  // Where public messages go; NO_ROOM if none
+
+        // Deadlines, kept in the timing wheel of the thread that owns the
+        // connection (timers_mutex on the blocking backend)
+        TimingWheel::TimerId timer;
+        int64_t connected_ms;               // Steady clock
+        std::atomic<int64_t> last_input_ms; // Steady clock; any input counts
+        int64_t ping_sent_ms;               // Last keepalive PING; answered once input is newer
+
+        Client(SOCKET s, const std::string& ip, size_t max_line_length, const OutboundLimits& limits)
+            : socket(s), ip_address(ip), join_time(std::chrono::system_clock::now()), active(true),
+              state(ClientState::AWAITING_USERNAME), input(max_line_length), binary(false), outbound(limits),
+              slow_consumer(false), reactor_index(0), flush_pending(false), watching_writable(false),
+              connection_id(0), current_room(NO_ROOM), timer(TimingWheel::NO_TIMER), connected_ms(steadyMs()),
+              last_input_ms(connected_ms), ping_sent_ms(0) {}
+
+        // Receive buffer of whichever framing the client speaks
+        char* recvPtr() { return frames ? frames->writePtr() : input.writePtr(); }
+        size_t recvSpace() const { return frames ? frames->writableBytes() : input.writableBytes(); }
+        void commitRecv(size_t bytes) {
+            if (frames) {
+                frames->commit(bytes);
+            } else {
+                input.commit(bytes);
+            }
+        }
+        size_t appendRecv(const char* data, size_t length) {
+            return frames ? frames->append(data, length) : input.append(data, length);
+        }
+    };
+
+#ifdef __linux__
+    // One shard: an SO_REUSEPORT listener, the epoll instance and pinned
+    // thread that drive it, and the connections it accepted
+    struct Reactor {
+        int epoll_fd = -1;
+        int wake_fd = -1;
+        SOCKET listen_fd = INVALID_SOCKET;
+        int cpu = -1;
+        std::thread thread;
+        std::unordered_map<SOCKET, std::shared_ptr<Client>> connections; // Owned by the reactor thread
+        std::mutex tasks_mutex;
+        std::vector<std::function<void()>> tasks; // Inbox for work posted from other shards
+        std::vector<std::shared_ptr<Client>> dirty; // Output to flush before the next epoll_wait
+        TimingWheel timers{std::chrono::milliseconds(TIMER_TICK_MS)}; // This shard's client deadlines
+    };
+#endif
+
+#ifdef CHAT_HAVE_IO_URING
+    // Per-connection bookkeeping owned by the io_uring thread
+    struct UringConnection {
+        std::shared_ptr<Client> client;
+        std::vector<OutboundSlice> slices; // Referenced by the in-flight SENDMSG
+        msghdr msg{};
+        size_t in_flight_bytes = 0;
+        bool closing = false;
+        bool dirty = false;                // Listed in uring_dirty
+    };
 
-        Client(SOCKET s, const std::string& ip)
-            : socket(s), ip_address(ip), join_time(std::chrono::system_clock::now()), active(true) {}
+    // Operation encoded in the top byte of an SQE's user_data
+    enum UringOp : uint64_t {
+        URING_OP_ACCEPT = 1,
+        URING_OP_RECV = 2,
+        URING_OP_SEND = 3,
+        URING_OP_WAKE = 4,
+        URING_OP_TICK = 5
     };
+#endif
 
     // Server components
     SOCKET server_socket;
-    std::vector<std::unique_ptr<Client>> clients;
+    ClientRegistry<Client> clients; // Joined clients by username and connection id
     std::mutex clients_mutex;
+
+    // Copy-on-write view of `clients` for readers. Joins and leaves publish a
+    // new version under clients_mutex; fan-out and listings load the current
+    // one without the mutex and keep it alive for as long as they iterate.
+    typedef std::vector<std::shared_ptr<Client>> ClientList;
+    std::shared_ptr<const ClientList> client_snapshot; // Use std::atomic_load/store
+    UserDirectory user_directory; // Rendered /list; updated under clients_mutex, read without it
+    std::atomic<uint64_t> next_connection_id;
     std::mutex cout_mutex;
     int port;
     int max_clients;
-    bool running;
+    size_t max_line_length;
+    OutboundLimits outbound_limits;
+    ClientTimeouts timeouts;
+    std::atomic<bool> running;
+
+    // I/O backend
+    IoBackend io_backend;
+#ifdef __linux__
+    std::vector<std::unique_ptr<Reactor>> reactors;
+    int shard_count; // 0: pick from ServerConfig, then from the core count
+    static inline thread_local int current_reactor = -1;
+#endif
+#ifdef CHAT_HAVE_IO_URING
+    IoUringRing uring;
+    std::thread uring_thread;
+    int uring_wake_fd;
+    uint64_t uring_wake_value;
+    std::unordered_map<uint64_t, UringConnection> uring_connections;
+    std::vector<uint64_t> uring_dirty;
+    std::deque<io_uring_cqe> uring_recv_backlog; // Input not handled yet; holds its provided buffer
+    std::mutex uring_tasks_mutex;
+    std::vector<std::function<void()>> uring_tasks;
+    static inline thread_local bool on_uring_thread = false;
+    TimingWheel uring_timers{std::chrono::milliseconds(TIMER_TICK_MS)};
+    __kernel_timespec uring_tick{};
+    bool uring_tick_armed = false;
+#endif
+    // Blocking backend: every client's deadlines, run by timer_thread
+    std::mutex timers_mutex;
+    std::condition_variable timers_cv;
+    TimingWheel blocking_timers{std::chrono::milliseconds(TIMER_TICK_MS)};
+    std::thread timer_thread;
+    IoStats io_stats;
+    LockHoldStats clients_lock_stats;
+    int bench_interval;
+    std::thread bench_thread;
 
     // Server-to-server communication
     ConfigManager config_manager;
     std::unique_ptr<ServerManager> server_manager;
-    
-    // Message types for protocol
-    enum MessageType {
-        MSG_JOIN = 1,
-        MSG_LEAVE = 2,
-        MSG_CHAT = 3,
-        MSG_LIST_USERS = 4,
-        MSG_PRIVATE = 5,
-        MSG_SERVER_INFO = 6
-    };
+
+    // Declared after config_manager, which configures it
+    AsyncLogger logger;
+
+    // Chat rooms. Public messages fan out to the sender's current room only.
+    RoomIndex<Client> rooms; // Declared after config_manager, which sizes it
+    std::mutex rooms_mutex;
+    uint32_t lobby_room;     // Every client joins it on login; never dropped
+
+    // Durable chat log; null when disabled or not openable
+    std::unique_ptr<MessageStore> message_store;
+    // Full-text index over message_store sequence numbers; null without the store
+    std::unique_ptr<SearchIndex> search_index;
+    std::thread search_backfill; // Indexes messages stored by earlier runs
+
+    // Private messages for offline users; null when disabled
+    std::unique_ptr<OfflineMailbox> offline_mailbox;
+
+    // The binary client frame being handled on this thread, if any
+    static inline thread_local const Client* replying_to = nullptr;
+    static inline thread_local uint32_t reply_sequence = 0;
+    // When the line or frame being handled on this thread was decoded; the
+    // first output it queues records parse -> enqueue and clears it
+    static inline thread_local uint64_t parsed_at_ns = 0;
+
+    // Serves metrics to scrapers; null unless metrics_port is set
+    std::unique_ptr<MetricsEndpoint> metrics_endpoint;
+    uint64_t stats_syscalls = 0;  // io_stats at the last `stats` command
+    uint64_t stats_delivered = 0;
+
+    static constexpr const char* WELCOME_PROMPT = "=== Welcome to ChatServer ===\nEnter your username: ";
+    static constexpr const char* LOBBY_ROOM = "#lobby";
+    static constexpr size_t ROOM_LIST_PAGE_SIZE = 50;
+    static constexpr unsigned int MAX_REACTOR_THREADS = 4; // Default shard cap when none is configured
+    static constexpr int MAX_EPOLL_EVENTS = 256;
+    static constexpr unsigned URING_ENTRIES = 4096;
+    static constexpr uint16_t URING_BUFFER_GROUP = 1;
+    static constexpr unsigned URING_BUFFER_COUNT = 4096;
+    static constexpr unsigned URING_BUFFER_SIZE = 1024;
+    static constexpr size_t URING_RECV_BATCH = 64;      // Recv completions handled between send submissions
+    static constexpr size_t MAX_SEND_SLICES = 64;       // Messages gathered into one writev/SENDMSG
+    static constexpr int TIMER_TICK_MS = 100;           // Resolution of connection deadlines
     
 public:
-    ChatServer(int p = 8080, int max_c = 50) : port(p), max_clients(max_c), running(false) {
+    ChatServer(int p = 8080, int max_c = 50, IoBackend backend = IoBackend::EPOLL)
+        : server_socket(INVALID_SOCKET), client_snapshot(std::make_shared<const ClientList>()),
+          next_connection_id(1), port(p), max_clients(max_c), max_line_length(DEFAULT_MAX_LINE_LENGTH),
+          running(false), io_backend(backend), bench_interval(0), logger(config_manager.getConfig().logging),
+          rooms(static_cast<size_t>(std::max(1, config_manager.getConfig().max_rooms)), config_manager.getConfig().history) {
+        logger.start();
+        lobby_room = rooms.createPersistent(LOBBY_ROOM);
+        if (config_manager.getConfig().max_line_length > 0) {
+            max_line_length = static_cast<size_t>(config_manager.getConfig().max_line_length);
+        }
+        outbound_limits = config_manager.getConfig().outbound_limits;
+        outbound_limits.low_watermark = std::min(outbound_limits.low_watermark, outbound_limits.high_watermark);
+        timeouts = config_manager.getConfig().timeouts;
+        #ifdef __linux__
+        shard_count = 0;
+        #else
+        io_backend = IoBackend::BLOCKING;
+        #endif
+        #ifdef CHAT_HAVE_IO_URING
+        uring_wake_fd = -1;
+        uring_wake_value = 0;
+        #else
+        if (io_backend == IoBackend::IO_URING) {
+            io_backend = IoBackend::EPOLL;
+        }
+        #endif
         #ifdef _WIN32
         WSADATA wsaData;
         if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
@@ -83,39 +370,45 @@ public:
     }
     
     bool start() {
-        server_socket = socket(AF_INET, SOCK_STREAM, 0);
+        server_socket = createListener();
         if (server_socket == INVALID_SOCKET) {
-            logError("Failed to create socket");
-            return false;
-        }
-        
-        // Allow socket reuse
-        int opt = 1;
-        if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, 
-                      (char*)&opt, sizeof(opt)) < 0) {
-            logError("setsockopt failed");
-            return false;
-        }
-        
-        sockaddr_in server_addr{};
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_addr.s_addr = INADDR_ANY;
-        server_addr.sin_port = htons(port);
-        
-        if (bind(server_socket, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-            logError("Bind failed");
-            return false;
-        }
-        
-        if (listen(server_socket, 5) == SOCKET_ERROR) {
-            logError("Listen failed");
             return false;
         }
         
         running = true;
         logInfo("Chat server started on port " + std::to_string(port));
         logInfo("Maximum clients: " + std::to_string(max_clients));
-        
+        startMessageStore();
+        startMailbox();
+        startMetricsEndpoint();
+        startInterserver();
+
+        #ifdef CHAT_HAVE_IO_URING
+        if (io_backend == IoBackend::IO_URING && !startUring()) {
+            logInfo("io_uring not usable on this kernel, falling back to epoll");
+            io_backend = IoBackend::EPOLL;
+        }
+        if (io_backend == IoBackend::IO_URING) {
+            startBenchReporter();
+            return true;
+        }
+        #endif
+
+        #ifdef __linux__
+        if (io_backend == IoBackend::EPOLL) {
+            if (!startReactors()) {
+                running = false;
+                return false;
+            }
+            startBenchReporter();
+            return true;
+        }
+        #endif
+
+        logInfo("I/O backend: blocking (thread per client)");
+        startBenchReporter();
+        timer_thread = std::thread(&ChatServer::timerLoop, this);
+
         // Accept connections in a separate thread
         std::thread accept_thread(&ChatServer::acceptConnections, this);
         accept_thread.detach();
@@ -125,24 +418,70 @@ public:
     
     void stop() {
         running = false;
+        if (server_manager) {
+            server_manager->stop();
+        }
+
+        #ifdef CHAT_HAVE_IO_URING
+        stopUring();
+        #endif
+        #ifdef __linux__
+        stopReactors();
+        #endif
+        if (bench_thread.joinable()) {
+            bench_thread.join();
+            reportBench();
+        }
+        if (timer_thread.joinable()) {
+            timers_cv.notify_one();
+            timer_thread.join();
+        }
+        if (metrics_endpoint) {
+            metrics_endpoint->stop();
+        }
+
         if (server_socket != INVALID_SOCKET) {
             close(server_socket);
             server_socket = INVALID_SOCKET;
         }
         
         // Disconnect all clients
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        for (auto& client : clients) {
+        TimedLockGuard lock(clients_mutex, clients_lock_stats);
+        clients.forEach([](const std::shared_ptr<Client>& client) {
             if (client->active) {
                 std::string kick_msg = "Server is shutting down. You have been disconnected.\n";
                 send(client->socket, kick_msg.c_str(), kick_msg.length(), 0);
                 close(client->socket);
                 client->active = false;
             }
-        }
+        });
         clients.clear();
+        publishClients();
+        user_directory.clear();
+
+        if (search_backfill.joinable()) {
+            search_backfill.join();
+        }
+        if (message_store) {
+            message_store->stop(); // Indexes its last writes
+        }
+        if (search_index) {
+            search_index->stop();
+        }
     }
     
+    // Print syscalls per delivered message every `seconds` (0 disables)
+    void setBenchInterval(int seconds) { bench_interval = seconds; }
+
+    // Number of epoll shards (0 uses ServerConfig::shard_count)
+    void setShardCount(int count) {
+        #ifdef __linux__
+        shard_count = count;
+        #else
+        (void)count;
+        #endif
+    }
+
     void runConsole() {
         std::string command;
         logInfo("Server console started. Type 'help' for commands.");
@@ -152,6 +491,8 @@ public:
                 showHelp();
             } else if (command == "status") {
                 showStatus();
+            } else if (command == "stats") {
+                showStats();
             } else if (command == "list") {
                 listClients();
             } else if (command.substr(0, 9) == "broadcast") {
@@ -174,6 +515,10 @@ public:
                 if (command.length() > 8) {
                     connectToServer(command.substr(8));
                 }
+            } else if (command.substr(0, 6) == "search") {
+                showSearch(command.length() > 7 ? command.substr(7) : std::string());
+            } else if (command.substr(0, 7) == "chatlog") {
+                showChatLog(command.length() > 8 ? command.substr(8) : std::string());
             } else if (command == "servers") {
                 listServers();
             } else if (command == "network") {
@@ -189,12 +534,202 @@ public:
     }
 
 private:
+    // Bound, listening socket on `port`. Every listener sets SO_REUSEPORT so
+    // each epoll shard can own one and let the kernel spread new connections.
+    SOCKET createListener() {
+        SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == INVALID_SOCKET) {
+            logError("Failed to create socket");
+            return INVALID_SOCKET;
+        }
+        
+        // Allow socket reuse
+        int opt = 1;
+        if (setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, 
+                      (char*)&opt, sizeof(opt)) < 0) {
+            logError("setsockopt failed");
+            close(listener);
+            return INVALID_SOCKET;
+        }
+        #ifdef SO_REUSEPORT
+        if (setsockopt(listener, SOL_SOCKET, SO_REUSEPORT, (char*)&opt, sizeof(opt)) < 0) {
+            logError("setsockopt SO_REUSEPORT failed");
+            close(listener);
+            return INVALID_SOCKET;
+        }
+        #endif
+        
+        sockaddr_in server_addr{};
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = INADDR_ANY;
+        server_addr.sin_port = htons(port);
+        
+        if (bind(listener, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
+            logError("Bind failed");
+            close(listener);
+            return INVALID_SOCKET;
+        }
+        
+        if (listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+            logError("Listen failed");
+            close(listener);
+            return INVALID_SOCKET;
+        }
+        return listener;
+    }
+
+    std::shared_ptr<Client> newClient(SOCKET client_socket, const std::string& client_ip) {
+        auto client = std::make_shared<Client>(client_socket, client_ip, max_line_length, outbound_limits);
+        client->connection_id = next_connection_id.fetch_add(1, std::memory_order_relaxed);
+        enableTcpKeepalive(client_socket);
+        // Output is already coalesced per flush; Nagle on top of that only
+        // adds a delayed-ACK wait (tens of ms under chat_loadgen)
+        int nodelay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+        return client;
+    }
+
+    // Text clients get no application-level ping, so the kernel probes
+    // quiet connections instead and reports a dead peer as a recv error
+    void enableTcpKeepalive(SOCKET socket) {
+        if (timeouts.keepalive_s <= 0) {
+            return;
+        }
+        int on = 1;
+        setsockopt(socket, SOL_SOCKET, SO_KEEPALIVE, reinterpret_cast<const char*>(&on), sizeof(on));
+        #ifdef __linux__
+        int idle = timeouts.keepalive_s;
+        int count = 3;
+        int interval = std::max(1, timeouts.keepalive_timeout_s / count);
+        setsockopt(socket, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+        setsockopt(socket, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+        setsockopt(socket, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+        #endif
+    }
+
+    static int64_t steadyMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // ===== Connection deadlines =====
+    //
+    // Each connection has at most one timer, in the timing wheel of the
+    // thread that owns it. When it fires, onClientTimer() checks every
+    // deadline against the connection's timestamps and re-arms for the
+    // nearest one, so input never touches the wheel.
+
+    // Delay until a new connection's first check, or 0 for none
+    std::chrono::milliseconds firstClientDeadline() const {
+        int64_t next = 0;
+        for (int seconds : {timeouts.handshake_s, timeouts.keepalive_s, timeouts.idle_s}) {
+            if (seconds > 0 && (next == 0 || seconds * 1000LL < next)) {
+                next = seconds * 1000LL;
+            }
+        }
+        return std::chrono::milliseconds(next);
+    }
+
+    void armClientTimer(TimingWheel& wheel, Client* client, std::chrono::milliseconds delay) {
+        client->timer = delay.count() > 0 ? wheel.schedule(delay, reinterpret_cast<uintptr_t>(client))
+                                          : TimingWheel::NO_TIMER;
+    }
+
+    void runClientTimers(TimingWheel& wheel) {
+        static thread_local std::vector<uint64_t> expired;
+        expired.clear();
+        wheel.advance(std::chrono::steady_clock::now(), expired);
+        for (uint64_t data : expired) {
+            Client* client = reinterpret_cast<Client*>(static_cast<uintptr_t>(data));
+            client->timer = TimingWheel::NO_TIMER;
+            armClientTimer(wheel, client, onClientTimer(client));
+        }
+    }
+
+    // Acts on whichever deadline has passed and returns the delay to the
+    // next one; 0 when the client needs no further checks
+    std::chrono::milliseconds onClientTimer(Client* client) {
+        if (!client->active || client->state == ClientState::CLOSING) {
+            return std::chrono::milliseconds(0);
+        }
+        int64_t now = steadyMs();
+        int64_t quiet = now - client->last_input_ms.load(std::memory_order_relaxed);
+        int64_t next = 0;
+        auto consider = [&next](int64_t ms) {
+            if (ms > 0 && (next == 0 || ms < next)) {
+                next = ms;
+            }
+        };
+
+        if (client->state == ClientState::AWAITING_USERNAME) {
+            if (timeouts.handshake_s > 0) {
+                int64_t left = timeouts.handshake_s * 1000LL - (now - client->connected_ms);
+                if (left <= 0) {
+                    expireClient(client, "Timed out waiting for a username.\n", "Handshake timeout");
+                    return std::chrono::milliseconds(0);
+                }
+                consider(left);
+            }
+            // Keep checking so the joined deadlines apply once it joins
+            consider(timeouts.keepalive_s * 1000LL);
+            consider(timeouts.idle_s * 1000LL);
+            return std::chrono::milliseconds(next);
+        }
+
+        if (timeouts.idle_s > 0) {
+            int64_t left = timeouts.idle_s * 1000LL - quiet;
+            if (left <= 0) {
+                expireClient(client, "Disconnected after " + std::to_string(timeouts.idle_s) +
+                                     " seconds without activity.\n", "Idle timeout");
+                return std::chrono::milliseconds(0);
+            }
+            consider(left);
+        }
+        if (timeouts.keepalive_s > 0 && client->binary) {
+            int64_t answer_ms = std::max(1, timeouts.keepalive_timeout_s) * 1000LL;
+            bool outstanding = client->ping_sent_ms != 0 &&
+                               client->last_input_ms.load(std::memory_order_relaxed) < client->ping_sent_ms;
+            if (outstanding) {
+                int64_t left = answer_ms - (now - client->ping_sent_ms);
+                if (left <= 0) {
+                    expireClient(client, "Ping timeout.\n", "Ping timeout");
+                    return std::chrono::milliseconds(0);
+                }
+                consider(left);
+            } else if (quiet >= timeouts.keepalive_s * 1000LL) {
+                sendToClient(client, makeMessageBuffer(std::string()), FrameType::PING);
+                client->ping_sent_ms = now;
+                consider(answer_ms);
+            } else {
+                consider(timeouts.keepalive_s * 1000LL - quiet);
+            }
+        }
+        return std::chrono::milliseconds(next);
+    }
+
+    void expireClient(Client* client, const std::string& notice, const std::string& reason) {
+        sendToClient(client, notice);
+        logInfo(reason + ": " + (client->username.empty() ? client->ip_address : client->username));
+        disconnectClient(client->shared_from_this());
+    }
+
+    // Blocking backend: one wheel for every client thread
+    void timerLoop() {
+        std::unique_lock<std::mutex> lock(timers_mutex);
+        while (running) {
+            int wait = blocking_timers.msUntilNext(std::chrono::steady_clock::now());
+            timers_cv.wait_for(lock, std::chrono::milliseconds(wait < 0 ? 1000 : wait));
+            runClientTimers(blocking_timers);
+        }
+    }
+
     void acceptConnections() {
         while (running) {
             sockaddr_in client_addr{};
             socklen_t client_len = sizeof(client_addr);
             
             SOCKET client_socket = accept(server_socket, (sockaddr*)&client_addr, &client_len);
+            countSyscall();
             if (client_socket == INVALID_SOCKET) {
                 if (running) {
                     logError("Accept failed");
@@ -203,202 +738,1769 @@ private:
             }
             
             // Check max clients
-            {
-                std::lock_guard<std::mutex> lock(clients_mutex);
-                if (clients.size() >= static_cast<std::vector<std::unique_ptr<Client>>::size_type>(max_clients)) {
-                    std::string msg = "Server full. Try again later.\n";
-                    send(client_socket, msg.c_str(), msg.length(), 0);
-                    close(client_socket);
-                    continue;
-                }
+            if (onlineClients()->size() >= static_cast<size_t>(max_clients)) {
+                std::string msg = "Server full. Try again later.\n";
+                send(client_socket, msg.c_str(), msg.length(), 0);
+                close(client_socket);
+                continue;
             }
             
             std::string client_ip = inet_ntoa(client_addr.sin_addr);
             logInfo("New connection from " + client_ip);
             
             // Create client and start handler thread
-            auto client = std::make_unique<Client>(client_socket, client_ip);
+            auto client = newClient(client_socket, client_ip);
             std::thread client_thread(&ChatServer::handleClient, this, std::move(client));
             client_thread.detach();
         }
     }
     
-    void handleClient(std::unique_ptr<Client> client) {
-        char buffer[1024];
-        
+    void handleClient(std::shared_ptr<Client> client) {
+        // Output goes through a writer thread so senders never block on this socket
+        std::thread writer(&ChatServer::writeLoop, this, client);
+
         // Welcome message and username prompt
-        std::string welcome = "=== Welcome to ChatServer ===\nEnter your username: ";
-        send(client->socket, welcome.c_str(), welcome.length(), 0);
-        
-        // Get username
-        int bytes = recv(client->socket, buffer, sizeof(buffer) - 1, 0);
-        if (bytes <= 0) {
-            close(client->socket);
-            return;
+        sendToClient(client.get(), WELCOME_PROMPT);
+        {
+            std::lock_guard<std::mutex> lock(timers_mutex);
+            armClientTimer(blocking_timers, client.get(), firstClientDeadline());
         }
         
-        buffer[bytes] = '\0';
-        client->username = std::string(buffer);
-        // Remove newline characters
-        client->username.erase(std::remove(client->username.begin(), 
-                              client->username.end(), '\n'), client->username.end());
-        client->username.erase(std::remove(client->username.begin(), 
-                              client->username.end(), '\r'), client->username.end());
+        // Receive straight into the framing buffer; one recv may carry many lines
+        while (running && client->active) {
+            int bytes = recv(client->socket, client->recvPtr(), static_cast<int>(client->recvSpace()), 0);
+            countSyscall();
+            if (bytes <= 0) {
+                break;
+            }
+            
+            client->commitRecv(static_cast<size_t>(bytes));
+            processInput(client);
+        }
         
+        // Client disconnected (no-op if the username was rejected)
+        leaveClient(client.get());
+        {
+            // Under the lock so the writer cannot miss the wakeup
+            std::lock_guard<std::mutex> lock(client->send_mutex);
+            client->active = false;
+        }
+        client->send_cv.notify_one();
+        writer.join();
+        {
+            std::lock_guard<std::mutex> lock(timers_mutex);
+            blocking_timers.cancel(client->timer);
+        }
+        close(client->socket);
+    }
+
+    // Blocking backend: drains the client's outbound queue, several messages
+    // per writev, until the client is gone and its last output is written
+    void writeLoop(std::shared_ptr<Client> client) {
+        OutboundSlice slices[MAX_SEND_SLICES];
+        std::unique_lock<std::mutex> lock(client->send_mutex);
+        while (true) {
+            client->send_cv.wait(lock, [&client]() { return !client->outbound.empty() || !client->active; });
+            if (client->outbound.empty() || client->slow_consumer) {
+                // Wakes the reader if it is still blocked in recv (kick)
+                shutdown(client->socket, SHUT_RDWR);
+                return;
+            }
+
+            size_t count = client->outbound.prepare(slices, MAX_SEND_SLICES);
+            lock.unlock();
+            long sent = sendSlices(client->socket, slices, count);
+            countSyscall();
+            lock.lock();
+            if (sent <= 0) {
+                // Wake the reader too; it will see the connection drop
+                client->active = false;
+                shutdown(client->socket, SHUT_RDWR);
+                return;
+            }
+            client->outbound.consume(static_cast<size_t>(sent));
+        }
+    }
+
+    // Gathered send; returns bytes written or -1
+    static long sendSlices(SOCKET socket, OutboundSlice* slices, size_t count) {
+        #ifdef _WIN32
+        DWORD sent = 0;
+        if (WSASend(socket, slices, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) != 0) {
+            return -1;
+        }
+        return static_cast<long>(sent);
+        #else
+        msghdr msg{};
+        msg.msg_iov = slices;
+        msg.msg_iovlen = count;
+        return static_cast<long>(sendmsg(socket, &msg, MSG_NOSIGNAL));
+        #endif
+    }
+
+    // Username handshake shared by both I/O backends. Returns false if the
+    // client was rejected; the caller is responsible for closing the socket.
+    bool joinClient(const std::shared_ptr<Client>& client, const std::string& requested_name) {
+        client->username = requested_name;
         if (client->username.empty()) {
             client->username = "Anonymous_" + std::to_string(client->socket);
         }
         
-        // Check for duplicate usernames
+        // Names stay taken until the previous holder has fully left
+        bool registered;
         {
-            std::lock_guard<std::mutex> lock(clients_mutex);
-            for (const auto& existing : clients) {
-                if (existing->username == client->username && existing->active) {
-                    std::string error = "Username already taken. Connection closed.\n";
-                    send(client->socket, error.c_str(), error.length(), 0);
-                    close(client->socket);
-                    return;
-                }
+            TimedLockGuard lock(clients_mutex, clients_lock_stats);
+            registered = clients.insert(client->username, client->connection_id, client);
+            if (registered) {
+                publishClients();
+                std::string line = "- " + client->username + " (" + client->ip_address + ")\n";
+                user_directory.add(client->username, line);
             }
-            clients.push_back(std::move(client));
+        }
+        if (!registered) {
+            std::string error = "Username already taken. Connection closed.\n";
+            sendToClient(client.get(), error);
+            return false;
+        }
+        
+        std::shared_ptr<MessageHistory> lobby_history;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            rooms.join(LOBBY_ROOM, client, client->rooms);
+            client->current_room = lobby_room;
+            lobby_history = rooms.history(lobby_room);
         }
         
-        Client* client_ptr = clients.back().get();
-        logInfo("User '" + client_ptr->username + "' joined from " + client_ptr->ip_address);
+        logInfo("User '" + client->username + "' joined from " + client->ip_address);
         
         // Send join confirmation and instructions
         std::string instructions = 
             "\n=== Successfully joined chat ===\n"
+            "You are in " + std::string(LOBBY_ROOM) + ".\n"
             "Commands:\n"
-            "  /list - Show online users\n"
-            "  /pm <username> <message> - Private message\n"
+            "  /list [prefix] [page] - Show online users\n"
+            "  /pm <username> <message> - Private message" + std::string(offline_mailbox ? " (kept for offline users)" : "") + "\n"
+            "  /join <room> - Join a room and talk there\n"
+            "  /part [room] - Leave a room (default: the current one)\n"
+            "  /rooms [page] - List rooms\n"
+            "  /history [n] - Show recent messages in the current room\n"
+            "  /search <words> - Find stored messages containing every word (word* for a prefix)\n"
             "  /quit - Leave chat\n"
             "  /help - Show this help\n"
             "Just type to send public messages\n\n";
-        send(client_ptr->socket, instructions.c_str(), instructions.length(), 0);
+        sendToClient(client.get(), instructions);
+        replayHistory(client.get(), lobby_history, LOBBY_ROOM, config_manager.getConfig().history.replay_count);
+        deliverMailbox(client.get());
         
         // Notify other users
-        broadcastMessage("*** " + client_ptr->username + " joined the chat ***", client_ptr);
-        
-        // Main message loop
-        while (running && client_ptr->active) {
-            bytes = recv(client_ptr->socket, buffer, sizeof(buffer) - 1, 0);
-            if (bytes <= 0) {
-                break;
+        broadcastMessage("*** " + client->username + " joined the chat ***", client.get());
+        return true;
+    }
+
+    // Removes a joined client and tells everyone else. No-op for clients that
+    // never completed the handshake. Does not close the socket.
+    void leaveClient(Client* client_ptr) {
+        client_ptr->active = false;
+        {
+            TimedLockGuard lock(clients_mutex, clients_lock_stats);
+            // Only the registered holder of the name can remove it
+            if (clients.findById(client_ptr->connection_id).get() != client_ptr) {
+                return;
             }
-            
-            buffer[bytes] = '\0';
-            std::string message(buffer);
-            message.erase(std::remove(message.begin(), message.end(), '\n'), message.end());
-            message.erase(std::remove(message.begin(), message.end(), '\r'), message.end());
-            
-            if (message.empty()) continue;
-            
-            processMessage(client_ptr, message);
+            clients.erase(client_ptr->connection_id);
+            publishClients();
+            user_directory.remove(client_ptr->username);
+        }
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            rooms.partAll(client_ptr, client_ptr->rooms);
+            client_ptr->current_room = NO_ROOM;
         }
         
-        // Client disconnected
         logInfo("User '" + client_ptr->username + "' disconnected");
         broadcastMessage("*** " + client_ptr->username + " left the chat ***", client_ptr);
-        
-        client_ptr->active = false;
-        close(client_ptr->socket);
-        
-        // Remove from clients list
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        clients.erase(std::remove_if(clients.begin(), clients.end(),
-                     [client_ptr](const std::unique_ptr<Client>& c) {
-                         return c.get() == client_ptr;
-                     }), clients.end());
     }
-    
-    void processMessage(Client* sender, const std::string& message) {
-        if (message[0] == '/') {
-            // Handle commands
-            std::istringstream iss(message);
-            std::string command;
-            iss >> command;
-            
-            if (command == "/quit") {
-                std::string goodbye = "Goodbye!\n";
-                send(sender->socket, goodbye.c_str(), goodbye.length(), 0);
-                sender->active = false;
-            } else if (command == "/list") {
-                sendUserList(sender);
-            } else if (command == "/help") {
-                sendHelp(sender);
-            } else if (command == "/pm") {
-                std::string target, pm_message;
-                iss >> target;
-                std::getline(iss, pm_message);
-                if (!pm_message.empty()) {
-                    pm_message = pm_message.substr(1); // Remove leading space
-                    sendPrivateMessage(sender, target, pm_message);
-                }
-            } else {
-                std::string error = "Unknown command. Type /help for available commands.\n";
-                send(sender->socket, error.c_str(), error.length(), 0);
-            }
-        } else {
-            // Regular chat message
-            std::string formatted_message = getCurrentTime() + " [" + sender->username + "]: " + message;
-            broadcastMessage(formatted_message, sender);
-            logChat(sender->username, message);
-        }
+
+    // Caller holds clients_mutex
+    void publishClients() {
+        auto list = std::make_shared<ClientList>();
+        list->reserve(clients.size());
+        clients.forEach([&list](const std::shared_ptr<Client>& client) {
+            list->push_back(client);
+        });
+        std::atomic_store(&client_snapshot, std::shared_ptr<const ClientList>(std::move(list)));
     }
-    
-    void broadcastMessage(const std::string& message, Client* exclude) {
-        std::string full_message = message + "\n";
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        
-        for (auto& client : clients) {
-            if (client->active && client.get() != exclude) {
-                send(client->socket, full_message.c_str(), full_message.length(), 0);
-            }
+
+    // Joined clients as of the last join or leave; safe without clients_mutex
+    std::shared_ptr<const ClientList> onlineClients() const {
+        return std::atomic_load(&client_snapshot);
+    }
+
+    void sendToClient(Client* client, const std::string& data, FrameType type = FrameType::SERVER_INFO) {
+        sendToClient(client, makeMessageBuffer(data), type);
+    }
+
+    // Binary clients get the text without its final newline, in a frame.
+    // The frame header is per recipient, so this is a copy.
+    MessageBuffer frameOutput(const Client* client, std::string_view text, FrameType type) {
+        if (!text.empty() && text.back() == '\n') {
+            text.remove_suffix(1);
         }
+        bool reply = (client == replying_to);
+        return makeMessageBuffer(encodeFrame(type, reply ? FRAME_FLAG_REPLY : 0, reply ? reply_sequence : 0, text));
     }
-    
-    void sendPrivateMessage(Client* sender, const std::string& target, const std::string& message) {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        
-        for (auto& client : clients) {
-            if (client->active && client->username == target) {
-                std::string pm = "[PRIVATE from " + sender->username + "]: " + message + "\n";
-                send(client->socket, pm.c_str(), pm.length(), 0);
-                
-                std::string confirmation = "[PRIVATE to " + target + "]: " + message + "\n";
-                send(sender->socket, confirmation.c_str(), confirmation.length(), 0);
-                return;
-            }
+
+    // Every byte sent to a chat client goes through here. For text clients
+    // the buffer is shared, not copied, by every recipient's output queue.
+    void sendToClient(Client* client, const MessageBuffer& message, FrameType type = FrameType::SERVER_INFO) {
+        if (client->binary.load(std::memory_order_acquire)) {
+            enqueueOutput(client, frameOutput(client, *message, type));
+        } else {
+            enqueueOutput(client, message);
         }
-        
-        std::string error = "User '" + target + "' not found.\n";
-        send(sender->socket, error.c_str(), error.length(), 0);
+    }
+
+    void enqueueOutput(Client* client, const MessageBuffer& data) {
+        io_stats.messages_delivered.fetch_add(1, std::memory_order_relaxed);
+        uint64_t now = metricsNowNs();
+        if (parsed_at_ns != 0) {
+            recordMetric(Metric::PARSE_TO_ENQUEUE, now - parsed_at_ns);
+            parsed_at_ns = 0;
+        }
+        #ifdef CHAT_HAVE_IO_URING
+        if (io_backend == IoBackend::IO_URING) {
+            queueUringOutput(client, data, now);
+            return;
+        }
+        #endif
+        #ifdef __linux__
+        if (io_backend == IoBackend::EPOLL) {
+            queueOutput(client, data, now);
+            return;
+        }
+        #endif
+        bool overflow = false;
+        {
+            std::lock_guard<std::mutex> lock(client->send_mutex);
+            if (client->slow_consumer) {
+                return;
+            }
+            overflow = !client->outbound.push(data, now);
+            if (overflow) {
+                client->slow_consumer = true;
+                client->active = false;
+            }
+        }
+        if (overflow) {
+            // Unblocks both the reader and the writer thread
+            reportSlowConsumer(client);
+            shutdown(client->socket, SHUT_RDWR);
+        }
+        client->send_cv.notify_one();
+    }
+
+    void reportSlowConsumer(Client* client) {
+        logInfo("Disconnecting slow consumer '" + client->username + "' (output queue over " +
+                std::to_string(outbound_limits.high_watermark) + " bytes)");
+    }
+
+    void countSyscall() {
+        io_stats.syscalls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Handles every complete line or frame buffered for the client. Shared by
+    // all backends; stops early once the client is on its way out.
+    void processInput(const std::shared_ptr<Client>& client) {
+        client->last_input_ms.store(steadyMs(), std::memory_order_relaxed);
+        uint64_t received = metricsNowNs(); // Every backend calls this right after its recv
+        std::string_view line;
+        while (client->active && !client->frames) {
+            LineDecoder::Status status = client->input.next(line);
+            if (status == LineDecoder::Status::NEED_MORE) {
+                break;
+            }
+            if (status == LineDecoder::Status::TOO_LONG) {
+                sendTooLong(client.get());
+                continue;
+            }
+            markParsed(received);
+            handleClientLine(client, line);
+            parsed_at_ns = 0;
+        }
+        if (client->frames) {
+            processFrames(client, received);
+        }
+    }
+
+    void markParsed(uint64_t received) {
+        parsed_at_ns = metricsNowNs();
+        recordMetric(Metric::RECV_TO_PARSE, parsed_at_ns - received);
+    }
+
+    void processFrames(const std::shared_ptr<Client>& client, uint64_t received) {
+        FrameHeader header;
+        std::string_view payload;
+        while (client->active) {
+            FrameDecoder::Status status = client->frames->next(header, payload);
+            if (status == FrameDecoder::Status::NEED_MORE) {
+                break;
+            }
+            if (status == FrameDecoder::Status::TOO_LONG) {
+                sendTooLong(client.get());
+                continue;
+            }
+            markParsed(received);
+            handleClientFrame(client, header, payload);
+            parsed_at_ns = 0;
+        }
+    }
+
+    void sendTooLong(Client* client) {
+        sendToClient(client, "Message too long (max " + std::to_string(max_line_length) + " bytes), discarded.\n");
+    }
+
+    // The handshake line switches the connection to frames. Bytes the client
+    // pipelined behind it move over to the frame decoder.
+    void switchToBinary(const std::shared_ptr<Client>& client) {
+        std::string pipelined;
+        client->input.drainBuffered(pipelined);
+        client->frames = std::make_unique<FrameDecoder>(max_line_length);
+        client->frames->append(pipelined.data(), pipelined.size());
+        client->binary = true;
+        sendToClient(client.get(), makeMessageBuffer("ChatServer binary/1"), FrameType::HELLO);
+    }
+
+    void handleClientFrame(const std::shared_ptr<Client>& client, const FrameHeader& header,
+                           std::string_view payload) {
+        // Output to this client while the frame is handled answers it
+        replying_to = client.get();
+        reply_sequence = header.sequence;
+
+        switch (header.type) {
+            case FrameType::JOIN:
+                if (client->state != ClientState::AWAITING_USERNAME) {
+                    sendToClient(client.get(), "Already joined.\n");
+                } else if (joinClient(client, std::string(payload))) {
+                    client->state = ClientState::JOINED;
+                } else {
+                    client->active = false;
+                }
+                break;
+            case FrameType::CHAT:
+                if (client->state != ClientState::JOINED) {
+                    sendToClient(client.get(), "Send a JOIN frame first.\n");
+                } else if (!payload.empty()) {
+                    processMessage(client.get(), payload);
+                }
+                break;
+            case FrameType::LEAVE:
+                quitCommand(client.get(), std::string_view());
+                break;
+            case FrameType::PING:
+                sendToClient(client.get(), makeMessageBuffer(std::string()), FrameType::PONG);
+                break;
+            case FrameType::PONG:
+                break; // Any input answers a keepalive PING
+            default:
+                sendToClient(client.get(), "Unsupported frame type " +
+                                           std::to_string(static_cast<int>(header.type)) + ".\n");
+                break;
+        }
+
+        replying_to = nullptr;
+        reply_sequence = 0;
+    }
+
+    void handleClientLine(const std::shared_ptr<Client>& client, std::string_view line) {
+        if (client->state == ClientState::AWAITING_USERNAME) {
+            if (isBinaryHandshake(line)) {
+                switchToBinary(client);
+                return;
+            }
+            if (joinClient(client, std::string(line))) {
+                client->state = ClientState::JOINED;
+            } else {
+                client->active = false;
+            }
+        } else if (!line.empty()) {
+            processMessage(client.get(), line);
+        }
+    }
+
+    void disconnectClient(const std::shared_ptr<Client>& client) {
+        client->active = false;
+        #ifdef CHAT_HAVE_IO_URING
+        if (io_backend == IoBackend::IO_URING) {
+            uint64_t id = client->connection_id;
+            postUringTask([this, id]() { closeUringConnection(id, true); });
+            return;
+        }
+        #endif
+        #ifdef __linux__
+        if (io_backend == IoBackend::EPOLL) {
+            // The owning reactor closes the socket once pending output is flushed
+            postToReactor(client->reactor_index, [this, client]() {
+                beginClose(*reactors[client->reactor_index], client);
+            });
+            return;
+        }
+        #endif
+        // The writer flushes what is queued, then shuts the socket down
+        {
+            std::lock_guard<std::mutex> lock(client->send_mutex);
+            client->active = false;
+        }
+        client->send_cv.notify_one();
+    }
+
+#ifdef __linux__
+    // ===== epoll reactor backend =====
+
+    // Each shard accepts on its own SO_REUSEPORT listener and serves those
+    // connections on a thread pinned to one CPU. Shards share nothing on the
+    // message path: broadcasts and private messages reach other shards
+    // through their task inboxes.
+    bool startReactors() {
+        // Peers that vanish mid-send must not kill the process
+        signal(SIGPIPE, SIG_IGN);
+
+        unsigned int count = static_cast<unsigned int>(shard_count > 0 ? shard_count
+                                                       : config_manager.getConfig().shard_count);
+        if (count == 0) {
+            count = std::max(1u, std::min(std::thread::hardware_concurrency(), MAX_REACTOR_THREADS));
+        }
+        for (unsigned int i = 0; i < count; ++i) {
+            auto reactor = std::make_unique<Reactor>();
+            reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            reactor->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (reactor->epoll_fd < 0 || reactor->wake_fd < 0) {
+                logError("Failed to create epoll reactor");
+                if (reactor->epoll_fd >= 0) close(reactor->epoll_fd);
+                if (reactor->wake_fd >= 0) close(reactor->wake_fd);
+                stopReactors();
+                return false;
+            }
+            reactors.push_back(std::move(reactor));
+            Reactor& shard = *reactors.back();
+
+            // Shard 0 reuses the socket start() opened
+            shard.listen_fd = (i == 0) ? server_socket : createListener();
+            int flags = shard.listen_fd == INVALID_SOCKET ? -1 : fcntl(shard.listen_fd, F_GETFL, 0);
+            if (flags < 0 || fcntl(shard.listen_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+                logError("Failed to open listening socket for shard " + std::to_string(i));
+                stopReactors();
+                return false;
+            }
+
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = shard.wake_fd;
+            epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, shard.wake_fd, &ev);
+            ev.data.fd = shard.listen_fd;
+            if (epoll_ctl(shard.epoll_fd, EPOLL_CTL_ADD, shard.listen_fd, &ev) < 0) {
+                logError("Failed to register listening socket");
+                stopReactors();
+                return false;
+            }
+        }
+
+        for (size_t i = 0; i < reactors.size(); ++i) {
+            reactors[i]->thread = std::thread(&ChatServer::reactorLoop, this, i);
+            reactors[i]->cpu = pinToCpu(reactors[i]->thread, i);
+        }
+
+        logInfo("I/O backend: epoll (" + std::to_string(reactors.size()) + " SO_REUSEPORT shards)");
+        return true;
+    }
+
+    // Pins a shard thread to the index-th CPU this process may run on.
+    // Returns the CPU, or -1 if affinity could not be set.
+    int pinToCpu(std::thread& thread, size_t index) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+            return -1;
+        }
+
+        size_t target = index % static_cast<size_t>(CPU_COUNT(&allowed));
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &allowed) || target-- != 0) {
+                continue;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+                logError("Failed to pin shard " + std::to_string(index) + " to CPU " + std::to_string(cpu));
+                return -1;
+            }
+            return cpu;
+        }
+        return -1;
+    }
+
+    void stopReactors() {
+        for (auto& reactor : reactors) {
+            wakeReactor(*reactor);
+        }
+        for (auto& reactor : reactors) {
+            if (reactor->thread.joinable()) {
+                reactor->thread.join();
+            }
+        }
+
+        // Joined, active clients are closed by stop(); everything else is ours
+        for (auto& reactor : reactors) {
+            for (auto& entry : reactor->connections) {
+                const auto& client = entry.second;
+                if (client->state != ClientState::JOINED || !client->active) {
+                    close(client->socket);
+                }
+            }
+            reactor->connections.clear();
+            close(reactor->epoll_fd);
+            close(reactor->wake_fd);
+            // stop() closes server_socket, which shard 0 listens on
+            if (reactor->listen_fd != INVALID_SOCKET && reactor->listen_fd != server_socket) {
+                close(reactor->listen_fd);
+            }
+        }
+        reactors.clear();
+    }
+
+    void reactorLoop(size_t index) {
+        Reactor& reactor = *reactors[index];
+        epoll_event events[MAX_EPOLL_EVENTS];
+        current_reactor = static_cast<int>(index);
+
+        while (running) {
+            int timer_wait = reactor.timers.msUntilNext(std::chrono::steady_clock::now());
+            int count = epoll_wait(reactor.epoll_fd, events, MAX_EPOLL_EVENTS,
+                                   timer_wait < 0 ? 1000 : std::min(timer_wait, 1000));
+            countSyscall();
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                logError("epoll_wait failed");
+                break;
+            }
+
+            for (int i = 0; i < count; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == reactor.wake_fd) {
+                    uint64_t value;
+                    while (read(reactor.wake_fd, &value, sizeof(value)) > 0) {
+                        countSyscall();
+                    }
+                    runReactorTasks(reactor);
+                    continue;
+                }
+                if (fd == reactor.listen_fd) {
+                    acceptReady(reactor, index);
+                    continue;
+                }
+
+                auto it = reactor.connections.find(fd);
+                if (it == reactor.connections.end()) {
+                    continue;
+                }
+                std::shared_ptr<Client> client = it->second;
+
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    onReadable(reactor, client);
+                }
+                if (client->state != ClientState::CLOSING && !client->active) {
+                    beginClose(reactor, client);
+                } else if (events[i].events & EPOLLOUT) {
+                    flushClient(reactor, client);
+                }
+            }
+            runClientTimers(reactor.timers);
+
+            // Everything queued this round goes out with one writev per client
+            while (!reactor.dirty.empty()) {
+                std::vector<std::shared_ptr<Client>> dirty;
+                dirty.swap(reactor.dirty);
+                for (auto& client : dirty) {
+                    flushClient(reactor, client);
+                }
+            }
+        }
+    }
+
+    void acceptReady(Reactor& reactor, size_t index) {
+        while (running) {
+            sockaddr_in client_addr{};
+            socklen_t client_len = sizeof(client_addr);
+
+            SOCKET client_socket = accept4(reactor.listen_fd, (sockaddr*)&client_addr, &client_len,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+            countSyscall();
+            if (client_socket == INVALID_SOCKET) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    logError("Accept failed");
+                }
+                return;
+            }
+
+            // Check max clients
+            if (onlineClients()->size() >= static_cast<size_t>(max_clients)) {
+                std::string msg = "Server full. Try again later.\n";
+                send(client_socket, msg.c_str(), msg.length(), MSG_NOSIGNAL);
+                close(client_socket);
+                continue;
+            }
+
+            std::string client_ip = inet_ntoa(client_addr.sin_addr);
+            logInfo("New connection from " + client_ip);
+
+            // The kernel already picked this shard; the connection stays here
+            auto client = newClient(client_socket, client_ip);
+            client->reactor_index = index;
+            registerConnection(reactor, client);
+        }
+    }
+
+    void registerConnection(Reactor& reactor, const std::shared_ptr<Client>& client) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = client->socket;
+        countSyscall();
+        if (epoll_ctl(reactor.epoll_fd, EPOLL_CTL_ADD, client->socket, &ev) < 0) {
+            logError("Failed to register client socket");
+            close(client->socket);
+            return;
+        }
+        reactor.connections[client->socket] = client;
+        armClientTimer(reactor.timers, client.get(), firstClientDeadline());
+        sendToClient(client.get(), WELCOME_PROMPT);
+    }
+
+    void onReadable(Reactor& reactor, const std::shared_ptr<Client>& client) {
+        ssize_t bytes = recv(client->socket, client->recvPtr(), client->recvSpace(), 0);
+        countSyscall();
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        if (bytes <= 0) {
+            closeConnection(reactor, client);
+            return;
+        }
+        if (client->state == ClientState::CLOSING) {
+            return; // Draining output; input is discarded
+        }
+
+        client->commitRecv(static_cast<size_t>(bytes));
+        processInput(client);
+    }
+
+    void flushClient(Reactor& reactor, const std::shared_ptr<Client>& client) {
+        auto it = reactor.connections.find(client->socket);
+        if (it == reactor.connections.end() || it->second != client) {
+            return; // Already closed
+        }
+
+        bool ok;
+        bool drained;
+        {
+            std::lock_guard<std::mutex> lock(client->send_mutex);
+            client->flush_pending = false;
+            ok = !client->slow_consumer && flushOutbound(client.get());
+            drained = client->outbound.empty();
+        }
+        if (!ok || (drained && client->state == ClientState::CLOSING)) {
+            closeConnection(reactor, client);
+            return;
+        }
+        if (drained == client->watching_writable) {
+            watchWritable(reactor, client.get(), !drained);
+        }
+    }
+
+    // Stop reading and close once everything queued has reached the kernel
+    void beginClose(Reactor& reactor, const std::shared_ptr<Client>& client) {
+        if (reactor.connections.find(client->socket) == reactor.connections.end()) {
+            return; // Already closed
+        }
+        client->active = false;
+        client->state = ClientState::CLOSING;
+        flushClient(reactor, client);
+    }
+
+    void closeConnection(Reactor& reactor, const std::shared_ptr<Client>& client) {
+        auto it = reactor.connections.find(client->socket);
+        if (it == reactor.connections.end() || it->second != client) {
+            return;
+        }
+
+        // Unregister before closing so no other thread can reach a reused fd
+        leaveClient(client.get());
+        client->state = ClientState::CLOSING;
+        reactor.timers.cancel(client->timer);
+        epoll_ctl(reactor.epoll_fd, EPOLL_CTL_DEL, client->socket, nullptr);
+        countSyscall();
+        reactor.connections.erase(it);
+        close(client->socket);
+    }
+
+    // Queues output and schedules a flush on the owning reactor, so the
+    // sender never touches another client's socket
+    void queueOutput(Client* client, const MessageBuffer& data, uint64_t enqueued_ns) {
+        bool overflow = false;
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(client->send_mutex);
+            if (client->slow_consumer) {
+                return;
+            }
+            overflow = !client->outbound.push(data, enqueued_ns);
+            if (overflow) {
+                client->slow_consumer = true;
+                client->active = false;
+            }
+            if (!client->flush_pending) {
+                client->flush_pending = true;
+                schedule = true;
+            }
+        }
+        if (overflow) {
+            reportSlowConsumer(client);
+        }
+        if (schedule) {
+            std::shared_ptr<Client> ref = client->shared_from_this();
+            size_t index = client->reactor_index;
+            if (current_reactor == static_cast<int>(index)) {
+                reactors[index]->dirty.push_back(std::move(ref));
+            } else {
+                postToReactor(index, [this, ref]() { flushClient(*reactors[ref->reactor_index], ref); });
+            }
+        }
+    }
+
+    // Caller holds send_mutex. Returns false on a fatal socket error.
+    bool flushOutbound(Client* client) {
+        OutboundSlice slices[MAX_SEND_SLICES];
+        while (!client->outbound.empty()) {
+            size_t count = client->outbound.prepare(slices, MAX_SEND_SLICES);
+            long sent = sendSlices(client->socket, slices, count);
+            countSyscall();
+            if (sent < 0) {
+                if (errno == EINTR) continue;
+                return errno == EAGAIN || errno == EWOULDBLOCK;
+            }
+            client->outbound.consume(static_cast<size_t>(sent));
+        }
+        return true;
+    }
+
+    void watchWritable(Reactor& reactor, Client* client, bool writable) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | (writable ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.fd = client->socket;
+        epoll_ctl(reactor.epoll_fd, EPOLL_CTL_MOD, client->socket, &ev);
+        countSyscall();
+        client->watching_writable = writable;
+    }
+
+    void postToReactor(size_t index, std::function<void()> task) {
+        Reactor& reactor = *reactors[index];
+        {
+            std::lock_guard<std::mutex> lock(reactor.tasks_mutex);
+            reactor.tasks.push_back(std::move(task));
+        }
+        wakeReactor(reactor);
+    }
+
+    void wakeReactor(Reactor& reactor) {
+        uint64_t one = 1;
+        countSyscall();
+        if (write(reactor.wake_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated; the reactor is already due to wake up
+        }
+    }
+
+    // Runs the task inline when already on that shard's thread
+    void runOnReactor(size_t index, std::function<void()> task) {
+        if (current_reactor == static_cast<int>(index)) {
+            task();
+            return;
+        }
+        postToReactor(index, std::move(task));
+    }
+
+    // Delivers to the joined clients of the calling shard. Runs on that shard.
+    void deliverToShard(Reactor& reactor, const MessageBuffer& message, const Client* exclude, FrameType type) {
+        for (auto& entry : reactor.connections) {
+            Client* client = entry.second.get();
+            if (client->state == ClientState::JOINED && client->active && client != exclude) {
+                sendToClient(client, message, type);
+            }
+        }
+    }
+
+    void broadcastToShards(const MessageBuffer& message, const Client* exclude, FrameType type) {
+        for (size_t i = 0; i < reactors.size(); ++i) {
+            runOnReactor(i, [this, i, message, exclude, type]() {
+                deliverToShard(*reactors[i], message, exclude, type);
+            });
+        }
+    }
+
+    // The registry names the recipient's shard; only that shard is involved
+    void privateMessageToShards(Client* sender, const std::string& target, std::string_view message) {
+        std::shared_ptr<Client> recipient;
+        std::string offline_reply;
+        {
+            TimedLockGuard lock(clients_mutex, clients_lock_stats);
+            recipient = clients.findByName(target);
+            if (!recipient || !recipient->active) {
+                offline_reply = depositOffline(sender, target, message);
+            }
+        }
+        if (!offline_reply.empty()) {
+            sendToClient(sender, offline_reply);
+            return;
+        }
+
+        std::shared_ptr<Client> from = sender->shared_from_this();
+        std::string pm = privateLine("from", sender->username, message);
+        std::string confirmation = privateLine("to", target, message);
+        runOnReactor(recipient->reactor_index, [this, recipient, from, pm, confirmation]() {
+            sendToClient(recipient.get(), pm, FrameType::PRIVATE);
+            sendToClient(from.get(), confirmation, FrameType::PRIVATE);
+        });
+    }
+
+    // One task per shard that has members in the room; each shard delivers
+    // to its own members
+    void roomToShards(const std::shared_ptr<const RoomIndex<Client>::MemberList>& members, const MessageBuffer& message,
+                      const Client* exclude, FrameType type) {
+        std::vector<bool> has_members(reactors.size(), false);
+        for (const auto& client : *members) {
+            has_members[client->reactor_index] = true;
+        }
+        for (size_t i = 0; i < reactors.size(); ++i) {
+            if (!has_members[i]) {
+                continue;
+            }
+            runOnReactor(i, [this, i, members, message, exclude, type]() {
+                for (const auto& client : *members) {
+                    if (client->reactor_index == i && client->active && client.get() != exclude) {
+                        sendToClient(client.get(), message, type);
+                    }
+                }
+            });
+        }
+    }
+
+    void runReactorTasks(Reactor& reactor) {
+        std::vector<std::function<void()>> pending;
+        {
+            std::lock_guard<std::mutex> lock(reactor.tasks_mutex);
+            pending.swap(reactor.tasks);
+        }
+        for (auto& task : pending) {
+            task();
+        }
+    }
+#endif
+
+#ifdef CHAT_HAVE_IO_URING
+    // ===== io_uring backend =====
+    //
+    // A single ring thread owns every connection. Accept and recv are armed
+    // once as multishot operations; recv data lands in a kernel-selected
+    // provided buffer. Output produced while handling a batch of completions
+    // is queued per client and submitted as one gathered SENDMSG per client,
+    // so a broadcast to N clients costs one io_uring_enter.
+
+    bool startUring() {
+        if (!IoUringRing::kernelAtLeast(6, 0) || !uring.init(URING_ENTRIES)) {
+            return false;
+        }
+        if (!uring.supportsOps({IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_READ, IORING_OP_TIMEOUT}) ||
+            !uring.registerBufferRing(URING_BUFFER_GROUP, URING_BUFFER_COUNT, URING_BUFFER_SIZE)) {
+            uring.shutdown();
+            return false;
+        }
+
+        uring_wake_fd = eventfd(0, EFD_CLOEXEC);
+        if (uring_wake_fd < 0) {
+            uring.shutdown();
+            return false;
+        }
+
+        signal(SIGPIPE, SIG_IGN);
+        armUringAccept();
+        armUringWake();
+        if (uring.submit() < 0) {
+            close(uring_wake_fd);
+            uring_wake_fd = -1;
+            uring.shutdown();
+            return false;
+        }
+
+        uring_thread = std::thread(&ChatServer::uringLoop, this);
+        logInfo("I/O backend: io_uring (multishot accept/recv, " + std::to_string(URING_BUFFER_COUNT) +
+                (uring.usesLegacyBuffers() ? " legacy" : " ring") + " provided buffers)");
+        return true;
+    }
+
+    void stopUring() {
+        if (!uring_thread.joinable()) {
+            return;
+        }
+        wakeUring();
+        uring_thread.join();
+
+        // Joined, active clients are closed by stop(); everything else is ours
+        for (auto& entry : uring_connections) {
+            const auto& client = entry.second.client;
+            if (client->state != ClientState::JOINED || !client->active) {
+                close(client->socket);
+            }
+        }
+        // Tear the ring down before releasing buffers still referenced by SQEs
+        uring.shutdown();
+        uring_connections.clear();
+        uring_dirty.clear();
+        uring_recv_backlog.clear();
+        close(uring_wake_fd);
+        uring_wake_fd = -1;
+    }
+
+    void uringLoop() {
+        on_uring_thread = true;
+
+        while (running) {
+            submitUringSends();
+            int ret = uring_recv_backlog.empty() ? uring.submitAndWait(1) : uring.submit();
+            if (ret < 0 && ret != -EINTR && ret != -EAGAIN && ret != -EBUSY) {
+                logError("io_uring_enter failed: " + std::to_string(-ret));
+                break;
+            }
+
+            // Send completions are handled at once so queues drain; input is
+            // handled in bounded batches so output goes out between bursts.
+            // Backlogged recvs keep their buffers, which throttles a flooding
+            // sender once the provided buffers run out.
+            uring.forEachCompletion([this](const io_uring_cqe& cqe) {
+                if ((cqe.user_data >> 56) == URING_OP_RECV) {
+                    uring_recv_backlog.push_back(cqe);
+                } else {
+                    handleUringCompletion(cqe);
+                }
+            });
+            for (size_t i = 0; i < URING_RECV_BATCH && !uring_recv_backlog.empty(); ++i) {
+                io_uring_cqe cqe = uring_recv_backlog.front();
+                uring_recv_backlog.pop_front();
+                handleUringCompletion(cqe);
+            }
+        }
+    }
+
+    static uint64_t uringUserData(UringOp op, uint64_t id) {
+        return (static_cast<uint64_t>(op) << 56) | id;
+    }
+
+    io_uring_sqe* nextUringSqe() {
+        io_uring_sqe* sqe = uring.getSqe();
+        if (!sqe) {
+            // SQ full: hand what we have to the kernel and retry
+            uring.submit();
+            sqe = uring.getSqe();
+        }
+        return sqe;
+    }
+
+    void armUringAccept() {
+        io_uring_sqe* sqe = nextUringSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = server_socket;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = uringUserData(URING_OP_ACCEPT, 0);
+    }
+
+    void armUringRecv(uint64_t id, SOCKET socket) {
+        io_uring_sqe* sqe = nextUringSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = socket;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = uring.bufferGroup();
+        sqe->user_data = uringUserData(URING_OP_RECV, id);
+    }
+
+    // While any deadline is pending, a TIMEOUT completes every tick to run
+    // the wheel; with no connections the ring sleeps
+    void armUringTick() {
+        if (uring_tick_armed || uring_timers.size() == 0) {
+            return;
+        }
+        io_uring_sqe* sqe = nextUringSqe();
+        if (!sqe) return;
+        uring_tick.tv_sec = 0;
+        uring_tick.tv_nsec = TIMER_TICK_MS * 1000000LL;
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&uring_tick);
+        sqe->len = 1;
+        sqe->off = 0;
+        sqe->user_data = uringUserData(URING_OP_TICK, 0);
+        uring_tick_armed = true;
+    }
+
+    void armUringWake() {
+        io_uring_sqe* sqe = nextUringSqe();
+        if (!sqe) return;
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = uring_wake_fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&uring_wake_value);
+        sqe->len = sizeof(uring_wake_value);
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->user_data = uringUserData(URING_OP_WAKE, 0);
+    }
+
+    void handleUringCompletion(const io_uring_cqe& cqe) {
+        uint64_t op = cqe.user_data >> 56;
+        uint64_t id = cqe.user_data & ((1ULL << 56) - 1);
+        bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+
+        switch (op) {
+            case URING_OP_ACCEPT:
+                if (cqe.res >= 0) {
+                    acceptUringConnection(cqe.res);
+                } else if (cqe.res != -ECANCELED && running) {
+                    logError("Accept failed");
+                }
+                if (!more && running) {
+                    armUringAccept();
+                }
+                break;
+            case URING_OP_RECV:
+                handleUringRecv(id, cqe);
+                break;
+            case URING_OP_SEND:
+                handleUringSend(id, cqe.res);
+                break;
+            case URING_OP_WAKE:
+                runUringTasks();
+                if (running) {
+                    armUringWake();
+                }
+                break;
+            case URING_OP_TICK:
+                uring_tick_armed = false;
+                runClientTimers(uring_timers);
+                if (running) {
+                    armUringTick();
+                }
+                break;
+        }
+    }
+
+    void acceptUringConnection(SOCKET client_socket) {
+        // Check max clients
+        if (onlineClients()->size() >= static_cast<size_t>(max_clients)) {
+            std::string msg = "Server full. Try again later.\n";
+            send(client_socket, msg.c_str(), msg.length(), MSG_NOSIGNAL);
+            countSyscall();
+            close(client_socket);
+            return;
+        }
+
+        sockaddr_in client_addr{};
+        socklen_t client_len = sizeof(client_addr);
+        getpeername(client_socket, (sockaddr*)&client_addr, &client_len);
+        countSyscall();
+        std::string client_ip = inet_ntoa(client_addr.sin_addr);
+        logInfo("New connection from " + client_ip);
+
+        auto client = newClient(client_socket, client_ip);
+        UringConnection& connection = uring_connections[client->connection_id];
+        connection.client = client;
+        connection.slices.resize(MAX_SEND_SLICES);
+
+        armUringRecv(client->connection_id, client_socket);
+        armClientTimer(uring_timers, client.get(), firstClientDeadline());
+        armUringTick();
+        sendToClient(client.get(), WELCOME_PROMPT);
+    }
+
+    void handleUringRecv(uint64_t id, const io_uring_cqe& cqe) {
+        auto it = uring_connections.find(id);
+        bool has_buffer = (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+        uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+        if (it == uring_connections.end() || it->second.closing) {
+            if (has_buffer) {
+                uring.recycleBuffer(buffer_id);
+            }
+            return;
+        }
+        std::shared_ptr<Client> client = it->second.client;
+
+        if (cqe.res > 0 && has_buffer) {
+            // Copy into the framing buffer so the provided buffer can go back
+            const char* data = uring.bufferData(buffer_id);
+            size_t remaining = static_cast<size_t>(cqe.res);
+            while (remaining > 0 && client->active) {
+                size_t taken = client->appendRecv(data, remaining);
+                data += taken;
+                remaining -= taken;
+                processInput(client);
+            }
+            uring.recycleBuffer(buffer_id);
+
+            if (!client->active) {
+                closeUringConnection(id, true);
+                return;
+            }
+        } else if (cqe.res == -ENOBUFS) {
+            // Every provided buffer is in use; re-arm below once some are recycled
+        } else {
+            closeUringConnection(id, false);
+            return;
+        }
+
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            armUringRecv(id, client->socket);
+        }
+    }
+
+    void handleUringSend(uint64_t id, int result) {
+        auto it = uring_connections.find(id);
+        if (it == uring_connections.end()) {
+            return;
+        }
+        UringConnection& connection = it->second;
+        OutboundQueue& outbound = connection.client->outbound;
+
+        size_t expected = connection.in_flight_bytes;
+        connection.in_flight_bytes = 0;
+        if (result < 0 || static_cast<size_t>(result) != expected) {
+            // Failed or cut short (MSG_WAITALL); the stream is unusable
+            outbound.clear();
+            closeUringConnection(id, false);
+            return;
+        }
+        outbound.consume(expected);
+
+        if (connection.closing && outbound.empty()) {
+            finishUringClose(id);
+        } else if (!outbound.empty()) {
+            markUringDirty(id, connection);
+        }
+    }
+
+    void queueUringOutput(Client* client, const MessageBuffer& data, uint64_t enqueued_ns) {
+        uint64_t id = client->connection_id;
+        if (!on_uring_thread) {
+            postUringTask([this, id, data, enqueued_ns]() { queueUringOutputById(id, data, enqueued_ns); });
+            return;
+        }
+        queueUringOutputById(id, data, enqueued_ns);
+    }
+
+    void queueUringOutputById(uint64_t id, const MessageBuffer& data, uint64_t enqueued_ns) {
+        auto it = uring_connections.find(id);
+        if (it == uring_connections.end() || it->second.client->slow_consumer ||
+            (it->second.closing && it->second.client->outbound.empty())) {
+            return;
+        }
+        if (!it->second.client->outbound.push(data, enqueued_ns)) {
+            // Deferred: the caller may hold clients_mutex, which closing takes
+            it->second.client->slow_consumer = true;
+            it->second.client->active = false;
+            reportSlowConsumer(it->second.client.get());
+            postUringTask([this, id]() { closeUringConnection(id, false); });
+            return;
+        }
+        markUringDirty(id, it->second);
+    }
+
+    void markUringDirty(uint64_t id, UringConnection& connection) {
+        if (!connection.dirty) {
+            connection.dirty = true;
+            uring_dirty.push_back(id);
+        }
+    }
+
+    // Turn every client's queued output into one gathered SENDMSG
+    void submitUringSends() {
+        std::vector<uint64_t> dirty;
+        dirty.swap(uring_dirty);
+
+        for (uint64_t id : dirty) {
+            auto it = uring_connections.find(id);
+            if (it == uring_connections.end()) {
+                continue;
+            }
+            UringConnection& connection = it->second;
+            OutboundQueue& outbound = connection.client->outbound;
+            connection.dirty = false;
+            if (connection.in_flight_bytes > 0 || outbound.empty()) {
+                continue; // Resubmitted when the current send completes
+            }
+
+            size_t count = outbound.prepare(connection.slices.data(), connection.slices.size());
+            for (size_t i = 0; i < count; ++i) {
+                connection.in_flight_bytes += connection.slices[i].iov_len;
+            }
+            connection.msg = msghdr{};
+            connection.msg.msg_iov = connection.slices.data();
+            connection.msg.msg_iovlen = count;
+
+            io_uring_sqe* sqe = nextUringSqe();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = connection.client->socket;
+            sqe->addr = reinterpret_cast<uint64_t>(&connection.msg);
+            sqe->len = 1;
+            sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+            sqe->user_data = uringUserData(URING_OP_SEND, id);
+        }
+    }
+
+    // graceful: flush queued output first (quit, kick, rejected username)
+    void closeUringConnection(uint64_t id, bool graceful) {
+        auto it = uring_connections.find(id);
+        if (it == uring_connections.end()) {
+            return;
+        }
+        UringConnection& connection = it->second;
+        bool already_closing = connection.closing;
+        connection.closing = true;
+        connection.client->active = false;
+
+        if (!graceful) {
+            connection.client->outbound.clearWaiting();
+            if (!already_closing) {
+                // Completes the multishot recv and fails outstanding sends fast
+                shutdown(connection.client->socket, SHUT_RDWR);
+                countSyscall();
+            }
+        } else if (!connection.client->outbound.empty()) {
+            markUringDirty(id, connection);
+        }
+
+        if (connection.in_flight_bytes == 0 && connection.client->outbound.empty()) {
+            finishUringClose(id);
+        }
+    }
+
+    void finishUringClose(uint64_t id) {
+        auto it = uring_connections.find(id);
+        if (it == uring_connections.end()) {
+            return;
+        }
+        std::shared_ptr<Client> client = it->second.client;
+        uring_connections.erase(it);
+        uring_timers.cancel(client->timer);
+
+        // Unregister before closing so no other thread can reach a reused fd
+        leaveClient(client.get());
+        client->state = ClientState::CLOSING;
+        shutdown(client->socket, SHUT_RDWR);
+        close(client->socket);
+        io_stats.syscalls.fetch_add(2, std::memory_order_relaxed);
+    }
+
+    void postUringTask(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(uring_tasks_mutex);
+            uring_tasks.push_back(std::move(task));
+        }
+        wakeUring();
+    }
+
+    void wakeUring() {
+        uint64_t one = 1;
+        countSyscall();
+        if (write(uring_wake_fd, &one, sizeof(one)) < 0) {
+            // Counter saturated; the ring is already due to wake up
+        }
+    }
+
+    void runUringTasks() {
+        std::vector<std::function<void()>> pending;
+        {
+            std::lock_guard<std::mutex> lock(uring_tasks_mutex);
+            pending.swap(uring_tasks);
+        }
+        for (auto& task : pending) {
+            task();
+        }
+    }
+#endif
+
+    // ===== --bench reporting =====
+
+    void startBenchReporter() {
+        if (bench_interval <= 0) {
+            return;
+        }
+        bench_thread = std::thread([this]() {
+            auto next = std::chrono::steady_clock::now() + std::chrono::seconds(bench_interval);
+            while (running) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                if (std::chrono::steady_clock::now() >= next) {
+                    reportBench();
+                    next += std::chrono::seconds(bench_interval);
+                }
+            }
+        });
+    }
+
+    uint64_t totalSyscalls() const {
+        uint64_t total = io_stats.syscalls.load(std::memory_order_relaxed);
+        #ifdef CHAT_HAVE_IO_URING
+        total += uring.getEnterCalls();
+        #endif
+        return total;
+    }
+
+    void reportBench() {
+        uint64_t syscalls = totalSyscalls();
+        uint64_t delivered = io_stats.messages_delivered.load(std::memory_order_relaxed);
+        std::ostringstream ss;
+        ss << "[BENCH] backend=" << ioBackendName(io_backend)
+           << " delivered=" << delivered
+           << " syscalls=" << syscalls
+           << " syscalls/msg=" << std::fixed << std::setprecision(3)
+           << (delivered ? static_cast<double>(syscalls) / delivered : 0.0);
+        uint64_t holds = clients_lock_stats.holds.load(std::memory_order_relaxed);
+        ss << " clients_lock: holds=" << holds
+           << " avg_us=" << std::setprecision(2)
+           << (holds ? clients_lock_stats.total_ns.load(std::memory_order_relaxed) / 1000.0 / holds : 0.0)
+           << " max_us=" << clients_lock_stats.max_ns.load(std::memory_order_relaxed) / 1000.0;
+        logInfo(ss.str());
     }
     
-    void sendUserList(Client* sender) {
-        std::lock_guard<std::mutex> lock(clients_mutex);
-        std::string user_list = "\n=== Online Users ===\n";
-        
-        for (const auto& client : clients) {
-            if (client->active) {
-                user_list += "- " + client->username + " (" + client->ip_address + ")\n";
+    // `message` is a view into the client's input buffer, valid for this call
+    void processMessage(Client* sender, std::string_view message) {
+        if (message[0] == '/') {
+            std::string_view args = message;
+            std::string_view name = nextToken(args);
+            dispatchCommand(sender, lookupCommand(name), args);
+        } else {
+            std::shared_ptr<const RoomIndex<Client>::MemberList> members;
+            std::shared_ptr<MessageHistory> history;
+            std::string room;
+            {
+                std::lock_guard<std::mutex> lock(rooms_mutex);
+                if (sender->current_room != NO_ROOM) {
+                    members = rooms.members(sender->current_room);
+                    history = rooms.history(sender->current_room);
+                    if (sender->current_room != lobby_room) {
+                        room = rooms.name(sender->current_room);
+                    }
+                }
+            }
+            if (!members) {
+                sendToClient(sender, "You are not in a room. Use /join <room> to talk.\n");
+                return;
+            }
+
+            // Regular chat message, formatted once into the buffer every recipient shares.
+            // Lobby lines keep the plain format; other rooms are named after the time.
+            std::string line;
+            line.reserve(CLOCK_TIME_LENGTH + room.size() + sender->username.size() + message.size() + 6);
+            appendClockTime(line);
+            if (!room.empty()) {
+                line.append(" ").append(room);
+            }
+            line.append(" [").append(sender->username).append("]: ");
+            size_t text_start = line.size();
+            line.append(message);
+            // Binary payloads may hold line breaks; text clients must still see one line
+            std::replace_if(line.begin() + static_cast<std::ptrdiff_t>(text_start), line.end(),
+                            [](char c) { return c == '\n' || c == '\r'; }, ' ');
+            logChat(sender->username, std::string_view(line).substr(text_start), room);
+            line.push_back('\n');
+            MessageBuffer buffer = makeMessageBuffer(std::move(line));
+            history->append(buffer);
+            if (message_store) {
+                // Only queued here; the store's writer does the disk I/O
+                std::string_view text(*buffer);
+                text = text.substr(text_start, text.size() - text_start - 1);
+                // The store's writer indexes it once written, in sequence order
+                message_store->append(room.empty() ? std::string_view(LOBBY_ROOM) : room, sender->username, text);
+            }
+            broadcastToRoom(members, buffer, sender, FrameType::CHAT);
+            if (room.empty() && server_manager->hasLinks()) {
+                forwardToServers(*buffer);
+            }
+        }
+    }
+    
+    // Handlers indexed by ChatCommand; `args` is the text after the command
+    typedef void (ChatServer::*CommandHandler)(Client* sender, std::string_view args);
+
+    void dispatchCommand(Client* sender, ChatCommand command, std::string_view args) {
+        static constexpr CommandHandler handlers[] = {
+            &ChatServer::unknownCommand, // UNKNOWN
+            &ChatServer::quitCommand,    // QUIT
+            &ChatServer::listCommand,    // LIST
+            &ChatServer::helpCommand,    // HELP
+            &ChatServer::pmCommand,      // PM
+            &ChatServer::joinCommand,    // JOIN
+            &ChatServer::partCommand,    // PART
+            &ChatServer::roomsCommand,   // ROOMS
+            &ChatServer::historyCommand, // HISTORY
+            &ChatServer::searchCommand,  // SEARCH
+            &ChatServer::pingCommand,    // PING
+        };
+        static_assert(sizeof(handlers) / sizeof(handlers[0]) == static_cast<size_t>(ChatCommand::COUNT),
+                      "every ChatCommand needs a handler");
+        (this->*handlers[static_cast<size_t>(command)])(sender, args);
+    }
+
+    void unknownCommand(Client* sender, std::string_view) {
+        std::string error = "Unknown command. Type /help for available commands.\n";
+        sendToClient(sender, error);
+    }
+
+    void quitCommand(Client* sender, std::string_view) {
+        std::string goodbye = "Goodbye!\n";
+        sendToClient(sender, goodbye);
+        sender->active = false;
+    }
+
+    // A numeric argument is a page, anything else a name prefix
+    void listCommand(Client* sender, std::string_view args) {
+        std::string_view prefix;
+        size_t page = 1;
+        for (std::string_view arg = nextToken(args); !arg.empty(); arg = nextToken(args)) {
+            if (!parseCount(arg, page)) {
+                prefix = arg;
+            }
+        }
+        sendUserList(sender, prefix, page);
+    }
+
+    void helpCommand(Client* sender, std::string_view) {
+        sendHelp(sender);
+    }
+
+    // Answers straight away so clients can time a round trip through the
+    // command path; the arguments are echoed back to match the reply
+    void pingCommand(Client* sender, std::string_view args) {
+        std::string pong = "PONG";
+        pong.append(args).push_back('\n');
+        sendToClient(sender, pong);
+    }
+
+    void pmCommand(Client* sender, std::string_view args) {
+        std::string target(nextToken(args));
+        if (!args.empty()) {
+            args.remove_prefix(1); // Remove leading space
+            sendPrivateMessage(sender, target, args);
+        }
+    }
+
+    void joinCommand(Client* sender, std::string_view args) {
+        std::string room = normalizeRoomName(nextToken(args));
+        if (room.empty()) {
+            sendToClient(sender, "Usage: /join <room> (1-32 letters, digits, '-' or '_')\n");
+            return;
+        }
+
+        std::shared_ptr<Client> self = sender->shared_from_this();
+        std::shared_ptr<const RoomIndex<Client>::MemberList> members;
+        std::shared_ptr<MessageHistory> history;
+        bool was_member;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            uint32_t id = rooms.find(room);
+            was_member = (id != NO_ROOM && sender->rooms.contains(id));
+            id = rooms.join(room, self, sender->rooms);
+            if (id != NO_ROOM) {
+                sender->current_room = id;
+                members = rooms.members(id);
+                history = rooms.history(id);
+            }
+        }
+        if (!members) {
+            sendToClient(sender, "Cannot create " + room + ": the server's room limit is reached.\n");
+            return;
+        }
+
+        sendToClient(sender, "Now talking in " + room + " (" + std::to_string(members->size()) + " users).\n");
+        if (!was_member) {
+            replayHistory(sender, history, room, config_manager.getConfig().history.replay_count);
+            broadcastToRoom(members, makeMessageBuffer("*** " + sender->username + " joined " + room + " ***\n"), sender);
+        }
+    }
+
+    // /history [n]: the current room's last n chat lines
+    void historyCommand(Client* sender, std::string_view args) {
+        size_t count = config_manager.getConfig().history.replay_count;
+        parseCount(nextToken(args), count);
+
+        std::shared_ptr<MessageHistory> history;
+        std::string room;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            if (sender->current_room != NO_ROOM) {
+                history = rooms.history(sender->current_room);
+                room = rooms.name(sender->current_room);
+            }
+        }
+        if (!history) {
+            sendToClient(sender, "You are not in a room. Use /join <room> to talk.\n");
+            return;
+        }
+        if (!replayHistory(sender, history, room, count)) {
+            sendToClient(sender, "No recent messages in " + room + ".\n");
+        }
+    }
+
+    // /search <words>: the newest stored messages containing every word
+    void searchCommand(Client* sender, std::string_view args) {
+        if (!search_index) {
+            sendToClient(sender, "Search is not available: this server does not store chat history.\n");
+            return;
+        }
+        std::string_view rest = args;
+        if (nextToken(rest).empty()) {
+            sendToClient(sender, "Usage: /search <words> (word* matches a prefix)\n");
+            return;
+        }
+        sendToClient(sender, makeMessageBuffer(searchResults(args, 20)), FrameType::SEARCH_RESULTS);
+    }
+
+    // Sends up to `count` recent chat lines of a room. They are the buffers
+    // live delivery queued, so a join storm re-formats nothing. Returns false
+    // if there was nothing to send.
+    bool replayHistory(Client* client, const std::shared_ptr<MessageHistory>& history, const std::string& room,
+                       size_t count) {
+        if (!history || count == 0) {
+            return false;
+        }
+        std::vector<MessageBuffer> messages = history->recent(count);
+        if (messages.empty()) {
+            return false;
+        }
+        sendToClient(client, "--- Last " + std::to_string(messages.size()) + " messages in " + room + " ---\n");
+        for (const MessageBuffer& message : messages) {
+            sendToClient(client, message, FrameType::CHAT);
+        }
+        sendToClient(client, "--- End of history ---\n");
+        return true;
+    }
+
+    // Leaves the named room, or the current one. Talking moves to the lobby
+    // or, failing that, to the lowest-numbered room still joined.
+    void partCommand(Client* sender, std::string_view args) {
+        std::string_view arg = nextToken(args);
+        std::string room = arg.empty() ? std::string() : normalizeRoomName(arg);
+        std::shared_ptr<const RoomIndex<Client>::MemberList> remaining;
+        std::string current;
+        bool parted = false;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            uint32_t id = arg.empty() ? sender->current_room : rooms.find(room);
+            if (id != NO_ROOM && sender->rooms.contains(id)) {
+                room = rooms.name(id);
+                parted = rooms.part(id, sender, sender->rooms);
+                remaining = rooms.members(id); // Null once the last member left
+                if (sender->current_room == id) {
+                    sender->current_room = fallbackRoom(sender);
+                }
+                if (sender->current_room != NO_ROOM) {
+                    current = rooms.name(sender->current_room);
+                }
+            }
+        }
+        if (!parted) {
+            sendToClient(sender, room.empty() ? std::string("You are not in a room.\n") : "You are not in " + room + ".\n");
+            return;
+        }
+
+        std::string reply = "Left " + room + ". ";
+        reply += current.empty() ? "Use /join <room> to talk.\n" : "Now talking in " + current + ".\n";
+        sendToClient(sender, reply);
+        if (remaining) {
+            broadcastToRoom(remaining, makeMessageBuffer("*** " + sender->username + " left " + room + " ***\n"), sender);
+        }
+    }
+
+    // Caller holds rooms_mutex
+    uint32_t fallbackRoom(const Client* client) const {
+        if (client->rooms.contains(lobby_room)) {
+            return lobby_room;
+        }
+        uint32_t first = NO_ROOM;
+        client->rooms.forEach([&first](uint32_t id) {
+            if (first == NO_ROOM) {
+                first = id;
+            }
+        });
+        return first;
+    }
+
+    // /rooms [page]: every room in name order with its member count
+    void roomsCommand(Client* sender, std::string_view args) {
+        size_t page = 1;
+        parseCount(nextToken(args), page);
+        page = std::max<size_t>(page, 1);
+
+        std::string listing = "\n=== Rooms ===\n";
+        size_t total;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            total = rooms.size();
+            rooms.forEachInRange((page - 1) * ROOM_LIST_PAGE_SIZE, ROOM_LIST_PAGE_SIZE,
+                                 [&](uint32_t id, const std::string& name, size_t members) {
+                listing.append("- ").append(name).append(" (").append(std::to_string(members)).append(" users)");
+                if (id == sender->current_room) {
+                    listing.append(" [current]");
+                } else if (sender->rooms.contains(id)) {
+                    listing.append(" [joined]");
+                }
+                listing.push_back('\n');
+            });
+        }
+        size_t pages = std::max<size_t>(1, (total + ROOM_LIST_PAGE_SIZE - 1) / ROOM_LIST_PAGE_SIZE);
+        listing.append("Total: ").append(std::to_string(total)).append(" rooms");
+        if (pages > 1) {
+            listing.append(" (page ").append(std::to_string(page)).append("/").append(std::to_string(pages)).append(")");
+        }
+        listing.append("\n\n");
+        sendToClient(sender, listing, FrameType::LIST_ROOMS);
+    }
+
+    static std::string privateLine(const char* direction, const std::string& name, std::string_view message) {
+        std::string line;
+        line.reserve(16 + name.size() + message.size());
+        line.append("[PRIVATE ").append(direction).append(" ").append(name).append("]: ").append(message).push_back('\n');
+        return line;
+    }
+
+    void broadcastMessage(const std::string& message, Client* exclude) {
+        broadcastBuffer(makeMessageBuffer(message + "\n"), exclude);
+    }
+
+    // `message` holds the complete wire bytes, newline included
+    void broadcastBuffer(const MessageBuffer& message, Client* exclude, FrameType type = FrameType::SERVER_INFO) {
+        #ifdef __linux__
+        if (io_backend == IoBackend::EPOLL && !reactors.empty()) {
+            broadcastToShards(message, exclude, type);
+            return;
+        }
+        #endif
+        std::shared_ptr<const ClientList> online = onlineClients();
+        for (const auto& client : *online) {
+            if (client->active && client.get() != exclude) {
+                sendToClient(client.get(), message, type);
+            }
+        }
+    }
+    
+    // Touches only the room's members, not every connected client
+    void broadcastToRoom(const std::shared_ptr<const RoomIndex<Client>::MemberList>& members, const MessageBuffer& message,
+                         Client* exclude, FrameType type = FrameType::SERVER_INFO) {
+        #ifdef __linux__
+        if (io_backend == IoBackend::EPOLL && !reactors.empty()) {
+            roomToShards(members, message, exclude, type);
+            return;
+        }
+        #endif
+        for (const auto& client : *members) {
+            if (client->active && client.get() != exclude) {
+                sendToClient(client.get(), message, type);
             }
         }
-        user_list += "Total: " + std::to_string(clients.size()) + " users\n\n";
+    }
+    
+    void sendPrivateMessage(Client* sender, const std::string& target, std::string_view message) {
+        #ifdef __linux__
+        if (io_backend == IoBackend::EPOLL && !reactors.empty()) {
+            privateMessageToShards(sender, target, message);
+            return;
+        }
+        #endif
+        TimedLockGuard lock(clients_mutex, clients_lock_stats);
+        
+        std::shared_ptr<Client> client = clients.findByName(target);
+        if (client && client->active) {
+            sendToClient(client.get(), privateLine("from", sender->username, message), FrameType::PRIVATE);
+            sendToClient(sender, privateLine("to", target, message), FrameType::PRIVATE);
+            return;
+        }
         
-        send(sender->socket, user_list.c_str(), user_list.length(), 0);
+        sendToClient(sender, depositOffline(sender, target, message));
+    }
+
+    // Keeps a private message for a user who is not online and returns the
+    // reply for the sender. Called with clients_mutex held, so the recipient
+    // cannot join between the lookup and the deposit and miss the message;
+    // deposit() only updates memory and leaves the log write to the
+    // mailbox's writer thread.
+    std::string depositOffline(Client* sender, const std::string& target, std::string_view message) {
+        OfflineMailbox::DepositResult result = offline_mailbox
+            ? offline_mailbox->deposit(target, sender->username, message)
+            : OfflineMailbox::DepositResult::DISABLED;
+        switch (result) {
+            case OfflineMailbox::DepositResult::STORED:
+                return "User '" + target + "' is offline; your message will be delivered when they next join.\n";
+            case OfflineMailbox::DepositResult::MAILBOX_FULL:
+                return "User '" + target + "' is offline and their mailbox is full.\n";
+            case OfflineMailbox::DepositResult::STORE_FULL:
+                return "User '" + target + "' is offline and there is no room for more offline messages.\n";
+            case OfflineMailbox::DepositResult::UNKNOWN_RECIPIENT:
+                return "User '" + target + "' not found; offline messages can only go to users who have joined before.\n";
+            default:
+                return "User '" + target + "' not found.\n";
+        }
+    }
+
+    // Sends everything that arrived while the user was offline as one
+    // buffer, so it goes out in a single write
+    void deliverMailbox(Client* client) {
+        if (!offline_mailbox) {
+            return;
+        }
+        std::vector<MailboxMessage> messages = offline_mailbox->drain(client->username);
+        if (messages.empty()) {
+            return;
+        }
+        std::string batch = "--- " + std::to_string(messages.size()) +
+                            (messages.size() == 1 ? " private message" : " private messages") + " while you were away ---\n";
+        for (const MailboxMessage& message : messages) {
+            batch.push_back('[');
+            appendIsoTime(batch, std::chrono::system_clock::time_point(std::chrono::milliseconds(message.timestamp_ms)));
+            batch.append("] ").append(privateLine("from", message.sender, message.text));
+        }
+        batch.append("--- End of offline messages ---\n");
+        sendToClient(client, makeMessageBuffer(std::move(batch)), FrameType::PRIVATE);
+        logInfo("Delivered " + std::to_string(messages.size()) + " offline messages to " + client->username);
+    }
+    
+    // Served from the cached directory; the unfiltered first page is shared
+    // by every /list until the next join or leave
+    void sendUserList(Client* sender, std::string_view prefix, size_t page) {
+        sendToClient(sender, user_directory.render(prefix, page), FrameType::LIST_USERS);
     }
     
     void sendHelp(Client* sender) {
         std::string help = 
             "\n=== Chat Commands ===\n"
-            "/list - Show online users\n"
-            "/pm <username> <message> - Send private message\n"
+            "/list [prefix] [page] - Show online users\n"
+            "/pm <username> <message> - Send private message" + std::string(offline_mailbox ? " (kept for offline users)" : "") + "\n"
+            "/join <room> - Join a room and talk there\n"
+            "/part [room] - Leave a room (default: the current one)\n"
+            "/rooms [page] - List rooms\n"
+            "/history [n] - Show recent messages in the current room\n"
+            "/search <words> - Find stored messages containing every word (word* for a prefix)\n"
+            "/ping - Measure the round trip to the server\n"
             "/quit - Leave the chat\n"
             "/help - Show this help\n"
             "Just type normally to send public messages\n\n";
-        send(sender->socket, help.c_str(), help.length(), 0);
+        sendToClient(sender, help);
     }
     
     void showHelp() {
@@ -406,8 +2508,11 @@ private:
         std::cout << "\n=== Server Console Commands ===\n";
         std::cout << "help      - Show this help\n";
         std::cout << "status    - Show server status\n";
+        std::cout << "stats     - Show per-stage latency, output queues and syscalls per message\n";
         std::cout << "list      - List connected clients\n";
         std::cout << "broadcast <message> - Send message to all clients\n";
+        std::cout << "chatlog [seq|@unix_ms] [count] - Show stored chat messages\n";
+        std::cout << "search <words> - Find stored chat messages (word* for a prefix)\n";
         std::cout << "kick <username> - Disconnect a user\n";
         std::cout << "stop/quit - Shutdown server\n";
         std::cout << "\n=== Server-to-Server Commands ===\n";
@@ -418,28 +2523,241 @@ private:
     }
     
     void showStatus() {
-        std::lock_guard<std::mutex> lock1(clients_mutex);
-        std::lock_guard<std::mutex> lock2(cout_mutex);
+        std::shared_ptr<const ClientList> online = onlineClients();
+        std::lock_guard<std::mutex> lock(cout_mutex);
         
         std::cout << "\n=== Server Status ===\n";
         std::cout << "Port: " << port << "\n";
-        std::cout << "Active clients: " << clients.size() << "/" << max_clients << "\n";
+        std::cout << "Active clients: " << online->size() << "/" << max_clients << "\n";
+        std::cout << "I/O backend: " << ioBackendName(io_backend) << "\n";
+        std::cout << "Output queue: " << outbound_limits.low_watermark << "-" << outbound_limits.high_watermark
+                  << " bytes, slow consumers: " << slowConsumerPolicyName(outbound_limits.policy) << "\n";
+        #ifdef __linux__
+        for (size_t i = 0; i < reactors.size(); ++i) {
+            std::cout << "  Shard " << i << ": CPU " << reactors[i]->cpu << "\n";
+        }
+        #endif
+        {
+            std::lock_guard<std::mutex> rooms_lock(rooms_mutex);
+            std::cout << "Rooms: " << rooms.size() << "\n";
+        }
+        if (message_store) {
+            std::cout << "Message store: " << message_store->getConfig().directory << ", "
+                      << message_store->segmentCount() << " segments, next #" << message_store->nextSequence()
+                      << ", durable through #" << message_store->durableSequence() << ", "
+                      << message_store->syncCount() << " syncs, " << message_store->droppedRecords() << " dropped"
+                      << (message_store->hasFailed() ? ", stopped after a write error" : "") << "\n";
+        }
+        if (offline_mailbox) {
+            std::cout << "Offline mailboxes: " << offline_mailbox->recipientCount() << " users, "
+                      << offline_mailbox->messageCount() << " messages, " << offline_mailbox->totalBytes() / 1024
+                      << " KiB, " << offline_mailbox->expiredCount() << " expired\n";
+        }
+        if (search_index) {
+            std::cout << "Search index: " << search_index->messageCount() << " messages, "
+                      << search_index->segmentCount() << " segments, " << search_index->postingBytes() / 1024
+                      << " KiB\n";
+        }
+        std::cout << "Log: " << logSinkName(logger.getConfig().sink) << ", " << logger.writtenRecords()
+                  << " records written, " << logger.droppedRecords() << " dropped\n";
         std::cout << "Server running: " << (running ? "Yes" : "No") << "\n\n";
     }
     
+    // ===== Metrics =====
+
+    void startMetricsEndpoint() {
+        const ServerConfig& config = config_manager.getConfig();
+        if (config.metrics_port <= 0) {
+            return;
+        }
+        metrics_endpoint = std::make_unique<MetricsEndpoint>([this]() { return renderMetrics(); });
+        if (metrics_endpoint->start(config.metrics_address, config.metrics_port)) {
+            logInfo("Metrics endpoint: http://" + config.metrics_address + ":" + std::to_string(config.metrics_port) +
+                    "/metrics");
+        } else {
+            logError("Cannot serve metrics on " + config.metrics_address + ":" + std::to_string(config.metrics_port));
+            metrics_endpoint.reset();
+        }
+    }
+
+    static const char* stageLabel(Metric metric) {
+        switch (metric) {
+            case Metric::RECV_TO_PARSE: return "recv->parse";
+            case Metric::PARSE_TO_ENQUEUE: return "parse->enqueue";
+            case Metric::ENQUEUE_TO_SEND: return "enqueue->send";
+            case Metric::INTERSERVER_FORWARD: return "server forward";
+            default: return metricName(metric);
+        }
+    }
+
+    // Joined clients with the most unsent output (bytes, as sampled), deepest first
+    std::vector<std::pair<size_t, std::shared_ptr<Client>>> deepestQueues(size_t limit, size_t& total_bytes,
+                                                                          size_t& total_messages) {
+        std::shared_ptr<const ClientList> online = onlineClients();
+        std::vector<std::pair<size_t, std::shared_ptr<Client>>> deepest;
+        deepest.reserve(online->size());
+        total_bytes = 0;
+        total_messages = 0;
+        for (const auto& client : *online) {
+            size_t bytes = client->outbound.bytes();
+            total_bytes += bytes;
+            total_messages += client->outbound.messages();
+            if (bytes > 0) {
+                deepest.emplace_back(bytes, client);
+            }
+        }
+        auto deeper = [](const std::pair<size_t, std::shared_ptr<Client>>& a,
+                         const std::pair<size_t, std::shared_ptr<Client>>& b) { return a.first > b.first; };
+        limit = std::min(limit, deepest.size());
+        std::partial_sort(deepest.begin(), deepest.begin() + static_cast<std::ptrdiff_t>(limit), deepest.end(), deeper);
+        deepest.resize(limit);
+        return deepest;
+    }
+
+    void showStats() {
+        static const Metric stages[] = {Metric::RECV_TO_PARSE, Metric::PARSE_TO_ENQUEUE, Metric::ENQUEUE_TO_SEND,
+                                        Metric::INTERSERVER_FORWARD};
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1);
+        out << "\n=== Latency (microseconds) ===\n";
+        out << std::left << std::setw(16) << "stage" << std::right << std::setw(10) << "count" << std::setw(10)
+            << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10)
+            << "p99.9" << std::setw(10) << "max" << "\n";
+        for (Metric stage : stages) {
+            LatencyHistogram histogram = snapshotMetric(stage);
+            out << std::left << std::setw(16) << stageLabel(stage) << std::right << std::setw(10) << histogram.count()
+                << std::setw(10) << histogram.mean() / 1000.0;
+            for (double p : {50.0, 90.0, 99.0, 99.9}) {
+                out << std::setw(10) << histogram.percentile(p) / 1000.0;
+            }
+            out << std::setw(10) << histogram.max() / 1000.0 << "\n";
+        }
+
+        LatencyHistogram depth = snapshotMetric(Metric::QUEUE_DEPTH);
+        size_t queued_bytes = 0;
+        size_t queued_messages = 0;
+        auto deepest = deepestQueues(5, queued_bytes, queued_messages);
+        out << "\n=== Output queues ===\n";
+        out << "Depth after each enqueue (bytes): p50 " << depth.percentile(50) << ", p99 " << depth.percentile(99)
+            << ", max " << depth.max() << "\n";
+        out << "Queued now: " << queued_bytes << " bytes in " << queued_messages << " messages\n";
+        for (const auto& entry : deepest) {
+            const Client& client = *entry.second;
+            out << "  " << client.username << ": " << entry.first << " bytes, " << client.outbound.messages()
+                << " messages, " << client.outbound.droppedMessages() << " dropped\n";
+        }
+
+        uint64_t syscalls = totalSyscalls();
+        uint64_t delivered = io_stats.messages_delivered.load(std::memory_order_relaxed);
+        auto ratio = [](uint64_t calls, uint64_t messages) {
+            return messages ? static_cast<double>(calls) / static_cast<double>(messages) : 0.0;
+        };
+        out << std::setprecision(3);
+        out << "\n=== Syscalls (" << ioBackendName(io_backend) << ") ===\n";
+        out << "Total: " << syscalls << " for " << delivered << " messages delivered, "
+            << ratio(syscalls, delivered) << " per message\n";
+        out << "Since last stats: " << syscalls - stats_syscalls << " for " << delivered - stats_delivered
+            << " messages, " << ratio(syscalls - stats_syscalls, delivered - stats_delivered) << " per message\n";
+        stats_syscalls = syscalls;
+        stats_delivered = delivered;
+        if (server_manager) {
+            out << "Inter-server: " << server_manager->getTotalMessagesSent() << " sent, "
+                << server_manager->getTotalMessagesReceived() << " received\n";
+        }
+        if (metrics_endpoint) {
+            out << "Metrics endpoint: port " << metrics_endpoint->getPort() << "\n";
+        }
+
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << out.str() << "\n";
+    }
+
+    // Prometheus text exposition for the metrics endpoint
+    std::string renderMetrics() {
+        static const Metric stages[] = {Metric::RECV_TO_PARSE, Metric::PARSE_TO_ENQUEUE, Metric::ENQUEUE_TO_SEND,
+                                        Metric::INTERSERVER_FORWARD};
+        std::string out;
+        out.append("# HELP chat_stage_latency_seconds Time spent between two points of the message path.\n");
+        out.append("# TYPE chat_stage_latency_seconds histogram\n");
+        for (Metric stage : stages) {
+            appendPrometheusHistogram(out, "chat_stage_latency_seconds", std::string("stage=\"") + metricName(stage) + "\"",
+                                      snapshotMetric(stage), 1000, 1e-9);
+        }
+        out.append("# HELP chat_outbound_queue_bytes A client's unsent output right after each enqueue.\n");
+        out.append("# TYPE chat_outbound_queue_bytes histogram\n");
+        appendPrometheusHistogram(out, "chat_outbound_queue_bytes", "", snapshotMetric(Metric::QUEUE_DEPTH), 100, 1.0);
+
+        size_t queued_bytes = 0;
+        size_t queued_messages = 0;
+        deepestQueues(0, queued_bytes, queued_messages);
+        auto gauge = [&out](const char* name, const char* type, const char* help, double value) {
+            char number[32];
+            std::snprintf(number, sizeof(number), "%.17g", value);
+            out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+            out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+            out.append(name).append(" ").append(number).append("\n");
+        };
+        gauge("chat_clients", "gauge", "Joined clients.", static_cast<double>(onlineClients()->size()));
+        gauge("chat_outbound_queued_bytes", "gauge", "Unsent output across all clients.",
+              static_cast<double>(queued_bytes));
+        gauge("chat_outbound_queued_messages", "gauge", "Unsent messages across all clients.",
+              static_cast<double>(queued_messages));
+        gauge("chat_syscalls_total", "counter", "I/O syscalls on the client path.",
+              static_cast<double>(totalSyscalls()));
+        gauge("chat_messages_delivered_total", "counter", "Messages handed to a client's send path.",
+              static_cast<double>(io_stats.messages_delivered.load(std::memory_order_relaxed)));
+        if (server_manager) {
+            gauge("chat_interserver_sent_total", "counter", "Messages sent to linked servers.",
+                  static_cast<double>(server_manager->getTotalMessagesSent()));
+            gauge("chat_interserver_received_total", "counter", "Messages received from linked servers.",
+                  static_cast<double>(server_manager->getTotalMessagesReceived()));
+            appendLinkMetrics(out);
+        }
+        return out;
+    }
+
+    // Per-link counters, labelled with the peer's server id (or its address
+    // until the handshake arrives)
+    void appendLinkMetrics(std::string& out) {
+        std::vector<LinkStats> links = server_manager->getLinkStats();
+        out.append("# HELP chat_interserver_links Open links to other servers.\n");
+        out.append("# TYPE chat_interserver_links gauge\n");
+        out.append("chat_interserver_links ").append(std::to_string(links.size())).append("\n");
+        out.append("# HELP chat_interserver_link_messages_total Messages on one inter-server link.\n");
+        out.append("# TYPE chat_interserver_link_messages_total counter\n");
+        out.append("# HELP chat_interserver_link_bytes_total Bytes on one inter-server link.\n");
+        out.append("# TYPE chat_interserver_link_bytes_total counter\n");
+        out.append("# HELP chat_interserver_link_writes_total send() calls on one inter-server link.\n");
+        out.append("# TYPE chat_interserver_link_writes_total counter\n");
+        for (const LinkStats& link : links) {
+            std::string peer = "peer=\"" + (link.peer.empty() ? link.link : link.peer) + "\"";
+            auto sample = [&out, &peer](const char* name, const char* direction, uint64_t value) {
+                out.append(name).append("{").append(peer).append(",direction=\"").append(direction).append("\"} ");
+                out.append(std::to_string(value)).append("\n");
+            };
+            sample("chat_interserver_link_messages_total", "sent", link.messages_sent);
+            sample("chat_interserver_link_messages_total", "received", link.messages_received);
+            sample("chat_interserver_link_bytes_total", "sent", link.bytes_sent);
+            sample("chat_interserver_link_bytes_total", "received", link.bytes_received);
+            out.append("chat_interserver_link_writes_total{").append(peer).append("} ");
+            out.append(std::to_string(link.writes)).append("\n");
+        }
+    }
+
     void listClients() {
-        std::lock_guard<std::mutex> lock1(clients_mutex);
-        std::lock_guard<std::mutex> lock2(cout_mutex);
+        std::shared_ptr<const ClientList> online = onlineClients();
+        std::lock_guard<std::mutex> lock(cout_mutex);
         
         std::cout << "\n=== Connected Clients ===\n";
-        if (clients.empty()) {
+        if (online->empty()) {
             std::cout << "No clients connected\n\n";
             return;
         }
         
-        for (const auto& client : clients) {
+        auto now = std::chrono::system_clock::now();
+        for (const auto& client : *online) {
             if (client->active) {
-                auto duration = std::chrono::system_clock::now() - client->join_time;
+                auto duration = now - client->join_time;
                 auto minutes = std::chrono::duration_cast<std::chrono::minutes>(duration).count();
                 std::cout << "- " << client->username << " (" << client->ip_address 
                          << ") - Connected " << minutes << " mins ago\n";
@@ -448,49 +2766,229 @@ private:
         std::cout << "\n";
     }
     
+    void startMessageStore() {
+        const MessageStoreConfig& store_config = config_manager.getConfig().store;
+        if (!store_config.enabled) {
+            return;
+        }
+        message_store = std::make_unique<MessageStore>(store_config);
+        // New messages are indexed as the store writes them: in sequence
+        // order, as the index requires, and only once they can be read back
+        search_index = std::make_unique<SearchIndex>();
+        SearchIndex* index = search_index.get();
+        message_store->setWrittenHandler([index](uint64_t sequence, std::string_view text) {
+            index->add(sequence, text);
+        });
+        if (!message_store->start()) {
+            logError("Could not open message store in " + store_config.directory + "; chat will not be persisted");
+            message_store.reset();
+            search_index.reset();
+            return;
+        }
+        logInfo("Message store: " + store_config.directory + ", next sequence " +
+                std::to_string(message_store->nextSequence()));
+
+        // Earlier messages are indexed in the background
+        search_index->start();
+        uint64_t backfill_end = message_store->nextSequence();
+        if (backfill_end > 1) {
+            search_backfill = std::thread([this, backfill_end]() {
+                auto started = std::chrono::steady_clock::now();
+                std::vector<StoredMessage> batch;
+                uint64_t next = 1;
+                while (running && next < backfill_end) {
+                    batch.clear();
+                    if (message_store->readFrom(next, 4096, batch) == 0) {
+                        break;
+                    }
+                    for (const StoredMessage& message : batch) {
+                        if (message.sequence >= backfill_end) {
+                            next = backfill_end;
+                            break;
+                        }
+                        search_index->addOlder(message.sequence, message.text);
+                        next = message.sequence + 1;
+                    }
+                }
+                search_index->finishOlder();
+                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+                logInfo("Search index: " + std::to_string(search_index->messageCount()) + " stored messages indexed in " +
+                        std::to_string(elapsed.count()) + " ms");
+            });
+        }
+    }
+
+    void startMailbox() {
+        const MailboxConfig& mailbox_config = config_manager.getConfig().mailbox;
+        if (!mailbox_config.enabled) {
+            return;
+        }
+        offline_mailbox = std::make_unique<OfflineMailbox>(mailbox_config);
+        if (!offline_mailbox->open()) {
+            logError("Could not open offline mailbox log in " + mailbox_config.directory +
+                     "; offline messages will not survive a restart");
+        }
+        logInfo("Offline mailboxes: " + std::to_string(offline_mailbox->messageCount()) + " messages for " +
+                std::to_string(offline_mailbox->recipientCount()) + " users");
+    }
+
+    // Matching stored messages, newest first, one line each, with a heading
+    std::string searchResults(std::string_view query, size_t limit) {
+        query.remove_prefix(std::min(query.find_first_not_of(" \t"), query.size()));
+        auto started = std::chrono::steady_clock::now();
+        std::vector<uint64_t> ids = search_index->search(query, limit);
+        std::vector<StoredMessage> messages;
+        for (uint64_t id : ids) {
+            // Only written messages are indexed, so each hit can be read back
+            if (message_store->readFrom(id, 1, messages) == 1 && messages.back().sequence != id) {
+                messages.pop_back();
+            }
+        }
+        double elapsed_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+        std::ostringstream out;
+        out << "\n=== Search: " << query << " ===\n";
+        for (const StoredMessage& message : messages) {
+            std::string line = "#" + std::to_string(message.sequence) + " ";
+            appendIsoTime(line, std::chrono::system_clock::time_point(std::chrono::milliseconds(message.timestamp_ms)));
+            line.append(" ").append(message.room).append(" ").append(message.username).append(": ").append(message.text);
+            out << line << "\n";
+        }
+        out << messages.size() << (messages.size() == 1 ? " result" : " results") << " in " << std::fixed
+            << std::setprecision(2) << elapsed_ms << " ms\n\n";
+        return out.str();
+    }
+
+    // search <words>: console form of /search with more results
+    void showSearch(const std::string& args) {
+        if (!search_index) {
+            logError("Search needs the message store (store_enabled=true in the config file)");
+            return;
+        }
+        std::string_view query = args;
+        if (nextToken(query).empty()) {
+            logError("Usage: search <words>");
+            return;
+        }
+        std::string results = searchResults(args, 50);
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << results;
+    }
+
+    // chatlog [seq|@unix_ms] [count]: stored messages from a sequence number
+    // or a time; the last `count` (default 20) without a start
+    void showChatLog(const std::string& args) {
+        if (!message_store) {
+            logError("Message store is disabled (store_enabled=true in the config file)");
+            return;
+        }
+        std::string_view rest = args;
+        std::string_view start = nextToken(rest);
+        size_t count = 20;
+        parseCount(nextToken(rest), count);
+
+        uint64_t from;
+        bool by_time = !start.empty() && start[0] == '@';
+        std::string number(start.substr(by_time ? 1 : 0));
+        if (start.empty()) {
+            uint64_t next = message_store->nextSequence();
+            from = next > count ? next - count : 1;
+        } else if (!number.empty() && number.find_first_not_of("0123456789") == std::string::npos) {
+            uint64_t value = std::strtoull(number.c_str(), nullptr, 10);
+            from = by_time ? message_store->seekTime(static_cast<int64_t>(value)) : value;
+        } else {
+            logError("Usage: chatlog [seq|@unix_ms] [count]");
+            return;
+        }
+
+        std::vector<StoredMessage> messages;
+        message_store->readFrom(from, count, messages);
+        std::lock_guard<std::mutex> lock(cout_mutex);
+        std::cout << "\n=== Chat Log from #" << from << " ===\n";
+        for (const StoredMessage& message : messages) {
+            std::string line = "#" + std::to_string(message.sequence) + " ";
+            appendIsoTime(line, std::chrono::system_clock::time_point(std::chrono::milliseconds(message.timestamp_ms)));
+            line.append(" ").append(message.room).append(" ").append(message.username).append(": ").append(message.text);
+            std::cout << line << "\n";
+        }
+        std::cout << messages.size() << " messages\n\n";
+    }
+    
     void kickUser(const std::string& username) {
-        std::lock_guard<std::mutex> lock(clients_mutex);
+        TimedLockGuard lock(clients_mutex, clients_lock_stats);
         
-        for (auto& client : clients) {
-            if (client->active && client->username == username) {
-                std::string kick_msg = "You have been kicked from the server.\n";
-                send(client->socket, kick_msg.c_str(), kick_msg.length(), 0);
-                client->active = false;
-                close(client->socket);
-                logInfo("Kicked user: " + username);
-                return;
-            }
+        std::shared_ptr<Client> client = clients.findByName(username);
+        if (client && client->active) {
+            std::string kick_msg = "You have been kicked from the server.\n";
+            sendToClient(client.get(), kick_msg);
+            disconnectClient(client);
+            logInfo("Kicked user: " + username);
+            return;
         }
         
         std::lock_guard<std::mutex> cout_lock(cout_mutex);
         std::cout << "User '" << username << "' not found.\n";
     }
     
-    std::string getCurrentTime() {
-        auto now = std::chrono::system_clock::now();
-        auto time_t = std::chrono::system_clock::to_time_t(now);
-        
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&time_t), "[%H:%M:%S]");
-        return ss.str();
-    }
-    
+    // Logging never blocks: records are queued for the logger's writer thread
     void logInfo(const std::string& message) {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::cout << getCurrentTime() << " [INFO] " << message << "\n";
+        logger.log(LogLevel::INFO, message);
     }
     
     void logError(const std::string& message) {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::cout << getCurrentTime() << " [ERROR] " << message << "\n";
+        logger.log(LogLevel::ERR, message);
     }
     
-    void logChat(const std::string& username, const std::string& message) {
-        std::lock_guard<std::mutex> lock(cout_mutex);
-        std::cout << getCurrentTime() << " [CHAT] " << username << ": " << message << "\n";
+    void logChat(const std::string& username, std::string_view message, const std::string& room = std::string()) {
+        std::string text;
+        text.reserve(room.size() + username.size() + message.size() + 3);
+        if (!room.empty()) {
+            text.append(room).append(" ");
+        }
+        text.append(username).append(": ").append(message);
+        logger.log(LogLevel::CHAT, std::move(text));
     }
 
     // Server-to-server communication methods
+
+    // Lobby chat is forwarded to every linked server and shown in its lobby.
+    // Forwarded lines are not passed on again, so servers are fully meshed.
+    void startInterserver() {
+        const ServerConfig& config = config_manager.getConfig();
+        server_manager = std::make_unique<ServerManager>(config_manager);
+        server_manager->setForwardHandler([this](const ServerMessage& message) { deliverForwarded(message); });
+        if (config.enable_interserver_communication) {
+            server_manager->start();
+            server_manager->listen(config.interserver_port);
+        }
+    }
+
+    // `line` is a formatted lobby line, newline included
+    void forwardToServers(std::string_view line) {
+        if (!config_manager.getConfig().enable_message_forwarding) {
+            return;
+        }
+        line.remove_suffix(1);
+        server_manager->sendMessage(
+            ServerMessage(ServerMessageType::MSG_FORWARD_PUBLIC, server_manager->getServerId(), std::string(line)));
+    }
+
+    // Runs on the server manager's network thread
+    void deliverForwarded(const ServerMessage& message) {
+        if (message.type != ServerMessageType::MSG_FORWARD_PUBLIC || message.payload.empty()) {
+            return;
+        }
+        std::shared_ptr<const RoomIndex<Client>::MemberList> members;
+        {
+            std::lock_guard<std::mutex> lock(rooms_mutex);
+            members = rooms.members(lobby_room);
+        }
+        if (members) {
+            broadcastToRoom(members, makeMessageBuffer(message.payload + "\n"), nullptr, FrameType::CHAT);
+        }
+    }
+
     void connectToServer(const std::string& server_info) {
         // Parse host:port
         size_t colon_pos = server_info.find(':');
@@ -511,6 +3009,7 @@ private:
         if (!server_manager) {
             server_manager = std::make_unique<ServerManager>(config_manager);
         }
+        server_manager->start(); // Runs peer heartbeats and timeouts
 
         if (server_manager->connectToServer(host, port)) {
             logInfo("Successfully connected to server " + host + ":" + std::to_string(port));
@@ -551,13 +3050,18 @@ private:
             return;
         }
 
-        auto servers = server_manager->getConnectedServers();
-        std::cout << "Total connected servers: " << servers.size() << "\n";
+        auto links = server_manager->getLinkStats();
+        std::cout << "Server id: " << server_manager->getServerId() << "\n";
+        std::cout << "Total connected servers: " << links.size() << "\n";
 
-        if (!servers.empty()) {
+        if (!links.empty()) {
             std::cout << "Server list:\n";
-            for (const auto& server : servers) {
-                std::cout << "  - " << server.host << ":" << server.port << "\n";
+            for (const auto& link : links) {
+                std::cout << "  - " << link.link << (link.inbound ? " (inbound)" : "")
+                          << (link.peer.empty() ? "" : " " + link.peer) << ": sent " << link.messages_sent
+                          << " messages / " << link.bytes_sent << " bytes in " << link.writes
+                          << " writes, received " << link.messages_received
+                          << " / " << link.bytes_received << "\n";
             }
         }
         std::cout << "\n";
@@ -569,7 +3073,7 @@ private:
             return;
         }
 
-        ServerMessage msg(ServerMessageType::MSG_FORWARD_PUBLIC, config_manager.getConfig().server_id, message); if (server_manager->broadcastMessage(msg)) {
+        ServerMessage msg(ServerMessageType::MSG_FORWARD_PUBLIC, server_manager->getServerId(), message); if (server_manager->broadcastMessage(msg)) {
             logInfo("Message sent to all connected servers: " + message);
         } else {
             logError("Failed to send message to servers");
@@ -580,6 +3084,9 @@ private:
 int main(int argc, char* argv[]) {
     int port = 8080;
     int max_clients = 50;
+    IoBackend backend = IoBackend::EPOLL;
+    int bench_interval = 0;
+    int shards = 0;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -587,18 +3094,32 @@ int main(int argc, char* argv[]) {
             port = std::atoi(argv[++i]);
         } else if (std::string(argv[i]) == "-m" && i + 1 < argc) {
             max_clients = std::atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "-t" && i + 1 < argc) {
+            shards = std::atoi(argv[++i]);
+        } else if (std::string(argv[i]) == "--blocking") {
+            backend = IoBackend::BLOCKING;
+        } else if (std::string(argv[i]) == "--io-uring") {
+            backend = IoBackend::IO_URING;
+        } else if (std::string(argv[i]) == "--bench" && i + 1 < argc) {
+            bench_interval = std::atoi(argv[++i]);
         } else if (std::string(argv[i]) == "-h" || std::string(argv[i]) == "--help") {
             std::cout << "Usage: " << argv[0] << " [options]\n";
             std::cout << "Options:\n";
             std::cout << "  -p <port>     Set server port (default: 8080)\n";
             std::cout << "  -m <max>      Set max clients (default: 50)\n";
+            std::cout << "  -t <shards>   Number of SO_REUSEPORT epoll shards (default: config or cores, max 4)\n";
+            std::cout << "  --blocking    Use one thread per client instead of epoll reactors\n";
+            std::cout << "  --io-uring    Use the io_uring backend (falls back to epoll if unsupported)\n";
+            std::cout << "  --bench <s>   Report syscalls per delivered message every <s> seconds\n";
             std::cout << "  -h, --help    Show this help\n";
             return 0;
         }
     }
     
     try {
-        ChatServer server(port, max_clients);
+        ChatServer server(port, max_clients, backend);
+        server.setBenchInterval(bench_interval);
+        server.setShardCount(shards);
         
         if (!server.start()) {
             std::cerr << "Failed to start server\n";
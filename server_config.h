@@ -5,6 +5,24 @@
 #include <vector>
 #include <map>
 #include "interserver_protocol.h"
+#include "line_decoder.h"
+#include "outbound_queue.h"
+#include "async_logger.h"
+#include "message_history.h"
+#include "message_store.h"
+#include "offline_mailbox.h"
+
+const int DEFAULT_MAX_ROOMS = 10000;
+
+// Per-connection deadlines in seconds; 0 turns one off
+struct ClientTimeouts {
+    int handshake_s;         // Connected but no username yet: dropped
+    int keepalive_s;         // Silent this long: binary clients get a PING, every socket TCP keepalive probes
+    int keepalive_timeout_s; // An unanswered PING or probe sequence this long drops the connection
+    int idle_s;              // Joined but silent this long: disconnected
+
+    ClientTimeouts() : handshake_s(30), keepalive_s(60), keepalive_timeout_s(30), idle_s(0) {}
+};
 
 // Server configuration structure
 struct ServerConfig {
@@ -13,10 +31,25 @@ struct ServerConfig {
     std::string server_name;
     int port;
     int max_clients;
+    int shard_count; // epoll shards (SO_REUSEPORT listeners); 0 picks from the core count
+    int max_line_length; // Longer client lines are discarded
+    OutboundLimits outbound_limits; // Per-client output queue watermarks and slow-consumer policy
+    LogConfig logging; // Log sink, file rotation and queue size
+    int max_rooms; // Chat rooms that may exist at once, the lobby included
+    HistoryLimits history; // Per-room recent-message ring and replay on join
+    MessageStoreConfig store; // Durable chat log on disk
+    MailboxConfig mailbox; // Private messages kept for offline users
+    ClientTimeouts timeouts; // Handshake, keepalive and idle deadlines
+    int metrics_port; // HTTP endpoint serving /metrics; 0 turns it off
+    std::string metrics_address; // Interface it binds to
     bool enable_interserver_communication;
 
     // Inter-server communication settings
     int interserver_port;
+    int interserver_heartbeat_s; // Heartbeat to a peer silent this long
+    int interserver_timeout_s;   // Drop a peer silent this long
+    int interserver_batch_delay_us; // Longest a forwarded message waits to share a write; 0 = no batching
+    int interserver_batch_bytes;    // A batch this large is written at once
     std::string network_password; // For server authentication
     std::vector<std::string> allowed_servers; // List of allowed server IDs
 
@@ -29,8 +62,12 @@ struct ServerConfig {
     bool enable_message_forwarding;
     bool enable_server_commands;
 
-    ServerConfig() : port(8080), max_clients(50), enable_interserver_communication(false),
-                     interserver_port(DEFAULT_INTERSERVER_PORT), enable_user_sync(true),
+    ServerConfig() : port(8080), max_clients(50), shard_count(0), max_line_length(static_cast<int>(DEFAULT_MAX_LINE_LENGTH)),
+                     max_rooms(DEFAULT_MAX_ROOMS), metrics_port(0), metrics_address("127.0.0.1"),
+                     enable_interserver_communication(false),
+                     interserver_port(DEFAULT_INTERSERVER_PORT), interserver_heartbeat_s(30),
+                     interserver_timeout_s(300), interserver_batch_delay_us(500),
+                     interserver_batch_bytes(16 * 1024), enable_user_sync(true),
                      enable_message_forwarding(true), enable_server_commands(true) {}
 };
 
@@ -56,6 +93,7 @@ public:
     void setServerName(const std::string& name) { config.server_name = name; }
     void setPort(int p) { config.port = p; }
     void setMaxClients(int max) { config.max_clients = max; }
+    void setShardCount(int count) { config.shard_count = count; }
     void setInterserverPort(int port) { config.interserver_port = port; }
     void setNetworkPassword(const std::string& password) { config.network_password = password; }
 
@@ -1,12 +1,21 @@
 #include "server_manager.h"
+#include "metrics.h"
 #include <iostream>
 #include <sstream>
 #include <algorithm>
 
+#ifdef _WIN32
+    #define SEND_FLAGS 0
+#else
+    #define SEND_FLAGS MSG_NOSIGNAL // A vanished peer is a send error, not SIGPIPE
+#endif
+
 // ServerManager implementation
 ServerManager::ServerManager(ConfigManager& config)
-    : config_manager(config), running(false), total_messages_sent(0), total_messages_received(0) {
+    : running(false), config_manager(config), total_messages_sent(0), total_messages_received(0) {
     start_time = std::chrono::system_clock::now();
+    server_id = config.getConfig().server_id.empty() ? generateServerId() : config.getConfig().server_id;
+    server_name = config.getConfig().server_name;
 }
 
 ServerManager::~ServerManager() {
@@ -33,17 +42,95 @@ void ServerManager::stop() {
     running = false;
     message_cv.notify_all();
 
+    if (listen_socket != INVALID_SOCKET) {
+        // Wakes accept() in the accept thread
+        #ifdef _WIN32
+            closesocket(listen_socket);
+        #else
+            shutdown(listen_socket, SHUT_RDWR);
+        #endif
+    }
+    if (accept_thread.joinable()) {
+        accept_thread.join();
+    }
+    if (listen_socket != INVALID_SOCKET) {
+        #ifndef _WIN32
+            close(listen_socket);
+        #endif
+        listen_socket = INVALID_SOCKET;
+    }
+
     if (network_thread.joinable()) {
         network_thread.join();
     }
 
-    // Disconnect all connections
+    // Disconnect all connections, writing out what they still have batched
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(connections_mutex));
-    connections.clear();
+    for (const auto& pair : connections) {
+        pair.second->flush();
+    }
+    while (!connections.empty()) {
+        eraseConnection(connections.begin());
+    }
 
     logNetworkMessage("Server manager stopped");
 }
 
+bool ServerManager::listen(int port) {
+    listen_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_socket == INVALID_SOCKET) {
+        return false;
+    }
+
+    int opt = 1;
+    setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+    if (bind(listen_socket, (sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        ::listen(listen_socket, SOMAXCONN) == SOCKET_ERROR) {
+        logNetworkMessage("Cannot accept server links on port " + std::to_string(port));
+        close(listen_socket);
+        listen_socket = INVALID_SOCKET;
+        return false;
+    }
+
+    accept_thread = std::thread(&ServerManager::acceptLoop, this);
+    logNetworkMessage("Accepting server links on port " + std::to_string(port));
+    return true;
+}
+
+void ServerManager::acceptLoop() {
+    while (running) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        SOCKET socket = accept(listen_socket, (sockaddr*)&address, &length);
+        if (socket == INVALID_SOCKET) {
+            if (!running) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        char ip[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &address.sin_addr, ip, sizeof(ip));
+        auto connection = std::make_unique<InterServerConnection>(this, socket, ip, ntohs(address.sin_port));
+
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        const ServerConfig& config = config_manager.getConfig();
+        connection->setBatching(std::chrono::microseconds(std::max(0, config.interserver_batch_delay_us)),
+                                static_cast<size_t>(std::max(1, config.interserver_batch_bytes)));
+        connection->startInbound();
+        armLiveness(connection.get(), std::chrono::seconds(config_manager.getConfig().interserver_heartbeat_s));
+        logNetworkMessage("Accepted server link from " + connection->getServerId());
+        connections[connection->getServerId()] = std::move(connection);
+        link_count.store(connections.size(), std::memory_order_relaxed);
+    }
+}
+
 bool ServerManager::connectToServer(const std::string& host, int port) {
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(connections_mutex));
 
@@ -55,8 +142,13 @@ bool ServerManager::connectToServer(const std::string& host, int port) {
     }
 
     auto connection = std::make_unique<InterServerConnection>(this, host, port);
+    const ServerConfig& config = config_manager.getConfig();
+    connection->setBatching(std::chrono::microseconds(std::max(0, config.interserver_batch_delay_us)),
+                            static_cast<size_t>(std::max(1, config.interserver_batch_bytes)));
     if (connection->connect()) {
+        armLiveness(connection.get(), std::chrono::seconds(config_manager.getConfig().interserver_heartbeat_s));
         connections[connection->getServerId()] = std::move(connection);
+        link_count.store(connections.size(), std::memory_order_relaxed);
         logNetworkMessage("Connected to server: " + host + ":" + std::to_string(port));
         return true;
     }
@@ -70,7 +162,7 @@ bool ServerManager::disconnectFromServer(const std::string& server_id) {
     auto it = connections.find(server_id);
     if (it != connections.end()) {
         it->second->disconnect();
-        connections.erase(it);
+        eraseConnection(it);
         logNetworkMessage("Disconnected from server: " + server_id);
         return true;
     }
@@ -84,6 +176,7 @@ bool ServerManager::isConnectedToServer(const std::string& server_id) const {
 }
 
 bool ServerManager::sendMessage(const ServerMessage& message) {
+    uint64_t start = metricsNowNs();
     std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(connections_mutex));
 
     bool sent = false;
@@ -95,6 +188,7 @@ bool ServerManager::sendMessage(const ServerMessage& message) {
 
     if (sent) {
         total_messages_sent++;
+        recordMetric(Metric::INTERSERVER_FORWARD, metricsNowNs() - start);
     }
 
     return sent;
@@ -104,11 +198,27 @@ bool ServerManager::broadcastMessage(const ServerMessage& message) {
     return sendMessage(message);
 }
 
+void ServerManager::flush() {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    for (const auto& pair : connections) {
+        pair.second->flush();
+    }
+}
+
+void ServerManager::queueMessage(ServerMessage message) {
+    {
+        std::lock_guard<std::mutex> lock(message_mutex);
+        message_queue.push(std::move(message));
+    }
+    message_cv.notify_one();
+}
+
 void ServerManager::processMessage(const ServerMessage& message) {
     total_messages_received++;
 
     switch (message.type) {
         case ServerMessageType::SERVER_HANDSHAKE:
+        case ServerMessageType::SERVER_HANDSHAKE_ACK:
             handleHandshake(message);
             break;
         case ServerMessageType::SERVER_REGISTER:
@@ -126,6 +236,8 @@ void ServerManager::processMessage(const ServerMessage& message) {
         case ServerMessageType::SERVER_STATUS_REQUEST:
             handleServerStatus(message);
             break;
+        case ServerMessageType::SERVER_HEARTBEAT:
+            break; // Receiving it already refreshed the link's activity
         default:
             logNetworkMessage("Unknown message type received: " + std::to_string(static_cast<int>(message.type)));
             break;
@@ -137,12 +249,12 @@ void ServerManager::discoverServers() {
     logNetworkMessage("Server discovery not yet implemented");
 }
 
-void ServerManager::registerWithServer(const std::string& server_id) {
+void ServerManager::registerWithServer(const std::string& /*server_id*/) {
     // TODO: Implement server registration
     logNetworkMessage("Server registration not yet implemented");
 }
 
-void ServerManager::unregisterFromServer(const std::string& server_id) {
+void ServerManager::unregisterFromServer(const std::string& /*server_id*/) {
     // TODO: Implement server unregistration
     logNetworkMessage("Server unregistration not yet implemented");
 }
@@ -164,6 +276,15 @@ std::vector<ServerInfo> ServerManager::getConnectedServers() const {
     return servers;
 }
 
+std::vector<LinkStats> ServerManager::getLinkStats() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(connections_mutex));
+    std::vector<LinkStats> links;
+    for (const auto& pair : connections) {
+        links.push_back(pair.second->getStats());
+    }
+    return links;
+}
+
 std::string ServerManager::getNetworkStatus() const {
     std::stringstream ss;
     ss << "Network Status:\n";
@@ -180,11 +301,18 @@ std::string ServerManager::getNetworkStatus() const {
 
 void ServerManager::networkLoop() {
     while (running) {
-        cleanupDeadConnections();
+        runLivenessTimers();
+        int wait;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            wait = liveness.msUntilNext(std::chrono::steady_clock::now());
+        }
 
         // Process message queue
         std::unique_lock<std::mutex> lock(message_mutex);
-        message_cv.wait_for(lock, std::chrono::seconds(1));
+        if (message_queue.empty()) {
+            message_cv.wait_for(lock, std::chrono::milliseconds(wait < 0 ? 1000 : std::min(wait, 1000)));
+        }
 
         while (!message_queue.empty()) {
             ServerMessage msg = message_queue.front();
@@ -207,7 +335,11 @@ void ServerManager::handleServerRegister(const ServerMessage& message) {
 }
 
 void ServerManager::handleMessageForward(const ServerMessage& message) {
-    logNetworkMessage("Message forwarded: " + message.payload);
+    if (forward_handler) {
+        forward_handler(message);
+    } else {
+        logNetworkMessage("Message forwarded: " + message.payload);
+    }
 }
 
 void ServerManager::handleUserSync(const ServerMessage& message) {
@@ -218,28 +350,79 @@ void ServerManager::handleServerStatus(const ServerMessage& message) {
     logNetworkMessage("Server status request from: " + message.server_id);
 }
 
-void ServerManager::cleanupDeadConnections() {
-    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(connections_mutex));
+// Each connection has one timer, re-armed for whichever comes first: its
+// next heartbeat or its timeout. Only connections due for a check are
+// visited, instead of scanning them all every second.
+void ServerManager::armLiveness(InterServerConnection* connection, std::chrono::milliseconds delay) {
+    connection->setLivenessTimer(delay.count() > 0 ? liveness.schedule(delay, reinterpret_cast<uintptr_t>(connection))
+                                                   : TimingWheel::NO_TIMER);
+}
 
-    auto it = connections.begin();
-    while (it != connections.end()) {
-        auto timeout = std::chrono::minutes(5);
-        if (std::chrono::system_clock::now() - it->second->getLastActivity() > timeout) {
-            logNetworkMessage("Connection timeout: " + it->first);
-            it = connections.erase(it);
-        } else {
-            ++it;
+void ServerManager::runLivenessTimers() {
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    std::vector<uint64_t> expired;
+    liveness.advance(std::chrono::steady_clock::now(), expired);
+    for (uint64_t data : expired) {
+        auto* connection = reinterpret_cast<InterServerConnection*>(static_cast<uintptr_t>(data));
+        connection->setLivenessTimer(TimingWheel::NO_TIMER);
+        std::chrono::milliseconds next = checkLiveness(connection);
+        if (next.count() > 0) {
+            armLiveness(connection, next);
         }
     }
 }
 
+// Sends a heartbeat or drops the peer as due; returns the delay to the next
+// check, or 0 once the connection is gone
+std::chrono::milliseconds ServerManager::checkLiveness(InterServerConnection* connection) {
+    const ServerConfig& config = config_manager.getConfig();
+    auto heartbeat = std::chrono::milliseconds(std::max(1, config.interserver_heartbeat_s) * 1000LL);
+    auto timeout = std::chrono::milliseconds(std::max(1, config.interserver_timeout_s) * 1000LL);
+    auto silent = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now() - connection->getLastActivity());
+
+    if (silent >= timeout || !connection->isConnected()) {
+        auto it = connections.find(connection->getServerId());
+        logNetworkMessage("Connection timeout: " + connection->getServerId());
+        if (it != connections.end()) {
+            eraseConnection(it);
+        }
+        return std::chrono::milliseconds(0);
+    }
+    if (silent >= heartbeat) {
+        connection->sendMessage(ServerMessage(ServerMessageType::SERVER_HEARTBEAT, server_id), true);
+        return std::min(heartbeat, timeout - silent);
+    }
+    return std::min(heartbeat - silent, timeout - silent);
+}
+
+void ServerManager::eraseConnection(std::map<std::string, std::unique_ptr<InterServerConnection>>::iterator it) {
+    liveness.cancel(it->second->getLivenessTimer());
+    connections.erase(it);
+    link_count.store(connections.size(), std::memory_order_relaxed);
+}
+
 void ServerManager::logNetworkMessage(const std::string& message) {
     std::cout << "[NETWORK] " << message << std::endl;
 }
 
 // InterServerConnection implementation
+
+// Forwarded chat is small and latency-bound; don't let Nagle hold it back
+static void setNoDelay(SOCKET socket) {
+    int nodelay = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+}
+
 InterServerConnection::InterServerConnection(ServerManager* mgr, const std::string& host, int port)
-    : manager(mgr), host(host), port(port), connected(false), connection_socket(INVALID_SOCKET) {
+    : connection_socket(INVALID_SOCKET), host(host), port(port), connected(false), manager(mgr),
+      liveness_timer(TimingWheel::NO_TIMER) {
+    server_id = host + ":" + std::to_string(port);
+}
+
+InterServerConnection::InterServerConnection(ServerManager* mgr, SOCKET socket, const std::string& host, int port)
+    : connection_socket(socket), host(host), port(port), connected(true), manager(mgr),
+      liveness_timer(TimingWheel::NO_TIMER), inbound(true) {
     server_id = host + ":" + std::to_string(port);
 }
 
@@ -264,33 +447,70 @@ bool InterServerConnection::connect() {
 
     if (inet_pton(AF_INET, host.c_str(), &server_addr.sin_addr) <= 0) {
         close(connection_socket);
+        connection_socket = INVALID_SOCKET;
         return false;
     }
 
     if (::connect(connection_socket, (sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
         close(connection_socket);
+        connection_socket = INVALID_SOCKET;
         return false;
     }
 
     connected = true;
+    setNoDelay(connection_socket);
     updateActivity();
 
     // Start receive thread
     receive_thread = std::thread(&InterServerConnection::receiveLoop, this);
+    startSendThread();
 
     return performHandshake();
 }
 
+void InterServerConnection::startInbound() {
+    setNoDelay(connection_socket);
+    updateActivity();
+    receive_thread = std::thread(&InterServerConnection::receiveLoop, this);
+    startSendThread();
+}
+
+void InterServerConnection::setBatching(std::chrono::microseconds max_delay, size_t max_bytes) {
+    batch_delay = max_delay;
+    batch_bytes = max_bytes;
+}
+
+void InterServerConnection::startSendThread() {
+    if (batch_delay.count() > 0) {
+        send_thread = std::thread(&InterServerConnection::sendLoop, this);
+    }
+}
+
 void InterServerConnection::disconnect() {
-    if (!connected) {
+    // The receive thread may already have ended on its own (the peer closed
+    // the link), but it still has to be joined
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        connected = false;
+    }
+    batch_cv.notify_all();
+    if (connection_socket == INVALID_SOCKET) {
         return;
     }
 
-    connected = false;
+    // Wake the receive thread out of recv() so the join cannot wait on the peer
+    #ifdef _WIN32
+        shutdown(connection_socket, SD_BOTH);
+    #else
+        shutdown(connection_socket, SHUT_RDWR);
+    #endif
 
     if (receive_thread.joinable()) {
         receive_thread.join();
     }
+    if (send_thread.joinable()) {
+        send_thread.join();
+    }
 
     if (connection_socket != INVALID_SOCKET) {
         close(connection_socket);
@@ -298,45 +518,156 @@ void InterServerConnection::disconnect() {
     }
 }
 
-bool InterServerConnection::sendMessage(const ServerMessage& message) {
+bool InterServerConnection::sendMessage(const ServerMessage& message, bool flush_now) {
     if (!connected) {
         return false;
     }
 
+    bool start_timer;
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        start_timer = send_batch.empty();
+        if (start_timer) {
+            batch_due = std::chrono::steady_clock::now() + batch_delay;
+        }
+        appendServerMessage(send_batch, message);
+        ++batch_messages;
+        // A full batch is written by its sender, which holds back producers
+        // as a plain blocking send did
+        flush_now = flush_now || batch_delay.count() == 0 || send_batch.size() >= batch_bytes;
+    }
+
+    if (flush_now) {
+        return flush();
+    }
+    if (start_timer) {
+        batch_cv.notify_one();
+    }
+    return true;
+}
+
+// Writes the current batch. socket_mutex is taken before the batch is
+// swapped out, so batches go out in the order they were filled.
+bool InterServerConnection::flush() {
     std::lock_guard<std::mutex> lock(socket_mutex);
 
-    std::string serialized = serializeServerMessage(message);
-    int result = send(connection_socket, serialized.c_str(), serialized.length(), 0);
+    size_t count;
+    {
+        std::lock_guard<std::mutex> batch_lock(batch_mutex);
+        write_buffer.swap(send_batch); // send_batch keeps the old buffer's capacity
+        count = batch_messages;
+        batch_messages = 0;
+    }
+    if (write_buffer.empty()) {
+        return true;
+    }
+
+    size_t offset = 0;
+    bool written = true;
+    while (offset < write_buffer.size()) {
+        int result = send(connection_socket, write_buffer.data() + offset,
+                          static_cast<int>(write_buffer.size() - offset), SEND_FLAGS);
+        if (result == SOCKET_ERROR || result == 0) {
+            written = false;
+            break;
+        }
+        offset += static_cast<size_t>(result);
+        writes.fetch_add(1, std::memory_order_relaxed);
+    }
 
-    return result != SOCKET_ERROR;
+    if (written) {
+        messages_sent.fetch_add(count, std::memory_order_relaxed);
+        bytes_sent.fetch_add(write_buffer.size(), std::memory_order_relaxed);
+    }
+    write_buffer.clear();
+    return written;
+}
+
+// Writes each batch once its oldest message has waited batch_delay
+void InterServerConnection::sendLoop() {
+    std::unique_lock<std::mutex> lock(batch_mutex);
+    while (connected) {
+        if (send_batch.empty()) {
+            batch_cv.wait(lock);
+            continue;
+        }
+        if (std::chrono::steady_clock::now() < batch_due) {
+            batch_cv.wait_until(lock, batch_due);
+            continue;
+        }
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
 }
 
 void InterServerConnection::receiveLoop() {
     char buffer[4096];
+    std::string pending; // Bytes after the last complete frame
 
     while (connected) {
-        int bytes = recv(connection_socket, buffer, sizeof(buffer) - 1, 0);
+        int bytes = recv(connection_socket, buffer, sizeof(buffer), 0);
 
         if (bytes <= 0) {
             break;
         }
 
-        buffer[bytes] = '\0';
-        std::string data(buffer);
-
-        try {
-            ServerMessage message = deserializeServerMessage(data);
-            updateActivity();
-            // TODO: Add to message queue for processing
-        } catch (const std::exception& e) {
-            std::cerr << "Error deserializing message: " << e.what() << std::endl;
+        updateActivity();
+        bytes_received.fetch_add(static_cast<uint64_t>(bytes), std::memory_order_relaxed);
+        pending.append(buffer, static_cast<size_t>(bytes));
+
+        // Frames are decoded in place; only those handed on are copied
+        std::string_view unread(pending);
+        ServerMessageView message;
+        size_t consumed = 0;
+        ServerDecodeStatus status;
+        while ((status = decodeServerMessage(unread, message, consumed)) == ServerDecodeStatus::OK) {
+            handleMessage(message);
+            unread.remove_prefix(consumed);
+        }
+        if (status == ServerDecodeStatus::INVALID) {
+            std::cerr << "Server link " << server_id << " sent an invalid or over-long message, dropping it" << std::endl;
+            break;
         }
+        pending.erase(0, pending.size() - unread.size());
     }
 
     connected = false;
 }
 
+void InterServerConnection::handleMessage(const ServerMessageView& message) {
+    messages_received.fetch_add(1, std::memory_order_relaxed);
+    if (message.type == ServerMessageType::SERVER_HANDSHAKE) {
+        setPeerId(std::string(message.server_id));
+        sendMessage(ServerMessage(ServerMessageType::SERVER_HANDSHAKE_ACK, manager->getServerId()), true);
+    } else if (message.type == ServerMessageType::SERVER_HANDSHAKE_ACK) {
+        setPeerId(std::string(message.server_id));
+    }
+    manager->queueMessage(message.toMessage());
+}
+
+void InterServerConnection::setPeerId(const std::string& id) {
+    std::lock_guard<std::mutex> lock(peer_mutex);
+    peer_id = id;
+}
+
+LinkStats InterServerConnection::getStats() const {
+    LinkStats stats;
+    stats.link = server_id;
+    {
+        std::lock_guard<std::mutex> lock(peer_mutex);
+        stats.peer = peer_id;
+    }
+    stats.inbound = inbound;
+    stats.messages_sent = messages_sent.load(std::memory_order_relaxed);
+    stats.messages_received = messages_received.load(std::memory_order_relaxed);
+    stats.bytes_sent = bytes_sent.load(std::memory_order_relaxed);
+    stats.bytes_received = bytes_received.load(std::memory_order_relaxed);
+    stats.writes = writes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+// Tells the peer who we are; its ACK carries its own id
 bool InterServerConnection::performHandshake() {
-    // TODO: Implement handshake protocol
-    return true;
+    return sendMessage(ServerMessage(ServerMessageType::SERVER_HANDSHAKE, manager->getServerId()), true);
 }
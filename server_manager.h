@@ -7,8 +7,12 @@
 #include <map>
 #include <queue>
 #include <condition_variable>
+#include <functional>
+#include <string>
+#include <vector>
 #include "interserver_protocol.h"
 #include "server_config.h"
+#include "timing_wheel.h"
 
 // Cross-platform socket includes
 #ifdef _WIN32
@@ -19,6 +23,7 @@
 #else
     #include <sys/socket.h>
     #include <netinet/in.h>
+    #include <netinet/tcp.h>
     #include <arpa/inet.h>
     #include <unistd.h>
     #include <netdb.h>
@@ -30,16 +35,33 @@
 // Forward declarations
 class InterServerConnection;
 
+// Traffic on one inter-server link since it was opened
+struct LinkStats {
+    std::string link;  // Address this server dialled, or the peer's address for an accepted link
+    std::string peer;  // The peer's server id, once its handshake has arrived
+    bool inbound;
+    uint64_t messages_sent;
+    uint64_t messages_received;
+    uint64_t bytes_sent;
+    uint64_t bytes_received;
+    uint64_t writes; // send() calls; messages_sent / writes is the batching factor
+};
+
 // Server manager class to handle server-to-server communication
 class ServerManager {
 private:
     std::map<std::string, std::unique_ptr<InterServerConnection>> connections;
     std::mutex connections_mutex;
+    TimingWheel liveness{std::chrono::seconds(1)}; // One timer per connection (connections_mutex)
     std::atomic<bool> running;
     std::thread network_thread;
     std::queue<ServerMessage> message_queue;
     std::mutex message_mutex;
     std::condition_variable message_cv;
+    SOCKET listen_socket = INVALID_SOCKET;
+    std::thread accept_thread;
+    std::atomic<size_t> link_count{0}; // connections.size(), readable without the lock
+    std::function<void(const ServerMessage&)> forward_handler;
 
     // Server information
     std::string server_id;
@@ -60,15 +82,25 @@ public:
     void stop();
     bool isRunning() const { return running; }
 
+    // Accepts links dialled by other servers; call after start()
+    bool listen(int port);
+
     // Connection management
     bool connectToServer(const std::string& host, int port);
     bool disconnectFromServer(const std::string& server_id);
     bool isConnectedToServer(const std::string& server_id) const;
 
-    // Message handling
+    // Message handling. Messages are batched per link (see
+    // InterServerConnection); flush() writes every link's batch now.
     bool sendMessage(const ServerMessage& message);
     bool broadcastMessage(const ServerMessage& message);
+    void flush();
     void processMessage(const ServerMessage& message);
+    // Hands a received message to the network thread
+    void queueMessage(ServerMessage message);
+    // Receives forwarded chat on the network thread; set before start()
+    void setForwardHandler(std::function<void(const ServerMessage&)> handler) { forward_handler = std::move(handler); }
+    bool hasLinks() const { return link_count.load(std::memory_order_relaxed) != 0; }
 
     // Server discovery
     void discoverServers();
@@ -77,13 +109,16 @@ public:
 
     // Information and statistics
     std::vector<ServerInfo> getConnectedServers() const;
+    std::vector<LinkStats> getLinkStats() const;
     std::string getNetworkStatus() const;
     int getTotalMessagesSent() const { return total_messages_sent; }
     int getTotalMessagesReceived() const { return total_messages_received; }
+    std::string getServerId() const { return server_id; }
 
 private:
     // Network thread function
     void networkLoop();
+    void acceptLoop();
 
     // Message processing
     void handleHandshake(const ServerMessage& message);
@@ -92,10 +127,14 @@ private:
     void handleUserSync(const ServerMessage& message);
     void handleServerStatus(const ServerMessage& message);
 
+    // Peer liveness
+    void armLiveness(InterServerConnection* connection, std::chrono::milliseconds delay);
+    void runLivenessTimers();
+    std::chrono::milliseconds checkLiveness(InterServerConnection* connection);
+    void eraseConnection(std::map<std::string, std::unique_ptr<InterServerConnection>>::iterator it);
+
     // Utility functions
-    void cleanupDeadConnections();
     void logNetworkMessage(const std::string& message);
-    std::string getServerId() const { return server_id; }
 };
 
 // Individual server connection handler
@@ -109,27 +148,66 @@ private:
     std::thread receive_thread;
     ServerManager* manager;
 
-    std::chrono::system_clock::time_point last_activity;
+    std::atomic<std::chrono::system_clock::time_point> last_activity; // Written by the receive thread
     std::mutex socket_mutex;
+    TimingWheel::TimerId liveness_timer; // In the manager's wheel
+    bool inbound = false;                // Accepted rather than dialled
+    std::string peer_id;                 // From the peer's handshake (peer_mutex)
+    mutable std::mutex peer_mutex;
+    std::atomic<uint64_t> messages_sent{0};
+    std::atomic<uint64_t> messages_received{0};
+    std::atomic<uint64_t> bytes_sent{0};
+    std::atomic<uint64_t> bytes_received{0};
+    std::atomic<uint64_t> writes{0};
+
+    // Outgoing frames are appended to send_batch and written together: by
+    // the send thread once the oldest has waited batch_delay, by the sender
+    // once the batch reaches batch_bytes, or by flush(). A batch_delay of
+    // zero writes each message as it is sent.
+    std::chrono::microseconds batch_delay{0};
+    size_t batch_bytes = 0;
+    std::string send_batch;                          // batch_mutex
+    size_t batch_messages = 0;                       // Frames in send_batch (batch_mutex)
+    std::chrono::steady_clock::time_point batch_due; // Write deadline of send_batch (batch_mutex)
+    std::mutex batch_mutex;
+    std::condition_variable batch_cv;
+    std::thread send_thread;
+    std::string write_buffer;                        // The batch being written (socket_mutex)
 
 public:
     InterServerConnection(ServerManager* mgr, const std::string& host, int port);
+    // A link another server dialled; `socket` is already connected
+    InterServerConnection(ServerManager* mgr, SOCKET socket, const std::string& host, int port);
     ~InterServerConnection();
 
     bool connect();
+    void startInbound();
     void disconnect();
     bool isConnected() const { return connected; }
 
-    bool sendMessage(const ServerMessage& message);
+    // Call before connect() or startInbound()
+    void setBatching(std::chrono::microseconds max_delay, size_t max_bytes);
+    // Queues the message on the link's batch; `flush_now` writes it at once
+    bool sendMessage(const ServerMessage& message, bool flush_now = false);
+    bool flush();
     std::string getServerId() const { return server_id; }
     std::string getHost() const { return host; }
     int getPort() const { return port; }
 
-    void updateActivity() { last_activity = std::chrono::system_clock::now(); }
-    std::chrono::system_clock::time_point getLastActivity() const { return last_activity; }
+    void updateActivity() { last_activity.store(std::chrono::system_clock::now(), std::memory_order_relaxed); }
+    std::chrono::system_clock::time_point getLastActivity() const { return last_activity.load(std::memory_order_relaxed); }
+
+    TimingWheel::TimerId getLivenessTimer() const { return liveness_timer; }
+    void setLivenessTimer(TimingWheel::TimerId id) { liveness_timer = id; }
+
+    LinkStats getStats() const;
 
 private:
     void receiveLoop();
+    void sendLoop();
+    void startSendThread();
+    void handleMessage(const ServerMessageView& message);
+    void setPeerId(const std::string& id);
     bool performHandshake();
 };
 
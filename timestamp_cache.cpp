@@ -0,0 +1,55 @@
+#include "timestamp_cache.h"
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+struct CachedSecond {
+    std::time_t second = -1;
+    char clock[CLOCK_TIME_LENGTH + 1];
+    char iso[ISO_TIME_LENGTH + 1];
+};
+
+thread_local CachedSecond cached;
+
+const std::chrono::steady_clock::time_point process_start = std::chrono::steady_clock::now();
+
+const CachedSecond& cachedSecond(std::chrono::system_clock::time_point time) {
+    std::time_t second = std::chrono::system_clock::to_time_t(time);
+    if (second != cached.second) {
+        std::tm local{};
+        #ifdef _WIN32
+        localtime_s(&local, &second);
+        #else
+        localtime_r(&second, &local);
+        #endif
+        std::strftime(cached.clock, sizeof(cached.clock), "[%H:%M:%S]", &local);
+        std::strftime(cached.iso, sizeof(cached.iso), "%Y-%m-%d %H:%M:%S", &local);
+        cached.second = second;
+    }
+    return cached;
+}
+
+} // namespace
+
+void appendClockTime(std::string& out, std::chrono::system_clock::time_point time) {
+    out.append(cachedSecond(time).clock, CLOCK_TIME_LENGTH);
+}
+
+void appendIsoTime(std::string& out, std::chrono::system_clock::time_point time) {
+    out.append(cachedSecond(time).iso, ISO_TIME_LENGTH);
+}
+
+void appendMonotonicTime(std::string& out, std::chrono::steady_clock::time_point time) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(time - process_start).count();
+    if (micros < 0) {
+        micros = 0;
+    }
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "[+%lld.%06lld]",
+                               static_cast<long long>(micros / 1000000), static_cast<long long>(micros % 1000000));
+    if (length > 0) {
+        out.append(text, static_cast<size_t>(length));
+    }
+}
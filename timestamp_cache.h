@@ -0,0 +1,28 @@
+#ifndef TIMESTAMP_CACHE_H
+#define TIMESTAMP_CACHE_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Lengths of the formatted forms, for reserve()
+const size_t CLOCK_TIME_LENGTH = 10;     // "[HH:MM:SS]"
+const size_t ISO_TIME_LENGTH = 19;       // "YYYY-MM-DD HH:MM:SS"
+const size_t MONOTONIC_TIME_LENGTH = 17; // "[+SSSSSSS.uuuuuu]" for the first 115 days
+
+// Timestamp formatting for chat lines and log records. Each thread keeps
+// the local-time fields of the last second it formatted, so localtime and
+// strftime run at most once per second per thread and concurrent callers
+// never share state. The append functions only write into `out`; they do
+// not allocate when `out` already has room.
+void appendClockTime(std::string& out,
+                     std::chrono::system_clock::time_point time = std::chrono::system_clock::now());
+void appendIsoTime(std::string& out,
+                   std::chrono::system_clock::time_point time = std::chrono::system_clock::now());
+
+// "[+seconds.micros]" since process start on the monotonic clock, for
+// latency tracing where wall-clock seconds are too coarse
+void appendMonotonicTime(std::string& out,
+                         std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now());
+
+#endif // TIMESTAMP_CACHE_H
@@ -0,0 +1,148 @@
+#include "timing_wheel.h"
+#include <algorithm>
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, Clock::time_point start)
+    : tick(std::max(tick, std::chrono::milliseconds(1))), start(start), now_tick(0), pending(0), free_head(NIL) {
+    std::fill(std::begin(heads), std::end(heads), NIL);
+}
+
+TimingWheel::TimerId TimingWheel::schedule(std::chrono::milliseconds delay, uint64_t data) {
+    uint64_t ticks = delay.count() <= 0 ? 1 : static_cast<uint64_t>((delay + tick - std::chrono::milliseconds(1)) / tick);
+    uint32_t index;
+    if (free_head != NIL) {
+        index = free_head;
+        free_head = nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{0, 0, NIL, NIL, FREE, 0});
+    }
+    Node& node = nodes[index];
+    node.expires = now_tick + ticks;
+    node.data = data;
+    link(index);
+    ++pending;
+    return (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+}
+
+bool TimingWheel::cancel(TimerId id) {
+    uint32_t low = static_cast<uint32_t>(id);
+    if (low == 0 || low > nodes.size()) {
+        return false;
+    }
+    uint32_t index = low - 1;
+    Node& node = nodes[index];
+    if (node.slot == FREE || node.generation != static_cast<uint32_t>(id >> 32)) {
+        return false; // Fired, cancelled, or the node was reused
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+// Puts a node in the lowest level whose range holds its expiry. Delays
+// beyond the top level wait in its furthest slot and are re-placed on
+// every cascade until they come in range.
+void TimingWheel::link(uint32_t index) {
+    Node& node = nodes[index];
+    uint64_t delta = node.expires - now_tick;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) {
+        ++level;
+    }
+    uint64_t expires = node.expires;
+    if (delta >= (1ull << (SLOT_BITS * LEVELS))) {
+        expires = now_tick + (1ull << (SLOT_BITS * LEVELS)) - 1;
+    }
+    uint32_t slot = static_cast<uint32_t>(level) * SLOTS +
+                    static_cast<uint32_t>((expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+    node.slot = slot;
+    node.prev = NIL;
+    node.next = heads[slot];
+    if (node.next != NIL) {
+        nodes[node.next].prev = index;
+    }
+    heads[slot] = index;
+}
+
+void TimingWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != NIL) {
+        nodes[node.prev].next = node.next;
+    } else {
+        heads[node.slot] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes[node.next].prev = node.prev;
+    }
+}
+
+void TimingWheel::release(uint32_t index) {
+    Node& node = nodes[index];
+    node.slot = FREE;
+    ++node.generation; // Stale ids no longer match
+    node.next = free_head;
+    free_head = index;
+    --pending;
+}
+
+// Re-places every timer in the level's current slot; they all land lower
+void TimingWheel::cascade(int level) {
+    uint32_t slot = static_cast<uint32_t>(level) * SLOTS +
+                    static_cast<uint32_t>((now_tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+    uint32_t index = heads[slot];
+    heads[slot] = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+void TimingWheel::advance(Clock::time_point now, std::vector<uint64_t>& expired) {
+    if (now < start) {
+        return;
+    }
+    uint64_t target = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - start) / tick);
+    while (now_tick < target) {
+        if (pending == 0) {
+            now_tick = target; // Nothing to fire or cascade on the way
+            break;
+        }
+        ++now_tick;
+        // Cascade from the highest level whose slot boundary this tick crosses
+        for (int level = LEVELS - 1; level > 0; --level) {
+            if ((now_tick & ((1ull << (SLOT_BITS * level)) - 1)) == 0) {
+                cascade(level);
+            }
+        }
+        uint32_t slot = static_cast<uint32_t>(now_tick & (SLOTS - 1));
+        uint32_t index = heads[slot];
+        heads[slot] = NIL;
+        while (index != NIL) {
+            uint32_t next = nodes[index].next;
+            expired.push_back(nodes[index].data);
+            release(index);
+            index = next;
+        }
+    }
+}
+
+int TimingWheel::msUntilNext(Clock::time_point now) const {
+    if (pending == 0) {
+        return -1;
+    }
+    // The next non-empty level 0 slot, or the next cascade, whichever is first
+    uint64_t ticks = 1;
+    for (; ticks < SLOTS; ++ticks) {
+        uint64_t at = now_tick + ticks;
+        if (heads[at & (SLOTS - 1)] != NIL || (at & (SLOTS - 1)) == 0) {
+            break;
+        }
+    }
+    auto due = start + tick * static_cast<int64_t>(now_tick + ticks);
+    if (due <= now) {
+        return 0;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(due - now) + std::chrono::milliseconds(1);
+    return static_cast<int>(wait.count());
+}
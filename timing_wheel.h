@@ -0,0 +1,77 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timing wheel: LEVELS wheels of 64 slots each. Level 0 slots
+// are one tick wide, level n slots 64^n ticks, so four levels reach 2^24
+// ticks (19 days at 100 ms). A timer goes into the lowest level whose range
+// covers its delay. When a higher-level slot comes due its timers cascade
+// into the levels below, and level 0 slots fire as the ticks pass.
+//
+// Timers are pooled nodes linked into per-slot intrusive lists, so
+// schedule() and cancel() are O(1) and allocation-free once the pool has
+// grown. A tick costs the timers that fire plus the occasional cascade,
+// however many timers are pending.
+//
+// Not thread-safe: each wheel belongs to one thread (or one mutex).
+class TimingWheel {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef uint64_t TimerId; // Generation in the high half, pool index + 1 in the low half
+    static constexpr TimerId NO_TIMER = 0;
+
+    explicit TimingWheel(std::chrono::milliseconds tick, Clock::time_point start = Clock::now());
+
+    // Calls back with `data` once `delay` (rounded up to whole ticks, at
+    // least one) has passed
+    TimerId schedule(std::chrono::milliseconds delay, uint64_t data);
+    // False if the timer already fired or was cancelled
+    bool cancel(TimerId id);
+
+    // Moves time forward to `now`, appending the data of every timer that
+    // came due, in expiry order
+    void advance(Clock::time_point now, std::vector<uint64_t>& expired);
+
+    // How long a caller can sleep before advance() may have work; -1 when
+    // no timer is pending. Never more than 64 ticks.
+    int msUntilNext(Clock::time_point now) const;
+
+    size_t size() const { return pending; }
+    std::chrono::milliseconds tickLength() const { return tick; }
+
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr uint32_t FREE = UINT32_MAX;
+
+    struct Node {
+        uint64_t expires;   // Absolute tick
+        uint64_t data;
+        uint32_t prev;
+        uint32_t next;
+        uint32_t slot;      // level * SLOTS + slot, or FREE
+        uint32_t generation;
+    };
+
+    std::chrono::milliseconds tick;
+    Clock::time_point start;
+    uint64_t now_tick;
+    size_t pending;
+
+    std::vector<Node> nodes;
+    uint32_t free_head;
+    uint32_t heads[LEVELS * SLOTS];
+
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    void cascade(int level);
+};
+
+#endif // TIMING_WHEEL_H
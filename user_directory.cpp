@@ -0,0 +1,85 @@
+#include "user_directory.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+void UserDirectory::add(const std::string& username, const std::string& line) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    entries.insert_or_assign(username, line);
+    std::atomic_store(&first_page, MessageBuffer());
+}
+
+void UserDirectory::remove(const std::string& username) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (entries.erase(username) != 0) {
+        std::atomic_store(&first_page, MessageBuffer());
+    }
+}
+
+void UserDirectory::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    entries.clear();
+    std::atomic_store(&first_page, MessageBuffer());
+}
+
+size_t UserDirectory::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return entries.size();
+}
+
+MessageBuffer UserDirectory::render(std::string_view prefix, size_t page) const {
+    if (page == 0) {
+        page = 1;
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (prefix.empty() && page == 1) {
+        MessageBuffer cached = std::atomic_load(&first_page);
+        if (!cached) {
+            // Readers racing here render the same text; the last store wins
+            cached = renderRange("", entries.begin(), 1);
+            std::atomic_store(&first_page, cached);
+        }
+        return cached;
+    }
+    return renderRange(prefix, entries.lower_bound(prefix), page);
+}
+
+// `first` is the first entry at or after `prefix`; the matching users run
+// from there until a name no longer starts with it
+MessageBuffer UserDirectory::renderRange(std::string_view prefix, EntryMap::const_iterator first, size_t page) const {
+    auto matches = [&prefix](EntryMap::const_iterator it) {
+        return it->first.compare(0, prefix.size(), prefix) == 0;
+    };
+
+    auto it = first;
+    size_t skip = (page - 1) * USER_LIST_PAGE_SIZE;
+    size_t total = 0;
+    for (; total < skip && it != entries.end() && matches(it); ++total) {
+        ++it;
+    }
+
+    std::string text = "\n=== Online Users";
+    if (!prefix.empty()) {
+        text.append(" matching '").append(prefix).append("'");
+    }
+    text += " ===\n";
+    for (size_t shown = 0; shown < USER_LIST_PAGE_SIZE && it != entries.end() && matches(it); ++shown, ++total) {
+        text += it->second;
+        ++it;
+    }
+    if (prefix.empty()) {
+        total = entries.size();
+    } else {
+        for (; it != entries.end() && matches(it); ++total) {
+            ++it;
+        }
+    }
+
+    size_t pages = std::max<size_t>(1, (total + USER_LIST_PAGE_SIZE - 1) / USER_LIST_PAGE_SIZE);
+    text += "Total: " + std::to_string(total) + " users";
+    if (pages > 1 || page > 1) {
+        text += " (page " + std::to_string(page) + "/" + std::to_string(pages) + ")";
+    }
+    text += "\n\n";
+    return makeMessageBuffer(std::move(text));
+}
@@ -0,0 +1,47 @@
+#ifndef USER_DIRECTORY_H
+#define USER_DIRECTORY_H
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include "message_buffer.h"
+
+// Users shown per /list page
+const size_t USER_LIST_PAGE_SIZE = 50;
+
+// Listing of online users behind /list, sorted by username and updated in
+// place: a join or leave is one O(log n) map insert or erase. Each user's
+// line is formatted once when they join. The unfiltered first page is
+// rendered at most once between changes and shared by every /list in
+// between. Other pages find the prefix with a binary search, step over
+// the earlier pages and count the rest of the matches, formatting only
+// the users they show.
+class UserDirectory {
+public:
+    UserDirectory() = default;
+
+    // Adds the user, or replaces their line
+    void add(const std::string& username, const std::string& line);
+    void remove(const std::string& username);
+    void clear();
+
+    // The /list response for one page (counted from 1) of the users whose
+    // name starts with `prefix`
+    MessageBuffer render(std::string_view prefix, size_t page) const;
+
+    size_t size() const;
+
+private:
+    typedef std::map<std::string, std::string, std::less<>> EntryMap; // Name to "- name (ip)\n"
+
+    mutable std::shared_mutex mutex;
+    EntryMap entries;
+    mutable MessageBuffer first_page; // Null once stale; std::atomic_load/store
+
+    MessageBuffer renderRange(std::string_view prefix, EntryMap::const_iterator first, size_t page) const;
+};
+
+#endif // USER_DIRECTORY_H